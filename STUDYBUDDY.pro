@@ -1,5 +1,5 @@
 QT       += core gui multimedia sql widgets charts
-CONFIG += c++17
+CONFIG += c++20
 
 # OpenCV configuration for your specific installation
 INCLUDEPATH += C:/Users/bouib/Desktop/opencv/build/include
@@ -25,22 +25,51 @@ SOURCES += \
     pomodoro.cpp \
     studygoals.cpp \
     achievements.cpp \
+    achievementrules.cpp \
+    achievementbackfill.cpp \
     streak.cpp \
     analytics.cpp \
     achievementitemdelegate.cpp \
+    iconcache.cpp \
      studysession.cpp \
-     survey.cpp
+     survey.cpp \
+     downsampler.cpp \
+     statistics.cpp \
+     tdigest.cpp \
+     dayindex.cpp \
+     streakengine.cpp \
+     focussketches.cpp \
+     database.cpp \
+     recurrencerule.cpp \
+     dataexchange.cpp \
+     searchindex.cpp \
+     activityheatmap.cpp
 
 HEADERS += \
     mainwindow.h \
     pomodoro.h \
     studygoals.h \
     achievements.h \
+    achievementrules.h \
+    achievementbackfill.h \
     streak.h \
     analytics.h \
     achievementitemdelegate.h \
+    iconcache.h \
       studysession.h \
-      survey.h 
+      survey.h \
+      downsampler.h \
+      ringbuffer.h \
+      statistics.h \
+      tdigest.h \
+      dayindex.h \
+      streakengine.h \
+      focussketches.h \
+      database.h \
+      recurrencerule.h \
+      dataexchange.h \
+      searchindex.h \
+      activityheatmap.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,269 @@
+#include "achievementbackfill.h"
+#include "achievements.h"
+#include "streak.h"
+#include <QSqlError>
+#include <QSettings>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+const int kChunkRows = 2000;
+// Long enough to amortise the timer, short enough not to stall the UI
+const qint64 kSliceMs = 15;
+const int kCheckpointEvery = 50000;
+const QString kGroup = "achievementBackfill";
+
+// Detections and sessions store "yyyy-MM-dd HH:mm:ss", surveys ISO 8601
+QDateTime parseTimestamp(const QString &text)
+{
+    return QDateTime::fromString(text.left(19).replace('T', ' '), "yyyy-MM-dd HH:mm:ss");
+}
+
+// A day's streak is settled at its end, or now for today
+QDateTime endOfDay(const QDate &date)
+{
+    return qMin(QDateTime(date, QTime(23, 59, 59)), QDateTime::currentDateTime());
+}
+}
+
+AchievementBackfill::AchievementBackfill(QSqlDatabase &database, Achievement *achievement, StudyStreak *streak,
+                                         QObject *parent)
+    : QObject(parent), db(database), achievement(achievement), streak(streak)
+{
+}
+
+AchievementBackfill::~AchievementBackfill()
+{
+    if (running) saveCheckpoint();
+}
+
+bool AchievementBackfill::isNeeded() const
+{
+    const QByteArray current = achievement->rulesFingerprint();
+    QSettings settings("StudyBuddy", "FocusMonitor");
+    return !current.isEmpty() && settings.value(kGroup + "/completedRules").toByteArray() != current;
+}
+
+void AchievementBackfill::start()
+{
+    if (running) return;
+    fingerprint = achievement->rulesFingerprint();
+    if (fingerprint.isEmpty()) return; // the rules failed to load
+    rules = achievement->rules();
+    rules.reset();
+
+    sources.clear();
+    Source detections;
+    detections.table = "detections";
+    detections.sql = "SELECT id, timestamp, focus_score FROM detections WHERE id > ? ORDER BY id LIMIT ?";
+    sources.append(detections);
+    Source sessions;
+    sessions.table = "study_sessions";
+    sessions.sql = "SELECT id, start_time, end_time FROM study_sessions "
+                   "WHERE id > ? AND end_time IS NOT NULL ORDER BY id LIMIT ?";
+    sources.append(sessions);
+    Source surveys;
+    surveys.table = "surveys";
+    surveys.sql = "SELECT id, timestamp, session_satisfaction FROM surveys WHERE id > ? ORDER BY id LIMIT ?";
+    sources.append(surveys);
+
+    progress.clear();
+    earnedAt.clear();
+    history.clear();
+    nextStudyDay = 0;
+    sinceCheckpoint = 0;
+
+    // Resume an interrupted replay, but only of the same rules
+    QSettings settings("StudyBuddy", "FocusMonitor");
+    settings.beginGroup(kGroup);
+    if (settings.value("checkpointRules").toByteArray() == fingerprint) {
+        for (Source &source : sources) {
+            source.cursor = source.readId = settings.value("cursor/" + source.table).toLongLong();
+        }
+        nextStudyDay = settings.value("studyDay").toInt();
+        const QVariantMap savedProgress = settings.value("progress").toMap();
+        for (auto it = savedProgress.cbegin(); it != savedProgress.cend(); ++it) {
+            progress.insert(it.key(), it.value().toInt());
+        }
+        const QVariantMap savedEarned = settings.value("earnedAt").toMap();
+        for (auto it = savedEarned.cbegin(); it != savedEarned.cend(); ++it) {
+            earnedAt.insert(it.key(), QDateTime::fromString(it.value().toString(), Qt::ISODate));
+        }
+    }
+    settings.endGroup();
+
+    QSqlQuery query(db);
+    for (Source &source : sources) {
+        if (query.exec(QString("SELECT MAX(id) FROM %1").arg(source.table)) && query.next()) {
+            source.lastId = query.value(0).toLongLong();
+        }
+    }
+    studyDays = streak->getStudyHistory(streak->getFirstStudyDate(), QDate::currentDate()).keys();
+    nextStudyDay = qMin(nextStudyDay, int(studyDays.size()));
+
+    running = true;
+    QTimer::singleShot(0, this, &AchievementBackfill::runSlice);
+}
+
+void AchievementBackfill::cancel()
+{
+    if (!running) return;
+    running = false;
+    saveCheckpoint();
+}
+
+void AchievementBackfill::runSlice()
+{
+    if (!running) return;
+
+    QElapsedTimer slice;
+    slice.start();
+    while (slice.elapsed() < kSliceMs) {
+        // The earliest head among the tables and the study days goes next
+        Source *next = nullptr;
+        for (Source &source : sources) {
+            if (!fill(source)) continue;
+            if (!next || source.pending.front().second.at < next->pending.front().second.at) next = &source;
+        }
+        const bool dayNext = nextStudyDay < studyDays.size()
+            && (!next || endOfDay(studyDays[nextStudyDay]) <= next->pending.front().second.at);
+
+        if (dayNext) {
+            const QDate day = studyDays[nextStudyDay++];
+            replay({AchievementEventType::StreakChanged, endOfDay(day), streak->getStreakOn(day), 0.0, QDateTime()});
+        } else if (next) {
+            const QPair<qint64, AchievementEvent> item = next->pending.front();
+            next->pending.pop_front();
+            next->cursor = item.first;
+            replay(item.second);
+        } else {
+            finish();
+            return;
+        }
+
+        if (++sinceCheckpoint >= kCheckpointEvery) {
+            saveCheckpoint();
+            sinceCheckpoint = 0;
+        }
+    }
+
+    emit progressChanged(percentDone());
+    QTimer::singleShot(0, this, &AchievementBackfill::runSlice);
+}
+
+bool AchievementBackfill::fill(Source &source)
+{
+    while (source.pending.empty() && !source.exhausted) {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(source.sql);
+        query.addBindValue(source.readId);
+        query.addBindValue(kChunkRows);
+        if (!query.exec()) {
+            qDebug() << "Error reading" << source.table << "for achievement backfill:" << query.lastError().text();
+            source.exhausted = true;
+            break;
+        }
+
+        int rows = 0;
+        while (query.next()) {
+            ++rows;
+            source.readId = query.value(0).toLongLong();
+            const AchievementEvent event = toEvent(source, query);
+            if (event.at.isValid()) source.pending.push_back({source.readId, event});
+        }
+        if (rows < kChunkRows) source.exhausted = true;
+    }
+    return !source.pending.empty();
+}
+
+AchievementEvent AchievementBackfill::toEvent(const Source &source, const QSqlQuery &query) const
+{
+    const QDateTime at = parseTimestamp(query.value(source.table == "study_sessions" ? 2 : 1).toString());
+    if (source.table == "detections") {
+        return {AchievementEventType::FocusSample, at, 0, query.value(2).toDouble(), QDateTime()};
+    }
+    if (source.table == "study_sessions") {
+        const QDateTime start = parseTimestamp(query.value(1).toString());
+        const int minutes = start.isValid() ? int(qMax<qint64>(0, start.secsTo(at)) / 60) : 0;
+        return {AchievementEventType::SessionEnded, at, minutes, 0.0, start};
+    }
+    return {AchievementEventType::SurveySubmitted, at, query.value(2).toInt(), 0.0, QDateTime()};
+}
+
+void AchievementBackfill::replay(const AchievementEvent &event)
+{
+    const QList<AchievementRules::Definition> &definitions = rules.definitions();
+    QList<QPair<int, int>> changes;
+    rules.evaluate(event, [this, &definitions](int rule) {
+        const QString &id = definitions[rule].id;
+        return earnedAt.contains(id) ? -1 : progress.value(id);
+    }, &changes);
+
+    for (const QPair<int, int> &change : changes) {
+        const AchievementRules::Definition &definition = definitions[change.first];
+        progress.insert(definition.id, change.second);
+        QList<QPair<QDateTime, int>> &points = history[definition.id];
+        if (!points.isEmpty() && points.last().first.date() == event.at.date()) {
+            points.last() = {event.at, change.second};
+        } else {
+            points.append({event.at, change.second});
+        }
+        if (change.second >= definition.target) earnedAt.insert(definition.id, event.at);
+    }
+}
+
+int AchievementBackfill::percentDone() const
+{
+    qint64 done = nextStudyDay;
+    qint64 total = studyDays.size();
+    for (const Source &source : sources) {
+        done += source.cursor;
+        total += qMax(source.lastId, source.cursor);
+    }
+    return total > 0 ? int(done * 100 / total) : 100;
+}
+
+void AchievementBackfill::saveCheckpoint()
+{
+    // The history goes with the cursors, so a resume neither repeats nor skips points
+    if (achievement->logProgressHistory(history)) history.clear();
+
+    // Focus windows are not saved; a resume loses at most one window of samples
+    QSettings settings("StudyBuddy", "FocusMonitor");
+    settings.beginGroup(kGroup);
+    settings.setValue("checkpointRules", fingerprint);
+    for (const Source &source : sources) {
+        settings.setValue("cursor/" + source.table, source.cursor);
+    }
+    settings.setValue("studyDay", nextStudyDay);
+
+    QVariantMap savedProgress;
+    for (auto it = progress.cbegin(); it != progress.cend(); ++it) savedProgress.insert(it.key(), it.value());
+    settings.setValue("progress", savedProgress);
+    QVariantMap savedEarned;
+    for (auto it = earnedAt.cbegin(); it != earnedAt.cend(); ++it) {
+        savedEarned.insert(it.key(), it.value().toString(Qt::ISODate));
+    }
+    settings.setValue("earnedAt", savedEarned);
+    settings.endGroup();
+}
+
+void AchievementBackfill::finish()
+{
+    running = false;
+    achievement->logProgressHistory(history);
+    history.clear();
+    const int unlocked = achievement->mergeHistory(progress, earnedAt);
+
+    QSettings settings("StudyBuddy", "FocusMonitor");
+    settings.beginGroup(kGroup);
+    settings.remove("");
+    settings.setValue("completedRules", fingerprint);
+    settings.endGroup();
+
+    emit progressChanged(100);
+    emit finished(unlocked);
+}
@@ -0,0 +1,76 @@
+#ifndef ACHIEVEMENTBACKFILL_H
+#define ACHIEVEMENTBACKFILL_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <deque>
+#include "achievementrules.h"
+
+class Achievement;
+class StudyStreak;
+
+// Replays detections, study sessions, study days and surveys through a copy of the
+// achievement rules, oldest first, so history earns credit under rules that shipped
+// after it. Each table is read in chunks by id and the chunks are merged by time.
+// The job runs in short slices on the GUI thread, and its cursors and the replayed
+// progress are checkpointed to QSettings so a restart resumes where it stopped.
+class AchievementBackfill : public QObject
+{
+    Q_OBJECT
+
+public:
+    AchievementBackfill(QSqlDatabase &database, Achievement *achievement, StudyStreak *streak,
+                        QObject *parent = nullptr);
+    ~AchievementBackfill();
+
+    // The rules changed since the last complete replay, or a replay was interrupted
+    bool isNeeded() const;
+    void start();
+    void cancel();
+    bool isRunning() const { return running; }
+
+signals:
+    void progressChanged(int percent);
+    void finished(int newUnlocks);
+
+private:
+    struct Source {
+        QString table;
+        QString sql;      // id first, then the event columns; binds the last id read and a limit
+        qint64 cursor = 0; // last id replayed
+        qint64 readId = 0; // last id read
+        qint64 lastId = 0; // MAX(id) when the replay started
+        bool exhausted = false;
+        std::deque<QPair<qint64, AchievementEvent>> pending;
+    };
+
+    void runSlice();
+    bool fill(Source &source);
+    AchievementEvent toEvent(const Source &source, const QSqlQuery &query) const;
+    void replay(const AchievementEvent &event);
+    int percentDone() const;
+    void saveCheckpoint();
+    void finish();
+
+    QSqlDatabase &db;
+    Achievement *achievement;
+    StudyStreak *streak;
+    AchievementRules rules;
+    QByteArray fingerprint;
+    bool running = false;
+
+    QList<Source> sources;
+    QList<QDate> studyDays;   // one streak event per study day
+    int nextStudyDay = 0;
+    QHash<QString, int> progress;
+    QHash<QString, QDateTime> earnedAt;
+    // Progress reached since the last checkpoint, at most one point per achievement and day
+    QHash<QString, QList<QPair<QDateTime, int>>> history;
+    int sinceCheckpoint = 0;
+};
+
+#endif // ACHIEVEMENTBACKFILL_H
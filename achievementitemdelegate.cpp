@@ -1,10 +1,28 @@
 #include "achievementitemdelegate.h"
+#include "iconcache.h"
+#include <QtMath>
 #include <QDebug>
 AchievementItemDelegate::AchievementItemDelegate(QObject *parent)
     : QStyledItemDelegate(parent)
 {
 }
 
+const QStaticText &AchievementItemDelegate::titleLayout(const Achievement::AchievementInfo &info, int width) const
+{
+    const QPair<QString, int> key(info.id, width);
+    auto found = titleLayouts.find(key);
+    if (found == titleLayouts.end()) {
+        // Widths change on resize; drop stale layouts rather than keep every width seen
+        if (titleLayouts.size() >= 256) titleLayouts.clear();
+        QStaticText text(QString("<b>%1</b>").arg(info.name.toHtmlEscaped()));
+        text.setTextFormat(Qt::RichText);
+        text.setTextWidth(width);
+        text.setPerformanceHint(QStaticText::AggressiveCaching);
+        found = titleLayouts.insert(key, text);
+    }
+    return found.value();
+}
+
 void AchievementItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
     painter->save();
@@ -24,21 +42,11 @@ void AchievementItemDelegate::paint(QPainter *painter, const QStyleOptionViewIte
                        iconSize.width(), iconSize.height());
 
         // Draw icon
-        QIcon icon = QIcon(info.iconPath);
+        const QPixmap icon = IconCache::pixmap(info.iconPath, iconSize, IconCache::State::Unlocked,
+                                               painter->device()->devicePixelRatioF());
         if (!icon.isNull()) {
-            icon.paint(painter, iconRect, Qt::AlignCenter, QIcon::Normal, option.state & QStyle::State_Selected ? QIcon::On : QIcon::Off);
+            painter->drawPixmap(iconRect, icon);
         }
-        
-        QString titleText = QString("<b>%1</b>").arg(info.name);
-        QTextDocument textDocument;
-        textDocument.setTextWidth(option.rect.width() - 10);
-        textDocument.setHtml(titleText);
-
-        QRect textRect(option.rect.x() + 5,
-                       iconRect.bottom() + 5,
-                       option.rect.width() - 10,
-                       (int)textDocument.size().height());
-        
 
         if (option.state & QStyle::State_Selected) {
             painter->setPen(option.palette.highlightedText().color());
@@ -46,9 +54,7 @@ void AchievementItemDelegate::paint(QPainter *painter, const QStyleOptionViewIte
             painter->setPen(option.palette.text().color());
         }
 
-        painter->translate(textRect.topLeft());
-        textDocument.drawContents(painter);
-        painter->translate(-textRect.topLeft());
+        painter->drawStaticText(option.rect.x() + 5, iconRect.bottom() + 5, titleLayout(info, option.rect.width() - 10));
     }
 
     painter->restore();
@@ -60,14 +66,9 @@ QSize AchievementItemDelegate::sizeHint(const QStyleOptionViewItem &option, cons
 
     if (!info.id.isEmpty()) {
         QSize iconSize = QSize(32, 32);
-        
-        QString titleText = QString("<b>%1</b>").arg(info.name);
-
-        QTextDocument textDocument;
-        textDocument.setTextWidth(option.rect.width() > 0 ? option.rect.width() - 10 : 200);
-        textDocument.setHtml(titleText);
+        const QStaticText &title = titleLayout(info, option.rect.width() > 0 ? option.rect.width() - 10 : 200);
         // Total height: top padding + icon height + padding + text height + bottom padding
-        return QSize(option.rect.width(), iconSize.height() + (int)textDocument.size().height() + 15);
+        return QSize(option.rect.width(), iconSize.height() + qCeil(title.size().height()) + 15);
     }
     return QSize(option.rect.width(), 50); // Default size if info is empty
 }
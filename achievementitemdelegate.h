@@ -3,8 +3,9 @@
 
 #include <QStyledItemDelegate>
 #include <QPainter>
-#include <QAbstractTextDocumentLayout>
-#include <QTextDocument>
+#include <QStaticText>
+#include <QHash>
+#include <QPair>
 #include <QApplication>
 #include <QDebug>
 #include "achievements.h"
@@ -18,6 +19,11 @@ public:
     void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
     QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
+private:
+    // Title layouts by achievement id and text width, so painting a scrolled view
+    // neither parses HTML nor lays out text again
+    const QStaticText &titleLayout(const Achievement::AchievementInfo &info, int width) const;
+    mutable QHash<QPair<QString, int>, QStaticText> titleLayouts;
 };
 
 #endif // ACHIEVEMENTITEMDELEGATE_H 
@@ -0,0 +1,249 @@
+#include "achievementrules.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <algorithm>
+
+namespace {
+// A longer pause between focus samples, e.g. between camera sessions, starts a new window
+const qint64 kMaxSampleGapSecs = 60;
+
+const QHash<QString, AchievementEventType> kEvents = {
+    {"session", AchievementEventType::SessionEnded},
+    {"focus", AchievementEventType::FocusSample},
+    {"streak", AchievementEventType::StreakChanged},
+    {"pomodoro", AchievementEventType::PomodoroDone},
+    {"daily_goals", AchievementEventType::DailyGoalsCompleted},
+    {"survey", AchievementEventType::SurveySubmitted},
+};
+
+// Minutes of [start, end) that fall between fromHour and toHour on any day; the
+// window may wrap past midnight
+int minutesInHours(const QDateTime &start, const QDateTime &end, int fromHour, int toHour)
+{
+    if (!start.isValid() || !end.isValid() || end <= start) return 0;
+    qint64 seconds = 0;
+    for (QDate day = start.date().addDays(-1); day <= end.date(); day = day.addDays(1)) {
+        const QDateTime windowStart(day, QTime(fromHour, 0));
+        const QDateTime windowEnd = toHour > fromHour ? QDateTime(day, QTime(toHour, 0))
+                                                      : QDateTime(day.addDays(1), QTime(toHour, 0));
+        const QDateTime from = qMax(start, windowStart);
+        const QDateTime to = qMin(end, windowEnd);
+        if (from < to) seconds += from.secsTo(to);
+    }
+    return int(seconds / 60);
+}
+}
+
+bool AchievementRules::load(const QByteArray &json, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (document.isNull()) return fail(parseError.errorString());
+
+    QList<Definition> newDefs;
+    QList<Rule> newRules;
+    QList<Window> newWindows;
+    QHash<int, QList<int>> newSubscriptions;
+    QHash<qint64, int> windowBySeconds;
+
+    for (const QJsonValue &value : document.object().value("achievements").toArray()) {
+        const QJsonObject object = value.toObject();
+        Definition def;
+        def.id = object.value("id").toString();
+        def.name = object.value("name").toString();
+        def.description = object.value("description").toString();
+        def.category = object.value("category").toString("Special");
+        def.iconPath = object.value("icon").toString();
+        def.target = object.value("target").toInt(1);
+        if (def.id.isEmpty() || def.name.isEmpty()) return fail("achievement without id or name");
+        for (const Definition &other : newDefs) {
+            if (other.id == def.id) return fail(QString("%1: duplicate id").arg(def.id));
+        }
+
+        const QJsonObject when = object.value("when").toObject();
+        const QString eventName = when.value("event").toString();
+        const QString aggregate = when.value("aggregate").toString();
+        if (!kEvents.contains(eventName)) return fail(QString("%1: unknown event '%2'").arg(def.id, eventName));
+
+        Rule rule;
+        rule.event = kEvents.value(eventName);
+        if (aggregate == "count") {
+            rule.aggregate = Aggregate::Count;
+        } else if (aggregate == "sum") {
+            rule.aggregate = Aggregate::Sum;
+        } else if (aggregate == "max") {
+            rule.aggregate = Aggregate::Max;
+        } else if (aggregate == "rolling_mean") {
+            rule.aggregate = Aggregate::RollingMean;
+        } else {
+            return fail(QString("%1: unknown aggregate '%2'").arg(def.id, aggregate));
+        }
+        // Focus samples are only meaningful as a rolling mean, and only they have one
+        if ((rule.event == AchievementEventType::FocusSample) != (rule.aggregate == Aggregate::RollingMean)) {
+            return fail(QString("%1: rolling_mean applies to focus and only to focus").arg(def.id));
+        }
+
+        if (when.contains("hours")) {
+            const QJsonArray hours = when.value("hours").toArray();
+            rule.fromHour = hours.at(0).toInt(-1);
+            rule.toHour = hours.at(1).toInt(-1);
+            if (rule.event != AchievementEventType::SessionEnded || hours.size() != 2 || rule.fromHour < 0
+                || rule.fromHour > 23 || rule.toHour < 0 || rule.toHour > 23 || rule.fromHour == rule.toHour) {
+                return fail(QString("%1: hours must be [from, to] on a session rule").arg(def.id));
+            }
+        }
+
+        const int index = newDefs.size();
+        if (rule.aggregate == Aggregate::RollingMean) {
+            const int minutes = when.value("window_minutes").toInt();
+            rule.threshold = when.value("threshold").toDouble(-1.0);
+            if (minutes <= 0 || rule.threshold < 0.0) {
+                return fail(QString("%1: rolling_mean needs window_minutes and threshold").arg(def.id));
+            }
+            // Progress is the minutes the mean has held, so the window is the target
+            def.target = minutes;
+            const qint64 seconds = qint64(minutes) * 60;
+            if (!windowBySeconds.contains(seconds)) {
+                windowBySeconds.insert(seconds, newWindows.size());
+                newWindows.append(Window());
+                newWindows.last().seconds = seconds;
+            }
+            newWindows[windowBySeconds.value(seconds)].rules.append(index);
+        } else {
+            newSubscriptions[int(rule.event)].append(index);
+        }
+        if (def.target <= 0) return fail(QString("%1: target must be positive").arg(def.id));
+
+        newDefs.append(def);
+        newRules.append(rule);
+    }
+
+    for (Window &window : newWindows) {
+        std::sort(window.rules.begin(), window.rules.end(), [&newRules](int a, int b) {
+            return newRules[a].threshold < newRules[b].threshold;
+        });
+    }
+
+    defs = newDefs;
+    rules = newRules;
+    windows = newWindows;
+    subscriptions = newSubscriptions;
+    return true;
+}
+
+void AchievementRules::reset()
+{
+    for (Window &window : windows) clearWindow(window);
+}
+
+void AchievementRules::clearWindow(Window &window)
+{
+    for (int i = 0; i < window.qualifying; ++i) rules[window.rules[i]].since = -1;
+    window.buckets.clear();
+    window.sum = 0.0;
+    window.count = 0;
+    window.lastSecond = -1;
+    window.lastMinute = -1;
+    window.qualifying = 0;
+}
+
+void AchievementRules::evaluate(const AchievementEvent &event, const std::function<int(int)> &progressOf,
+                                QList<QPair<int, int>> *changes)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 elapsed = 0;
+
+    if (event.type == AchievementEventType::FocusSample) {
+        for (Window &window : windows) {
+            feedWindow(window, event, progressOf, changes);
+            const qint64 now = timer.nsecsElapsed();
+            chargeWindow(window, now - elapsed);
+            elapsed = now;
+        }
+        return;
+    }
+
+    for (int index : subscriptions.value(int(event.type))) {
+        const int before = progressOf(index);
+        if (before < 0) continue;
+
+        Rule &rule = rules[index];
+        const int value = rule.fromHour >= 0 ? minutesInHours(event.start, event.at, rule.fromHour, rule.toHour)
+                                             : event.value;
+        int after = before;
+        switch (rule.aggregate) {
+        case Aggregate::Count: after = before + 1; break;
+        case Aggregate::Sum: after = before + value; break;
+        case Aggregate::Max: after = qMax(before, value); break;
+        case Aggregate::RollingMean: break;
+        }
+        if (after != before) changes->append({index, after});
+
+        const qint64 now = timer.nsecsElapsed();
+        rule.cost.evaluations++;
+        rule.cost.nanoseconds += now - elapsed;
+        elapsed = now;
+    }
+}
+
+void AchievementRules::chargeWindow(const Window &window, qint64 nanoseconds)
+{
+    if (window.rules.isEmpty()) return;
+    const qint64 share = nanoseconds / window.rules.size();
+    for (int index : window.rules) {
+        rules[index].cost.evaluations++;
+        rules[index].cost.nanoseconds += share;
+    }
+}
+
+void AchievementRules::feedWindow(Window &window, const AchievementEvent &event,
+                                  const std::function<int(int)> &progressOf, QList<QPair<int, int>> *changes)
+{
+    const qint64 second = event.at.toSecsSinceEpoch();
+    if (window.lastSecond >= 0 && (second < window.lastSecond || second - window.lastSecond > kMaxSampleGapSecs)) {
+        clearWindow(window);
+    }
+    window.lastSecond = second;
+
+    if (window.buckets.empty() || window.buckets.back().second != second) {
+        window.buckets.push_back({second, 0.0, 0});
+    }
+    window.buckets.back().sum += event.score;
+    window.buckets.back().count++;
+    window.sum += event.score;
+    window.count++;
+    while (window.buckets.front().second <= second - window.seconds) {
+        window.sum -= window.buckets.front().sum;
+        window.count -= window.buckets.front().count;
+        window.buckets.pop_front();
+    }
+
+    // Only rules whose threshold the mean crossed change state
+    const double mean = window.sum / window.count;
+    while (window.qualifying < window.rules.size() && rules[window.rules[window.qualifying]].threshold <= mean) {
+        rules[window.rules[window.qualifying++]].since = second;
+    }
+    while (window.qualifying > 0 && rules[window.rules[window.qualifying - 1]].threshold > mean) {
+        rules[window.rules[--window.qualifying]].since = -1;
+    }
+
+    // Progress counts whole minutes, so it is only re-read once a minute
+    const qint64 minute = second / 60;
+    if (minute == window.lastMinute) return;
+    window.lastMinute = minute;
+    for (int i = 0; i < window.qualifying; ++i) {
+        const int index = window.rules[i];
+        const int before = progressOf(index);
+        if (before < 0) continue;
+        const int held = int(qMin<qint64>(defs[index].target, (second - rules[index].since) / 60));
+        if (held > before) changes->append({index, held});
+    }
+}
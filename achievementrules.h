@@ -0,0 +1,107 @@
+#ifndef ACHIEVEMENTRULES_H
+#define ACHIEVEMENTRULES_H
+
+#include <QDateTime>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QPair>
+#include <QByteArray>
+#include <deque>
+#include <functional>
+
+enum class AchievementEventType {
+    SessionEnded,
+    FocusSample,
+    StreakChanged,
+    PomodoroDone,
+    DailyGoalsCompleted,
+    SurveySubmitted
+};
+
+struct AchievementEvent {
+    AchievementEventType type;
+    QDateTime at;       // when it happened; the end of a session
+    int value = 0;      // session minutes, streak days, survey satisfaction
+    double score = 0.0; // focus samples, 0..1
+    QDateTime start;    // sessions only
+};
+
+// Achievement rules compiled from a JSON definition file (see achievements.json).
+// Each rule aggregates one event stream: a count, sum or max of the event's value,
+// optionally only the session minutes between two hours, or a rolling mean of
+// focus samples over a time window. Rules on the same window share its running
+// sum and are kept sorted by threshold, so a focus sample only touches the rules
+// whose threshold the mean just crossed.
+class AchievementRules
+{
+public:
+    struct Definition {
+        QString id;
+        QString name;
+        QString description;
+        QString category;
+        QString iconPath;
+        int target = 1;
+    };
+
+    // Replaces the rules; on error the previous ones are kept
+    bool load(const QByteArray &json, QString *error = nullptr);
+    const QList<Definition> &definitions() const { return defs; }
+
+    // Forgets the focus windows, e.g. before replaying history
+    void reset();
+
+    // Feeds one event and appends (definition index, new progress) for every rule
+    // whose progress moved. progressOf returns a rule's progress before the event,
+    // or a negative value to skip the rule, e.g. once it is unlocked.
+    void evaluate(const AchievementEvent &event, const std::function<int(int rule)> &progressOf,
+                  QList<QPair<int, int>> *changes);
+
+    // How often each rule was evaluated and the time spent on it; rules on one
+    // focus window split the window's time between them
+    struct Cost {
+        qint64 evaluations = 0;
+        qint64 nanoseconds = 0;
+    };
+    Cost costOf(int rule) const { return rules[rule].cost; }
+
+private:
+    enum class Aggregate { Count, Sum, Max, RollingMean };
+    struct Rule {
+        AchievementEventType event;
+        Aggregate aggregate;
+        int fromHour = -1; // sessions: only the minutes between fromHour and toHour
+        int toHour = -1;
+        double threshold = 0.0;
+        qint64 since = -1; // rolling mean: second it last rose to the threshold
+        Cost cost;
+    };
+    struct Bucket {
+        qint64 second;
+        double sum;
+        int count;
+    };
+    struct Window {
+        qint64 seconds = 0;
+        std::deque<Bucket> buckets; // one per second with samples
+        double sum = 0.0;
+        qint64 count = 0;
+        qint64 lastSecond = -1;
+        qint64 lastMinute = -1;
+        QList<int> rules;           // ascending threshold
+        int qualifying = 0;         // rules[0, qualifying) are at or below the mean
+    };
+
+    void clearWindow(Window &window);
+    void chargeWindow(const Window &window, qint64 nanoseconds);
+    void feedWindow(Window &window, const AchievementEvent &event, const std::function<int(int)> &progressOf,
+                    QList<QPair<int, int>> *changes);
+
+    QList<Definition> defs;
+    QList<Rule> rules;                    // parallel to defs
+    QList<Window> windows;
+    QHash<int, QList<int>> subscriptions; // event type -> rules outside windows
+};
+
+#endif // ACHIEVEMENTRULES_H
@@ -2,23 +2,24 @@
 #include <QDebug>
 #include <QSqlError>
 #include <QCoreApplication>
+#include <QFile>
+#include <QCryptographicHash>
+#include <algorithm>
+
+namespace {
+// Progress is saved, and a point added to its history, at least this often while events arrive
+const qint64 kProgressFlushSecs = 60;
+}
 
 Achievement::Achievement(QSqlDatabase& db, QObject *parent)
     : QObject(parent), db(db)
 {
     loadAchievementDefinitions();
-
-    connect(this, &Achievement::sessionCompleted, this, [this]() {
-        trackFirstSession();
-    });
-
-    connect(this, &Achievement::pomodoroCompleted, this, [this]() {
-        trackFirstPomodoro();
-    });
 }
 
 Achievement::~Achievement()
 {
+    flush();
     if (db.isOpen()) {
         db.close();
     }
@@ -26,168 +27,274 @@ Achievement::~Achievement()
 
 void Achievement::loadAchievementDefinitions()
 {
-    // default achievements
-    QList<AchievementInfo> defaultAchievements = {
-        {"focus_master", "Focus Master", "Maintain 95%+ focus for 30 minutes", Category::Focus, 30, ":/icons/focus_master.png"},
-        {"streak_7", "Week Warrior", "Study for 7 consecutive days", Category::Streak, 7, ":/icons/streak_7.png"},
-        {"time_4h", "Marathon Learner", "Complete a 4-hour study session", Category::Time, 240, ":/icons/time_4h.png"},
-        {"night_owl", "Night Owl", "Study after 10 PM for 2 hours", Category::Special, 120, ":/icons/night_owl.png"},
-        {"early_bird", "Early Bird", "Study before 8 AM for 2 hours", Category::Special, 120, ":/icons/early_bird.png"},
-        {"perfect_day", "Perfect Day", "Complete all daily goals", Category::Special, 1, ":/icons/perfect_day.png"},
-        {"first_session", "First Session", "Complete your first camera session", Category::Special, 1, ":/icons/first_session.png"},
-        {"first_pomodoro", "First Pomodoro", "Complete your first Pomodoro session", Category::Special, 1, ":/icons/first_pomodoro.png"}
-    };
+    QFile file(":/achievements.json");
+    QString error;
+    const QByteArray json = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    if (ruleSet.load(json, &error)) {
+        rulesDigest = QCryptographicHash::hash(json, QCryptographicHash::Sha1).toHex();
+    } else {
+        qDebug() << "Error loading achievement rules:" << (json.isEmpty() ? file.errorString() : error);
+    }
+
+    // The file owns the definitions; the table keeps progress and unlock times
     QSqlQuery query(db);
-    for (const auto &achievement : defaultAchievements) {
-        query.prepare("INSERT OR IGNORE INTO achievements (id, name, description, category, required_value, icon_path) "
-                     "VALUES (?, ?, ?, ?, ?, ?)");
-        query.addBindValue(achievement.id);
-        query.addBindValue(achievement.name);
-        query.addBindValue(achievement.description);
-        query.addBindValue(categoryToString(achievement.category));
-        query.addBindValue(achievement.requiredValue);
-        query.addBindValue(achievement.iconPath);
-        
+    query.prepare("INSERT INTO achievements (id, name, description, category, required_value, icon_path) "
+                  "VALUES (?, ?, ?, ?, ?, ?) ON CONFLICT(id) DO UPDATE SET name = excluded.name, "
+                  "description = excluded.description, category = excluded.category, "
+                  "required_value = excluded.required_value, icon_path = excluded.icon_path");
+    achievementDefinitions.clear();
+    for (const AchievementRules::Definition &definition : ruleSet.definitions()) {
+        AchievementInfo info;
+        info.id = definition.id;
+        info.name = definition.name;
+        info.description = definition.description;
+        info.category = stringToCategory(definition.category);
+        info.requiredValue = definition.target;
+        info.iconPath = definition.iconPath;
+        achievementDefinitions[info.id] = info;
+
+        query.addBindValue(info.id);
+        query.addBindValue(info.name);
+        query.addBindValue(info.description);
+        query.addBindValue(categoryToString(info.category));
+        query.addBindValue(info.requiredValue);
+        query.addBindValue(info.iconPath);
         if (!query.exec()) {
             qDebug() << "Error inserting achievement:" << query.lastError().text();
         }
     }
 
-    query.exec("SELECT * FROM achievements");
+    achievementProgress.clear();
+    unlockedAt.clear();
+    query.exec("SELECT id, progress, unlocked_at FROM achievements");
     while (query.next()) {
-        AchievementInfo info;
-        info.id = query.value("id").toString();
-        info.name = query.value("name").toString();
-        info.description = query.value("description").toString();
-        info.category = stringToCategory(query.value("category").toString());
-        info.requiredValue = query.value("required_value").toInt();
-        info.iconPath = query.value("icon_path").toString();
-        
-        achievementDefinitions[info.id] = info;
-        achievementProgress[info.id] = query.value("progress").toInt();
+        const QString id = query.value(0).toString();
+        if (!achievementDefinitions.contains(id)) continue;
+        achievementProgress[id] = query.value(1).toInt();
+        if (!query.value(2).isNull()) {
+            unlockedAt.insert(id, QDateTime::fromString(query.value(2).toString(), "yyyy-MM-dd HH:mm:ss"));
+        }
     }
 }
 
-bool Achievement::unlockAchievement(const QString &achievementId)
+void Achievement::handleEvent(const Event &event)
 {
-    if (!achievementDefinitions.contains(achievementId)) {
-        return false;
+    QList<QPair<int, int>> changes;
+    ruleSet.evaluate(event, [this](int rule) {
+        const QString &id = ruleSet.definitions()[rule].id;
+        return unlockedAt.contains(id) ? -1 : achievementProgress.value(id);
+    }, &changes);
+
+    bool unlocked = false;
+    for (const auto &change : changes) {
+        const QString &id = ruleSet.definitions()[change.first].id;
+        updateProgress(id, change.second);
+        if (checkAchievementConditions(id)) {
+            unlocked = unlockAchievement(id) || unlocked;
+        }
+    }
+    // Unlocks are written right away; progress waits until every achievement moved or a minute passed
+    if (unlocked || dirtyProgress.size() >= ruleSet.definitions().size()
+        || QDateTime::currentSecsSinceEpoch() - lastFlushSecs >= kProgressFlushSecs) {
+        flush();
     }
+}
 
-    QSqlQuery query(db);
-    QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+bool Achievement::flush()
+{
+    lastFlushSecs = QDateTime::currentSecsSinceEpoch();
+    if (dirtyProgress.isEmpty() && pendingUnlocks.isEmpty()) return true;
+    if (!db.isOpen()) return false;
+
+    db.transaction();
+    QSqlQuery progressQuery(db);
+    progressQuery.prepare("UPDATE achievements SET progress = ? WHERE id = ?");
+    for (const QString &id : dirtyProgress) {
+        progressQuery.addBindValue(achievementProgress.value(id));
+        progressQuery.addBindValue(id);
+        if (!progressQuery.exec()) {
+            qDebug() << "Error saving achievement progress:" << progressQuery.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    // Snapshots within the same second keep the latest value
+    QSqlQuery logQuery(db);
+    logQuery.prepare("INSERT OR REPLACE INTO achievement_progress_log (achievement_id, recorded_at, progress) VALUES (?, ?, ?)");
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for (const QString &id : dirtyProgress) {
+        logQuery.addBindValue(id);
+        logQuery.addBindValue(now);
+        logQuery.addBindValue(achievementProgress.value(id));
+        if (!logQuery.exec()) {
+            qDebug() << "Error logging achievement progress:" << logQuery.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    QSqlQuery unlockQuery(db);
+    unlockQuery.prepare("UPDATE achievements SET unlocked_at = ? WHERE id = ? AND unlocked_at IS NULL");
+    for (const QString &id : pendingUnlocks) {
+        unlockQuery.addBindValue(unlockedAt.value(id).toString("yyyy-MM-dd HH:mm:ss"));
+        unlockQuery.addBindValue(id);
+        if (!unlockQuery.exec()) {
+            qDebug() << "Error unlocking achievement:" << unlockQuery.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        qDebug() << "Error committing achievements:" << db.lastError().text();
+        return false;
+    }
 
-    query.prepare("UPDATE achievements SET unlocked_at = ? WHERE id = ? AND unlocked_at IS NULL");
-    query.addBindValue(currentTime);
-    query.addBindValue(achievementId);
+    dirtyProgress.clear();
+    pendingUnlocks.clear();
+    return true;
+}
 
-    if (!query.exec()) {
-        qDebug() << "Error unlocking achievement:" << query.lastError().text();
+bool Achievement::unlockAchievement(const QString &achievementId)
+{
+    if (!achievementDefinitions.contains(achievementId) || unlockedAt.contains(achievementId)) {
         return false;
     }
 
-    if (query.numRowsAffected() > 0) {
-        emit achievementUnlocked(achievementId, achievementDefinitions[achievementId].name);
-        
-        if (getUnlockedCount() == getTotalAchievements()) {
-            emit allAchievementsUnlocked();
-        }
-        return true;
-    }
+    unlockedAt.insert(achievementId, QDateTime::currentDateTime());
+    pendingUnlocks.insert(achievementId);
+    emit achievementUnlocked(achievementId, achievementDefinitions[achievementId].name);
 
-    return false;
+    if (getUnlockedCount() == getTotalAchievements()) {
+        emit allAchievementsUnlocked();
+    }
+    return true;
 }
 
 bool Achievement::isAchievementUnlocked(const QString &achievementId) const
 {
-    QSqlQuery query(db);
-    query.prepare("SELECT unlocked_at FROM achievements WHERE id = ?");
-    query.addBindValue(achievementId);
-
-    if (query.exec() && query.next()) {
-        return !query.value(0).isNull();
-    }
-    return false;
+    return unlockedAt.contains(achievementId);
 }
 
 void Achievement::trackFocusScore(float score)
 {
-    if (score >= 0.95f) {
-        updateProgress("focus_master", 1);
-        checkAchievements();
-    }
+    handleEvent({EventType::FocusSample, QDateTime::currentDateTime(), 0, score, QDateTime()});
 }
 
 void Achievement::trackStudyTime(int minutes)
 {
-    if (minutes >= 240) {
-        updateProgress("time_4h", minutes);
-        checkAchievements();
-    }
+    const QDateTime now = QDateTime::currentDateTime();
+    trackSession(now.addSecs(-60 * qint64(minutes)), now);
+}
+
+void Achievement::trackSession(const QDateTime &start, const QDateTime &end)
+{
+    handleEvent({EventType::SessionEnded, end, int(start.secsTo(end) / 60), 0.0, start});
 }
 
 void Achievement::trackStreak(int days)
 {
-    if (days >= 7) {
-        updateProgress("streak_7", days);
-        checkAchievements();
+    handleEvent({EventType::StreakChanged, QDateTime::currentDateTime(), days, 0.0, QDateTime()});
+}
+
+void Achievement::trackPomodoro()
+{
+    handleEvent({EventType::PomodoroDone, QDateTime::currentDateTime(), 0, 0.0, QDateTime()});
+}
+
+void Achievement::trackDailyGoalsCompleted()
+{
+    handleEvent({EventType::DailyGoalsCompleted, QDateTime::currentDateTime(), 0, 0.0, QDateTime()});
+}
+
+void Achievement::trackSurvey(int satisfaction)
+{
+    handleEvent({EventType::SurveySubmitted, QDateTime::currentDateTime(), satisfaction, 0.0, QDateTime()});
+}
+
+int Achievement::mergeHistory(const QHash<QString, int> &progress, const QHash<QString, QDateTime> &earnedAt)
+{
+    for (auto it = progress.cbegin(); it != progress.cend(); ++it) {
+        if (achievementDefinitions.contains(it.key()) && !unlockedAt.contains(it.key())
+            && it.value() > achievementProgress.value(it.key())) {
+            updateProgress(it.key(), it.value());
+        }
+    }
+
+    // Historical unlocks are applied quietly; the caller reports them together
+    int unlocked = 0;
+    for (auto it = earnedAt.cbegin(); it != earnedAt.cend(); ++it) {
+        if (!achievementDefinitions.contains(it.key()) || unlockedAt.contains(it.key())) continue;
+        unlockedAt.insert(it.key(), it.value());
+        pendingUnlocks.insert(it.key());
+        ++unlocked;
+    }
+    flush();
+    if (unlocked > 0 && getUnlockedCount() == getTotalAchievements()) {
+        emit allAchievementsUnlocked();
     }
+    return unlocked;
 }
 
-void Achievement::checkAchievements()
+bool Achievement::logProgressHistory(const QHash<QString, QList<QPair<QDateTime, int>>> &history)
 {
-    QTime currentTime = QTime::currentTime();
-    
-    // Check time-based achievements
-    if (currentTime.hour() >= 22) {
-        updateProgress("night_owl", 1);
+    if (history.isEmpty()) return true;
+    if (!db.isOpen()) return false;
+
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO achievement_progress_log (achievement_id, recorded_at, progress) VALUES (?, ?, ?)");
+    for (auto it = history.cbegin(); it != history.cend(); ++it) {
+        if (!achievementDefinitions.contains(it.key())) continue;
+        for (const QPair<QDateTime, int> &point : it.value()) {
+            query.addBindValue(it.key());
+            query.addBindValue(point.first.toSecsSinceEpoch());
+            query.addBindValue(point.second);
+            if (!query.exec()) {
+                qDebug() << "Error logging achievement history:" << query.lastError().text();
+                db.rollback();
+                return false;
+            }
+        }
     }
-    if (currentTime.hour() < 8) {
-        updateProgress("early_bird", 1);
+    if (!db.commit()) {
+        qDebug() << "Error committing achievement history:" << db.lastError().text();
+        return false;
     }
+    return true;
+}
 
-    // Check all achievements for unlocking
+void Achievement::checkAchievements()
+{
+    // Unlocks anything whose stored progress already meets its requirement
+    bool unlocked = false;
     for (const auto &achievement : achievementDefinitions) {
-        if (!isAchievementUnlocked(achievement.id) && 
-            checkAchievementConditions(achievement.id)) {
-            unlockAchievement(achievement.id);
+        if (!unlockedAt.contains(achievement.id) && checkAchievementConditions(achievement.id)) {
+            unlocked = unlockAchievement(achievement.id) || unlocked;
         }
     }
+    if (unlocked) {
+        flush();
+    }
 }
 
 QList<Achievement::AchievementInfo> Achievement::getUnlockedAchievements() const
 {
     QList<AchievementInfo> unlocked;
-    QSqlQuery query(db);
-    query.prepare("SELECT id FROM achievements WHERE unlocked_at IS NOT NULL");
-
-    if (query.exec()) {
-        while (query.next()) {
-            QString id = query.value(0).toString();
-            if (achievementDefinitions.contains(id)) {
-                unlocked.append(achievementDefinitions[id]);
-            }
+    for (const auto &achievement : achievementDefinitions) {
+        if (unlockedAt.contains(achievement.id)) {
+            unlocked.append(achievement);
         }
     }
-
     return unlocked;
 }
 
 QList<Achievement::AchievementInfo> Achievement::getLockedAchievements() const
 {
     QList<AchievementInfo> locked;
-    QSqlQuery query(db);
-    query.prepare("SELECT id FROM achievements WHERE unlocked_at IS NULL");
-
-    if (query.exec()) {
-        while (query.next()) {
-            QString id = query.value(0).toString();
-            if (achievementDefinitions.contains(id)) {
-                locked.append(achievementDefinitions[id]);
-            }
+    for (const auto &achievement : achievementDefinitions) {
+        if (!unlockedAt.contains(achievement.id)) {
+            locked.append(achievement);
         }
     }
-
     return locked;
 }
 
@@ -209,13 +316,7 @@ int Achievement::getTotalAchievements() const
 
 int Achievement::getUnlockedCount() const
 {
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM achievements WHERE unlocked_at IS NOT NULL");
-    
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
-    }
-    return 0;
+    return unlockedAt.size();
 }
 
 float Achievement::getCompletionPercentage() const
@@ -231,6 +332,36 @@ int Achievement::getAchievementProgress(const QString &achievementId) const
     return achievementProgress.value(achievementId, 0);
 }
 
+QList<QPair<QDateTime, int>> Achievement::getProgressHistory(const QString &achievementId) const
+{
+    QList<QPair<QDateTime, int>> history;
+    QSqlQuery query(db);
+    query.prepare("SELECT recorded_at, progress FROM achievement_progress_log WHERE achievement_id = ? ORDER BY recorded_at");
+    query.addBindValue(achievementId);
+    if (!query.exec()) {
+        qDebug() << "Error loading achievement progress history:" << query.lastError().text();
+        return history;
+    }
+    while (query.next()) {
+        history.append({QDateTime::fromSecsSinceEpoch(query.value(0).toLongLong()), query.value(1).toInt()});
+    }
+    return history;
+}
+
+QList<Achievement::RuleCost> Achievement::getRuleCosts() const
+{
+    QList<RuleCost> costs;
+    const QList<AchievementRules::Definition> &definitions = ruleSet.definitions();
+    for (int i = 0; i < definitions.size(); ++i) {
+        const AchievementRules::Cost cost = ruleSet.costOf(i);
+        costs.append({definitions[i].id, definitions[i].name, cost.evaluations, cost.nanoseconds});
+    }
+    std::sort(costs.begin(), costs.end(), [](const RuleCost &a, const RuleCost &b) {
+        return a.nanoseconds > b.nanoseconds;
+    });
+    return costs;
+}
+
 bool Achievement::checkAchievementConditions(const QString &achievementId)
 {
     if (!achievementDefinitions.contains(achievementId)) {
@@ -249,15 +380,9 @@ void Achievement::updateProgress(const QString &achievementId, int progress)
         return;
     }
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE achievements SET progress = ? WHERE id = ?");
-    query.addBindValue(progress);
-    query.addBindValue(achievementId);
-
-    if (query.exec()) {
-        achievementProgress[achievementId] = progress;
-        emit progressUpdated(achievementId, progress);
-    }
+    achievementProgress[achievementId] = progress;
+    dirtyProgress.insert(achievementId);
+    emit progressUpdated(achievementId, progress);
 }
 
 QString Achievement::categoryToString(Category category) const
@@ -280,24 +405,9 @@ Achievement::Category Achievement::stringToCategory(const QString &category) con
     return Category::Special; // Default category
 }
 
-void Achievement::trackFirstSession()
-{
-    if (!isAchievementUnlocked("first_session")) {
-        updateProgress("first_session", 1);
-        checkAchievements();
-    }
-}
-
-void Achievement::trackFirstPomodoro()
-{
-    if (!isAchievementUnlocked("first_pomodoro")) {
-        updateProgress("first_pomodoro", 1);
-        checkAchievements();
-    }
-}
-
 bool Achievement::initializeAchievements()
 {
+    flush();
     loadAchievementDefinitions();
     return true;
 } 
@@ -7,6 +7,9 @@
 #include <QDateTime>
 #include <QString>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include "achievementrules.h"
 
 class Achievement : public QObject
 {
@@ -39,11 +42,34 @@ public:
         QString iconPath;
     };
 
+    // Achievement Events
+    using EventType = AchievementEventType;
+    using Event = AchievementEvent;
+
+    // Only the rules on the event's stream are evaluated
+    void handleEvent(const Event &event);
+
     // Achievement Tracking
     void trackFocusScore(float score);
     void trackStudyTime(int minutes);
+    void trackSession(const QDateTime &start, const QDateTime &end);
     void trackStreak(int days);
+    void trackPomodoro();
+    void trackDailyGoalsCompleted();
+    void trackSurvey(int satisfaction);
     void checkAchievements();
+
+    // Progress and unlocks are buffered in memory; call flush() before the database closes
+    bool flush();
+
+    // The compiled rules and a digest of the file they came from, for replaying history
+    const AchievementRules &rules() const { return ruleSet; }
+    QByteArray rulesFingerprint() const { return rulesDigest; }
+    // Raises progress to what a replay of history reached and unlocks what it earned,
+    // stamped with when it was earned; returns the number of new unlocks
+    int mergeHistory(const QHash<QString, int> &progress, const QHash<QString, QDateTime> &earnedAt);
+    // Adds replayed progress to the saved history at the times it was reached
+    bool logProgressHistory(const QHash<QString, QList<QPair<QDateTime, int>>> &history);
     
     // Achievement Retrieval
     QList<AchievementInfo> getUnlockedAchievements() const;
@@ -55,26 +81,39 @@ public:
     int getUnlockedCount() const;
     float getCompletionPercentage() const;
     int getAchievementProgress(const QString &achievementId) const;
+    // Saved progress over time, oldest first
+    QList<QPair<QDateTime, int>> getProgressHistory(const QString &achievementId) const;
+
+    // Evaluation counts and time per rule this run, most expensive first
+    struct RuleCost {
+        QString id;
+        QString name;
+        qint64 evaluations;
+        qint64 nanoseconds;
+    };
+    QList<RuleCost> getRuleCosts() const;
 
 signals:
     void achievementUnlocked(const QString &achievementId, const QString &name);
     void progressUpdated(const QString &achievementId, int progress);
     void allAchievementsUnlocked();
-    void sessionCompleted();
-    void pomodoroCompleted();
 
 private:
     QSqlDatabase& db;
+    AchievementRules ruleSet; // definitions and rules from achievements.json
+    QByteArray rulesDigest;
     QMap<QString, AchievementInfo> achievementDefinitions;
     QMap<QString, int> achievementProgress;
+    QHash<QString, QDateTime> unlockedAt;
+    QSet<QString> dirtyProgress;
+    QSet<QString> pendingUnlocks;
+    qint64 lastFlushSecs = 0;
     
     void loadAchievementDefinitions();
     bool checkAchievementConditions(const QString &achievementId);
     void updateProgress(const QString &achievementId, int progress);
     QString categoryToString(Category category) const;
     Category stringToCategory(const QString &category) const;
-    void trackFirstSession();
-    void trackFirstPomodoro();
 };
 
 Q_DECLARE_METATYPE(Achievement::AchievementInfo)
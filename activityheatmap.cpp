@@ -0,0 +1,190 @@
+#include "activityheatmap.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QLocale>
+
+namespace {
+const int kCell = 16;
+const int kGap = 3;
+const int kStep = kCell + kGap;
+const int kLeftMargin = 40;  // weekday labels
+const int kHeaderHeight = 20; // year and month labels
+const int kYearGap = 14;
+const int kWeeks = 54;        // a leap year starting on Sunday touches 54 weeks
+const int kYearHeight = kHeaderHeight + 7 * kStep + kYearGap;
+
+// Column of a date within its year's block; week 0 holds January 1st
+int weekColumn(const QDate &date)
+{
+    const int offset = QDate(date.year(), 1, 1).dayOfWeek() - 1;
+    return (offset + date.dayOfYear() - 1) / 7;
+}
+}
+
+ActivityHeatmap::ActivityHeatmap(QWidget *parent)
+    : QWidget(parent),
+      m_lastYear(QDate::currentDate().year())
+{
+    setMouseTracking(true);
+}
+
+void ActivityHeatmap::setYearData(int year, const QVector<int> &minutesPerDay)
+{
+    m_years.insert(year, minutesPerDay);
+    if (year <= m_lastYear && year > m_lastYear - m_yearCount) invalidate();
+}
+
+void ActivityHeatmap::clearData()
+{
+    m_years.clear();
+    invalidate();
+}
+
+void ActivityHeatmap::setShownYears(int lastYear, int yearCount)
+{
+    yearCount = qMax(1, yearCount);
+    if (lastYear == m_lastYear && yearCount == m_yearCount) return;
+    const bool resized = yearCount != m_yearCount;
+    m_lastYear = lastYear;
+    m_yearCount = yearCount;
+    if (resized) updateGeometry();
+    invalidate();
+}
+
+int ActivityHeatmap::studyDayCount() const
+{
+    int days = 0;
+    for (int year = m_lastYear - m_yearCount + 1; year <= m_lastYear; ++year) {
+        for (int minutes : m_years.value(year)) {
+            if (minutes > 0) ++days;
+        }
+    }
+    return days;
+}
+
+QSize ActivityHeatmap::sizeHint() const
+{
+    return QSize(kLeftMargin + kWeeks * kStep, m_yearCount * kYearHeight);
+}
+
+QColor ActivityHeatmap::colorForMinutes(int minutes)
+{
+    // White (no study), light red (few minutes), dark red (many minutes)
+    if (minutes <= 0) return QColor("#eee");
+    if (minutes < 15) return QColor("#ffb3b3");
+    if (minutes < 30) return QColor("#ff6666");
+    if (minutes < 60) return QColor("#ff1a1a");
+    if (minutes < 120) return QColor("#c3073f");
+    return QColor("#800000");
+}
+
+int ActivityHeatmap::minutesOn(const QDate &date) const
+{
+    auto year = m_years.constFind(date.year());
+    if (year == m_years.constEnd()) return 0;
+    return year->value(date.dayOfYear() - 1, 0);
+}
+
+QDate ActivityHeatmap::dateAt(const QPoint &pos) const
+{
+    const int block = pos.y() / kYearHeight;
+    const int yInBlock = pos.y() % kYearHeight - kHeaderHeight;
+    const int x = pos.x() - kLeftMargin;
+    if (block < 0 || block >= m_yearCount || yInBlock < 0 || x < 0) return QDate();
+    // Gaps between cells are not part of any day
+    if (x % kStep >= kCell || yInBlock % kStep >= kCell) return QDate();
+    const int week = x / kStep;
+    const int row = yInBlock / kStep;
+    if (row >= 7) return QDate();
+
+    const int year = m_lastYear - block;
+    const QDate first(year, 1, 1);
+    const QDate date = first.addDays(week * 7 + row - (first.dayOfWeek() - 1));
+    return date.year() == year ? date : QDate();
+}
+
+void ActivityHeatmap::invalidate()
+{
+    m_cacheValid = false;
+    update();
+}
+
+void ActivityHeatmap::renderCache()
+{
+    const qreal ratio = devicePixelRatioF();
+    m_cache = QPixmap(size() * ratio);
+    m_cache.setDevicePixelRatio(ratio);
+    m_cache.fill(Qt::transparent);
+
+    QPainter painter(&m_cache);
+    painter.setRenderHint(QPainter::Antialiasing);
+    const QLocale locale = QLocale::system();
+    const QColor textColor = palette().color(QPalette::WindowText);
+
+    for (int block = 0; block < m_yearCount; ++block) {
+        const int year = m_lastYear - block;
+        const int top = block * kYearHeight;
+
+        // Year, month and weekday labels
+        painter.setPen(textColor);
+        painter.drawText(QRect(0, top, kLeftMargin - 4, kHeaderHeight), Qt::AlignLeft | Qt::AlignVCenter, QString::number(year));
+        for (int month = 1; month <= 12; ++month) {
+            const int x = kLeftMargin + weekColumn(QDate(year, month, 1)) * kStep;
+            painter.drawText(QRect(x, top, 4 * kStep, kHeaderHeight), Qt::AlignLeft | Qt::AlignVCenter,
+                             locale.monthName(month, QLocale::ShortFormat));
+        }
+        for (int row = 0; row < 7; row += 2) {
+            painter.drawText(QRect(0, top + kHeaderHeight + row * kStep, kLeftMargin - 6, kCell),
+                             Qt::AlignRight | Qt::AlignVCenter, locale.dayName(row + 1, QLocale::ShortFormat));
+        }
+
+        // Day cells
+        painter.setPen(Qt::NoPen);
+        const QDate last(year, 12, 31);
+        for (QDate date(year, 1, 1); date <= last; date = date.addDays(1)) {
+            const QRectF cell(kLeftMargin + weekColumn(date) * kStep,
+                              top + kHeaderHeight + (date.dayOfWeek() - 1) * kStep, kCell, kCell);
+            painter.setBrush(colorForMinutes(minutesOn(date)));
+            painter.drawRoundedRect(cell, 3, 3);
+        }
+    }
+    m_cacheValid = true;
+}
+
+void ActivityHeatmap::paintEvent(QPaintEvent *event)
+{
+    if (!m_cacheValid || m_cache.size() != size() * devicePixelRatioF()) {
+        renderCache();
+    }
+    QPainter painter(this);
+    painter.setClipRect(event->rect());
+    painter.drawPixmap(0, 0, m_cache);
+}
+
+bool ActivityHeatmap::event(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        QHelpEvent *help = static_cast<QHelpEvent *>(event);
+        const QDate date = dateAt(help->pos());
+        if (date.isValid()) {
+            QToolTip::showText(help->globalPos(),
+                               QString("%1\n%2 minutes studied").arg(date.toString("yyyy-MM-dd")).arg(minutesOn(date)), this);
+        } else {
+            QToolTip::hideText();
+            event->ignore();
+        }
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+void ActivityHeatmap::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::PaletteChange || event->type() == QEvent::FontChange
+        || event->type() == QEvent::StyleChange) {
+        invalidate();
+    }
+    QWidget::changeEvent(event);
+}
@@ -0,0 +1,54 @@
+#ifndef ACTIVITYHEATMAP_H
+#define ACTIVITYHEATMAP_H
+
+#include <QWidget>
+#include <QDate>
+#include <QHash>
+#include <QVector>
+#include <QPixmap>
+
+// Yearly study heatmap: one column per calendar week, Monday on top, one block per
+// year. Painted from per-day minute arrays into a cached pixmap; tooltips come from
+// hit-testing instead of a widget per day.
+class ActivityHeatmap : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ActivityHeatmap(QWidget *parent = nullptr);
+
+    // minutesPerDay[i] is the study time on day i + 1 of the year
+    void setYearData(int year, const QVector<int> &minutesPerDay);
+    bool hasYearData(int year) const { return m_years.contains(year); }
+    void clearData();
+
+    // Shows yearCount years ending with lastYear, newest at the top
+    void setShownYears(int lastYear, int yearCount = 1);
+    int lastYear() const { return m_lastYear; }
+    int yearCount() const { return m_yearCount; }
+
+    // Days with any study time among the shown years
+    int studyDayCount() const;
+
+    QSize sizeHint() const override;
+    static QColor colorForMinutes(int minutes);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    bool event(QEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private:
+    QDate dateAt(const QPoint &pos) const;
+    int minutesOn(const QDate &date) const;
+    void renderCache();
+    void invalidate();
+
+    QHash<int, QVector<int>> m_years;
+    int m_lastYear;
+    int m_yearCount = 1;
+    QPixmap m_cache;
+    bool m_cacheValid = false;
+};
+
+#endif // ACTIVITYHEATMAP_H
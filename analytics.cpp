@@ -1,8 +1,12 @@
 #include "analytics.h"
+#include "downsampler.h"
+#include "statistics.h"
+#include "focussketches.h"
 #include <QSqlError>
 #include <QDebug>
 #include <QtMath>
 #include <QDateTime>
+#include <QLocale>
 #include <QSqlRecord>
 #include <QDateTimeAxis>
 #include <QtCharts/QBarSeries>
@@ -11,6 +15,26 @@
 #include <QtCharts/QPieSeries>
 #include <QColor>
 #include <QtCharts/QLegendMarker>
+
+namespace {
+// QList is contiguous, but its iterators are not guaranteed to model
+// std::contiguous_iterator on every Qt 6 release
+std::span<const float> asSpan(const QList<float> &list)
+{
+    return std::span<const float>(list.constData(), list.size());
+}
+
+QList<double> digestQuantiles(const TDigest &digest, const QList<double> &quantiles)
+{
+    QList<double> result;
+    if (digest.isEmpty()) return result;
+    for (double q : quantiles) {
+        result.append(digest.quantile(q));
+    }
+    return result;
+}
+}
+
 StudyAnalytics::StudyAnalytics(QSqlDatabase &database, QObject *parent)
     : QObject(parent),
       db(database)
@@ -44,7 +68,7 @@ void StudyAnalytics::loadHistoricalData(const QDate &startDate, const QDate &end
     }
 }
 
-QChart* StudyAnalytics::createFocusChart(const QDate &startDate, const QDate &endDate)
+QChart* StudyAnalytics::createFocusChart(const QDate &startDate, const QDate &endDate, int pixelWidth)
 {
     QChart *chart = new QChart();
     QLineSeries *series = new QLineSeries();
@@ -56,16 +80,15 @@ QChart* StudyAnalytics::createFocusChart(const QDate &startDate, const QDate &en
     if (!query.exec()) {
         qDebug() << "Focus chart query failed:" << query.lastError().text();
     }
-    int count = 0;
+    QList<QPointF> points;
     while (query.next()) {
         QString day = query.value(0).toString();
         float avgFocus = query.value(1).toFloat();
-        qDebug() << "FocusChart day:" << day << "avgFocus:" << avgFocus;
         QDate date = QDate::fromString(day, "yyyy-MM-dd");
-        series->append(QDateTime(date, QTime(0,0)).toMSecsSinceEpoch(), avgFocus * 100); // percent
-        count++;
+        points.append(QPointF(QDateTime(date, QTime(0,0)).toMSecsSinceEpoch(), avgFocus * 100)); // percent
     }
-    if (count == 0) qDebug() << "Focus chart: no data for selected range.";
+    if (points.isEmpty()) qDebug() << "Focus chart: no data for selected range.";
+    Downsampler::setSeriesPoints(series, points, pixelWidth);
     chart->addSeries(series);
     chart->setTitle("Focus Score Over Time");
     QDateTimeAxis *axisX = new QDateTimeAxis();
@@ -86,7 +109,7 @@ QChart* StudyAnalytics::createFocusChart(const QDate &startDate, const QDate &en
     return chart;
 }
 
-QChart* StudyAnalytics::createProductivityChart(const QDate &startDate, const QDate &endDate)
+QChart* StudyAnalytics::createProductivityChart(const QDate &startDate, const QDate &endDate, int pixelWidth)
 {
     QChart *chart = new QChart();
     QLineSeries *series = new QLineSeries();
@@ -102,18 +125,19 @@ QChart* StudyAnalytics::createProductivityChart(const QDate &startDate, const QD
     while (query.next()) {
         QString day = query.value(0).toString();
         int detectionsCount = query.value(1).toInt();
-        qDebug() << "ProductivityChart day:" << day << "detectionsCount:" << detectionsCount;
         QDate date = QDate::fromString(day, "yyyy-MM-dd");
         detectionsPerDay[date] = detectionsCount;
     }
     // Fill in zeros for days with no data
+    QList<QPointF> points;
     QDate d = startDate;
     while (d <= endDate) {
         int count = detectionsPerDay.value(d, 0);
-        series->append(QDateTime(d, QTime(0, 0)).toMSecsSinceEpoch(), count);
+        points.append(QPointF(QDateTime(d, QTime(0, 0)).toMSecsSinceEpoch(), count));
         d = d.addDays(1);
     }
-    if (series->count() == 0) qDebug() << "Productivity chart: no data for selected range.";
+    if (points.isEmpty()) qDebug() << "Productivity chart: no data for selected range.";
+    Downsampler::setSeriesPoints(series, points, pixelWidth);
     chart->addSeries(series);
     chart->setTitle("Study Detections Over Time"); 
     QDateTimeAxis *axisX = new QDateTimeAxis();
@@ -141,28 +165,50 @@ QMap<QString, float> StudyAnalytics::getFocusPatterns() const
     QMap<QString, float> patterns;
 
     for (auto it = focusHistory.begin(); it != focusHistory.end(); ++it) {
-        float sum = 0;
-        for (float score : it.value()) {
-            sum += score;
-        }
-        patterns[it.key()] = sum / it.value().size();
+        patterns[it.key()] = float(Statistics::mean(asSpan(it.value())));
     }
     return patterns;
 }
 
 float StudyAnalytics::getAverageFocusScore() const
 {
-    float total = 0;
-    int count = 0;
-    
+    double total = 0;
+    qsizetype count = 0;
+
     for (const auto &scores : focusHistory) {
-        for (float score : scores) {
-            total += score;
-            count++;
-        }
+        total += Statistics::sum(asSpan(scores));
+        count += scores.size();
     }
-    
-    return count > 0 ? total / count : 0;
+
+    return count > 0 ? float(total / count) : 0;
+}
+
+void StudyAnalytics::setFocusSketches(FocusSketchStore *store)
+{
+    focusSketches = store;
+}
+
+QList<double> StudyAnalytics::getFocusQuantiles(const QDate &startDate, const QDate &endDate, const QList<double> &quantiles) const
+{
+    if (!focusSketches) return QList<double>();
+    return digestQuantiles(focusSketches->rangeSketch(startDate, endDate), quantiles);
+}
+
+QMap<int, QList<double>> StudyAnalytics::getHourlyFocusQuantiles(const QDate &startDate, const QDate &endDate, const QList<double> &quantiles) const
+{
+    QMap<int, QList<double>> result;
+    if (!focusSketches) return result;
+    const QMap<int, TDigest> sketches = focusSketches->hourOfDaySketches(startDate, endDate);
+    for (auto it = sketches.begin(); it != sketches.end(); ++it) {
+        result[it.key()] = digestQuantiles(it.value(), quantiles);
+    }
+    return result;
+}
+
+QList<double> StudyAnalytics::getSubjectFocusQuantiles(const QString &subject, const QList<double> &quantiles) const
+{
+    if (!focusSketches) return QList<double>();
+    return digestQuantiles(focusSketches->subjectSketch(subject), quantiles);
 }
 
 int StudyAnalytics::getMostProductiveHour() const
@@ -202,39 +248,16 @@ QMap<QString, float> StudyAnalytics::predictOptimalStudyTimes() const
 
 QList<float> StudyAnalytics::calculateMovingAverage(const QList<float> &data, int window) const
 {
-    QList<float> result;
-    for (int i = 0; i <= data.size() - window; ++i) {
-        float sum = 0;
-        for (int j = 0; j < window; ++j) {
-            sum += data[i + j];
-        }
-        result.append(sum / window);
+    if (window <= 0) {
+        return QList<float>();
     }
-    return result;
+    std::vector<float> averages = Statistics::movingAverage(asSpan(data), window);
+    return QList<float>(averages.begin(), averages.end());
 }
 
 float StudyAnalytics::calculateCorrelation(const QList<float> &x, const QList<float> &y) const
 {
-    if (x.size() != y.size() || x.isEmpty()) {
-        return 0;
-    }
-    
-    float sumX = 0, sumY = 0, sumXY = 0;
-    float sumX2 = 0, sumY2 = 0;
-    int n = x.size();
-    
-    for (int i = 0; i < n; ++i) {
-        sumX += x[i];
-        sumY += y[i];
-        sumXY += x[i] * y[i];
-        sumX2 += x[i] * x[i];
-        sumY2 += y[i] * y[i];
-    }
-    
-    float numerator = n * sumXY - sumX * sumY;
-    float denominator = qSqrt((n * sumX2 - sumX * sumX) * (n * sumY2 - sumY * sumY));
-    
-    return denominator != 0 ? numerator / denominator : 0;
+    return float(Statistics::correlation(asSpan(x), asSpan(y)));
 }
 
 QString StudyAnalytics::formatTimeRange(int hour) const
@@ -296,6 +319,29 @@ void StudyAnalytics::analyzePatterns(const QDate &startDate, const QDate &endDat
         emit productivityInsight(QString("Most productive hour: %1:00").arg(mostProductiveHour));
     }
 
+    // Focus distribution insight: p10 shows whether an hour is reliably good, not just good on average
+    QList<double> rangeQuantiles = getFocusQuantiles(startDate, endDate, {0.1, 0.5, 0.9});
+    if (rangeQuantiles.size() == 3) {
+        emit productivityInsight(QString("Median focus: %1% (p10 %2%, p90 %3%)")
+                                     .arg(qRound(rangeQuantiles[1] * 100))
+                                     .arg(qRound(rangeQuantiles[0] * 100))
+                                     .arg(qRound(rangeQuantiles[2] * 100)));
+    }
+    QMap<int, QList<double>> hourlyQuantiles = getHourlyFocusQuantiles(startDate, endDate, {0.1});
+    int reliableHour = -1;
+    double bestLowQuantile = 0;
+    for (auto it = hourlyQuantiles.begin(); it != hourlyQuantiles.end(); ++it) {
+        if (!it.value().isEmpty() && it.value().first() > bestLowQuantile) {
+            bestLowQuantile = it.value().first();
+            reliableHour = it.key();
+        }
+    }
+    if (reliableHour >= 0) {
+        emit productivityInsight(QString("Most reliable focus: %1 (9 in 10 moments above %2%)")
+                                     .arg(formatTimeRange(reliableHour))
+                                     .arg(qRound(bestLowQuantile * 100)));
+    }
+
     // Neglected subjects insight
     QStringList neglected = getNeglectedSubjects(7, endDate); // 7 days
     if (!neglected.isEmpty()) {
@@ -347,40 +393,22 @@ void StudyAnalytics::analyzePatterns(const QDate &startDate, const QDate &endDat
         }
     }
 
-    // Distraction pattern insight
-    QMap<QString, QMap<QString, int>> distractionByDay; // distraction -> day -> count
+    // Distraction pattern insight: the most reported distraction and weekday pair
     QSqlQuery surveyQ(db);
-    surveyQ.prepare("SELECT timestamp, distractions FROM surveys WHERE timestamp BETWEEN ? AND ?");
-    surveyQ.addBindValue(startDate.toString("yyyy-MM-dd"));
-    surveyQ.addBindValue(endDate.toString("yyyy-MM-dd"));
-    if (surveyQ.exec()) {
-        while (surveyQ.next()) {
-            QString ts = surveyQ.value(0).toString();
-            QString distractions = surveyQ.value(1).toString();
-            QDateTime dt = QDateTime::fromString(ts, "yyyy-MM-ddTHH:mm:ss");
-            if (!dt.isValid()) dt = QDateTime::fromString(ts, "yyyy-MM-dd HH:mm:ss");
-            QString day = dt.date().toString("dddd");
-            for (const QString& d : distractions.split(",", Qt::SkipEmptyParts)) {
-                QString trimmed = d.trimmed();
-                if (!trimmed.isEmpty())
-                    distractionByDay[trimmed][day]++;
-            }
-        }
-        QString topDistraction;
-        QString topDay;
-        int maxCount = 0;
-        for (auto it = distractionByDay.begin(); it != distractionByDay.end(); ++it) {
-            for (auto dayIt = it.value().begin(); dayIt != it.value().end(); ++dayIt) {
-                if (dayIt.value() > maxCount) {
-                    maxCount = dayIt.value();
-                    topDistraction = it.key();
-                    topDay = dayIt.key();
-                }
-            }
-        }
-        if (!topDistraction.isEmpty() && !topDay.isEmpty()) {
-            emit patternDetected(QString("You report '%1' as a distraction most on %2.").arg(topDistraction, topDay));
-        }
+    surveyQ.prepare("SELECT t.name, c.weekday FROM ("
+                    "SELECT sd.distraction_id AS id, CAST(strftime('%w', s.ts, 'unixepoch', 'localtime') AS INTEGER) AS weekday, COUNT(*) AS n "
+                    "FROM surveys s JOIN survey_distractions sd ON sd.survey_id = s.id "
+                    "WHERE s.ts >= ? AND s.ts < ? GROUP BY sd.distraction_id, weekday) c "
+                    "JOIN distraction_types t ON t.id = c.id ORDER BY c.n DESC, t.name LIMIT 1");
+    surveyQ.addBindValue(QDateTime(startDate, QTime(0, 0)).toSecsSinceEpoch());
+    surveyQ.addBindValue(QDateTime(endDate.addDays(1), QTime(0, 0)).toSecsSinceEpoch());
+    if (!surveyQ.exec()) {
+        qDebug() << "Distraction pattern query failed:" << surveyQ.lastError().text();
+    } else if (surveyQ.next()) {
+        // strftime counts weekdays from Sunday = 0
+        const int weekday = surveyQ.value(1).toInt();
+        const QString topDay = QLocale().dayName(weekday == 0 ? 7 : weekday);
+        emit patternDetected(QString("You report '%1' as a distraction most on %2.").arg(surveyQ.value(0).toString(), topDay));
     }
 
     emit analyticsUpdated();
@@ -508,25 +536,21 @@ QChart* StudyAnalytics::createDistractionBarChart(const QDate &startDate, const
     set->setColor(QColor("#C3073F"));
     set->setBrush(QColor("#C3073F"));
     QStringList categories;
-    QMap<QString, int> distractionCounts;
+    // Counted by distraction code; names are only joined onto the totals
     QSqlQuery query(db);
-    query.prepare("SELECT distractions FROM surveys WHERE timestamp BETWEEN ? AND ?");
-    query.addBindValue(startDate.toString("yyyy-MM-dd"));
-    query.addBindValue(endDate.toString("yyyy-MM-dd"));
+    query.prepare("SELECT t.name, c.n FROM ("
+                  "SELECT sd.distraction_id AS id, COUNT(*) AS n FROM surveys s "
+                  "JOIN survey_distractions sd ON sd.survey_id = s.id WHERE s.ts >= ? AND s.ts < ? GROUP BY sd.distraction_id) c "
+                  "JOIN distraction_types t ON t.id = c.id ORDER BY t.name");
+    // Whole days, end date included
+    query.addBindValue(QDateTime(startDate, QTime(0, 0)).toSecsSinceEpoch());
+    query.addBindValue(QDateTime(endDate.addDays(1), QTime(0, 0)).toSecsSinceEpoch());
     if (!query.exec()) {
         qDebug() << "Distraction bar chart query failed:" << query.lastError().text();
     }
     while (query.next()) {
-        QString distractions = query.value(0).toString();
-        for (const QString& d : distractions.split(",", Qt::SkipEmptyParts)) {
-            QString trimmed = d.trimmed();
-            if (!trimmed.isEmpty())
-                distractionCounts[trimmed]++;
-        }
-    }
-    for (auto it = distractionCounts.begin(); it != distractionCounts.end(); ++it) {
-        categories << it.key();
-        *set << it.value();
+        categories << query.value(0).toString();
+        *set << query.value(1).toInt();
     }
     if (categories.isEmpty()) {
         categories << "No Data";
@@ -13,6 +13,8 @@
 #include <QCategoryAxis>
 #include <QDateTimeAxis>
 
+class FocusSketchStore;
+
 class StudyAnalytics : public QObject
 {
     Q_OBJECT
@@ -22,8 +24,9 @@ public:
     ~StudyAnalytics();
 
     // Chart Generation
-    QChart* createFocusChart(const QDate &startDate, const QDate &endDate);
-    QChart* createProductivityChart(const QDate &startDate, const QDate &endDate);
+    // pixelWidth is the width of the view the chart goes into; series are downsampled to it
+    QChart* createFocusChart(const QDate &startDate, const QDate &endDate, int pixelWidth = 0);
+    QChart* createProductivityChart(const QDate &startDate, const QDate &endDate, int pixelWidth = 0);
     QChart* createGoalCompletionChart(const QDate &startDate, const QDate &endDate);
     QChart* createSubjectTimeChart(const QDate &startDate, const QDate &endDate);
     QChart* createDistractionBarChart(const QDate &startDate, const QDate &endDate);
@@ -37,6 +40,11 @@ public:
 
     // Statistics
     float getAverageFocusScore() const;
+    // Quantiles (q in [0, 1]) of focus scores, answered from the t-digest sketches
+    void setFocusSketches(FocusSketchStore *store);
+    QList<double> getFocusQuantiles(const QDate &startDate, const QDate &endDate, const QList<double> &quantiles) const;
+    QMap<int, QList<double>> getHourlyFocusQuantiles(const QDate &startDate, const QDate &endDate, const QList<double> &quantiles) const;
+    QList<double> getSubjectFocusQuantiles(const QString &subject, const QList<double> &quantiles) const;
     int getMostProductiveHour() const;
     QString getMostProductiveDay() const;
    
@@ -58,6 +66,7 @@ private:
     QSqlDatabase &db;
     QMap<QString, QList<float>> focusHistory;
     QMap<QString, QList<int>> productivityHistory;
+    FocusSketchStore *focusSketches = nullptr;
 
     bool initializeDatabase();
     void loadHistoricalData(const QDate &startDate, const QDate &endDate);
@@ -0,0 +1,251 @@
+// Times the public query methods of the data classes against a studybuddy.db
+// (typically one made by dbgen) and writes the results as JSON so runs can be
+// compared over time. Build with dbbench.pro.
+#include "../database.h"
+#include "../studygoals.h"
+#include "../streak.h"
+#include "../achievements.h"
+#include "../survey.h"
+#include "../studysession.h"
+#include "../analytics.h"
+#include "../focussketches.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+struct Benchmark {
+    QString group;
+    QString name;
+    std::function<void()> run;
+};
+
+bool verbose = false;
+
+void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    // The data classes log every query; keep the benchmark output readable
+    if (type == QtDebugMsg && !verbose) return;
+    Q_UNUSED(context);
+    QTextStream(stderr) << message << "\n";
+}
+
+QVariant scalar(QSqlDatabase &db, const QString &sql)
+{
+    QSqlQuery query(db);
+    if (!query.exec(sql) || !query.next()) return QVariant();
+    return query.value(0);
+}
+
+QJsonObject timeBenchmark(const Benchmark &benchmark, int iterations)
+{
+    benchmark.run(); // warm the page cache and Qt's prepared statement cache
+
+    QList<double> samples;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        benchmark.run();
+        samples.append(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0;
+    for (double ms : samples) total += ms;
+    const qsizetype mid = samples.size() / 2;
+    const double median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+
+    QJsonObject result;
+    result["group"] = benchmark.group;
+    result["name"] = benchmark.name;
+    result["iterations"] = iterations;
+    result["min_ms"] = samples.first();
+    result["median_ms"] = median;
+    result["mean_ms"] = total / samples.size();
+    result["max_ms"] = samples.last();
+    return result;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // Charts need a GUI application, but nothing is shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dbbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks StudyBuddy's database queries.");
+    parser.addHelpOption();
+    QCommandLineOption dbOption({"d", "db"}, "Database to benchmark; it is copied first and never modified.", "file", "studybuddy.db");
+    QCommandLineOption outputOption({"o", "output"}, "Write JSON results to this file instead of stdout.", "file");
+    QCommandLineOption iterationsOption({"n", "iterations"}, "Timed runs per benchmark.", "n", "5");
+    QCommandLineOption daysOption("days", "Length of the date ranges queried, ending at the latest data.", "n", "30");
+    QCommandLineOption filterOption("filter", "Only run benchmarks whose group or name contains this text.", "text");
+    QCommandLineOption verboseOption("verbose", "Show the data classes' debug output.");
+    parser.addOptions({dbOption, outputOption, iterationsOption, daysOption, filterOption, verboseOption});
+    parser.process(app);
+
+    verbose = parser.isSet(verboseOption);
+    qInstallMessageHandler(messageHandler);
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const int days = qMax(1, parser.value(daysOption).toInt());
+    const QString filter = parser.value(filterOption);
+
+    // Some methods write (recurring goal catch-up, achievement seeding), so work on a copy
+    const QString source = parser.value(dbOption);
+    QTemporaryDir workDir;
+    const QString dbPath = workDir.filePath("studybuddy.db");
+    if (!workDir.isValid() || !QFile::copy(source, dbPath)) {
+        QTextStream(stderr) << "Cannot copy " << source << " to a temporary directory\n";
+        return 1;
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "dbbench");
+    db.setDatabaseName(dbPath);
+    QString error;
+    if (!db.open() || !Database::createSchema(db, &error)) {
+        QTextStream(stderr) << "Cannot open " << source << ": " << db.lastError().text() << error << "\n";
+        return 1;
+    }
+
+    // Representative keys taken from the data itself
+    QDate endDate = QDate::fromString(scalar(db, "SELECT MAX(date(timestamp)) FROM detections").toString(), Qt::ISODate);
+    if (!endDate.isValid()) endDate = QDate::currentDate();
+    const QDate startDate = endDate.addDays(1 - days);
+    const int goalId = scalar(db, "SELECT id FROM goals WHERE completed_minutes > 0 ORDER BY id DESC LIMIT 1").toInt();
+    const QString subject = scalar(db, QString("SELECT subject FROM goals WHERE id = %1").arg(goalId)).toString();
+    const int surveyGoalId = scalar(db, "SELECT goal_id FROM surveys ORDER BY id DESC LIMIT 1").toInt();
+    const int sessionId = scalar(db, "SELECT MAX(id) FROM study_sessions").toInt();
+
+    QJsonObject rowCounts;
+    for (const QString &table : {"detections", "goals", "goal_resources", "goal_prerequisites", "study_sessions", "session_goals",
+                                 "surveys", "study_streaks", "achievements"}) {
+        rowCounts[table] = scalar(db, QString("SELECT COUNT(*) FROM %1").arg(table)).toLongLong();
+    }
+
+    StudyGoal studyGoal(db);
+    StudyStreak studyStreak(db);
+    Achievement achievement(db);
+    Survey survey(db);
+    StudySession studySession(db);
+    StudyAnalytics analytics(db);
+    FocusSketchStore focusSketches(db);
+    achievement.initializeAchievements();
+    studyStreak.initializeStreaks();
+    focusSketches.rebuildFromDetections();
+    analytics.setFocusSketches(&focusSketches);
+    const QList<double> quantiles = {0.1, 0.5, 0.9};
+    const int chartWidth = 800;
+
+    const QList<Benchmark> benchmarks = {
+        {"StudyGoal", "getGoalsForDate", [&] { studyGoal.getGoalsForDate(endDate); }},
+        {"StudyGoal", "getGoalsForSubject", [&] { studyGoal.getGoalsForSubject(subject); }},
+        {"StudyGoal", "getGoalDetails", [&] { studyGoal.getGoalDetails(goalId); }},
+        {"StudyGoal", "getResourcesForGoal", [&] { studyGoal.getResourcesForGoal(goalId); }},
+        {"StudyGoal", "getProgress", [&] { studyGoal.getProgress(goalId); }},
+        {"StudyGoal", "getTarget", [&] { studyGoal.getTarget(goalId); }},
+        {"StudyGoal", "getCompletionPercentage", [&] { studyGoal.getCompletionPercentage(goalId); }},
+        {"StudyGoal", "getSubjectStats", [&] { studyGoal.getSubjectStats(startDate, endDate); }},
+        {"StudyGoal", "getDailyStats", [&] { studyGoal.getDailyStats(endDate); }},
+        {"StudyGoal", "catchUpRecurringGoals", [&] { studyGoal.catchUpRecurringGoals(); }},
+        {"StudyGoal", "getRollup", [&] { studyGoal.getRollup(goalId); }},
+        {"StudyGoal", "getAncestors", [&] { studyGoal.getAncestors(goalId); }},
+        {"StudyGoal", "isBlocked", [&] { studyGoal.isBlocked(goalId); }},
+
+        {"StudyStreak", "initializeStreaks", [&] { studyStreak.initializeStreaks(); }},
+        {"StudyStreak", "getTotalStudyDays", [&] { studyStreak.getTotalStudyDays(); }},
+        {"StudyStreak", "getStudyHistory", [&] { studyStreak.getStudyHistory(startDate, endDate); }},
+        {"StudyStreak", "getAverageStudyTime", [&] { studyStreak.getAverageStudyTime(); }},
+        {"StudyStreak", "getTotalStudyTime", [&] { studyStreak.getTotalStudyTime(); }},
+        {"StudyStreak", "getStudyMinutesBetween", [&] { studyStreak.getStudyMinutesBetween(startDate, endDate); }},
+        {"StudyStreak", "getStudyDaysBetween", [&] { studyStreak.getStudyDaysBetween(startDate, endDate); }},
+        {"StudyStreak", "setRules", [&] {
+            // Alternate so every call recomputes the whole history
+            StreakRules rules = studyStreak.rules();
+            rules.graceDays = rules.graceDays == 0 ? 1 : 0;
+            studyStreak.setRules(rules);
+        }},
+        {"StudyStreak", "getReachedMilestones", [&] { studyStreak.getReachedMilestones(); }},
+        {"StudyStreak", "getUpcomingMilestones", [&] { studyStreak.getUpcomingMilestones(); }},
+
+        {"Achievement", "isAchievementUnlocked", [&] { achievement.isAchievementUnlocked("focus_master"); }},
+        {"Achievement", "getUnlockedAchievements", [&] { achievement.getUnlockedAchievements(); }},
+        {"Achievement", "getLockedAchievements", [&] { achievement.getLockedAchievements(); }},
+        {"Achievement", "getAchievementsByCategory", [&] { achievement.getAchievementsByCategory(Achievement::Category::Time); }},
+        {"Achievement", "getUnlockedCount", [&] { achievement.getUnlockedCount(); }},
+        {"Achievement", "getCompletionPercentage", [&] { achievement.getCompletionPercentage(); }},
+        {"Achievement", "getAchievementProgress", [&] { achievement.getAchievementProgress("focus_master"); }},
+        {"Achievement", "trackFocusScore", [&] { achievement.trackFocusScore(0.5f); }},
+
+        {"Survey", "getSurveyResultsForGoal", [&] { survey.getSurveyResultsForGoal(surveyGoalId); }},
+        {"Survey", "getAllSurveyResults", [&] { survey.getAllSurveyResults(); }},
+        {"Survey", "getCommonDistractions", [&] { survey.getCommonDistractions(); }},
+
+        {"StudySession", "getSession", [&] { studySession.getSession(sessionId); }},
+        {"StudySession", "getSessionsForDate", [&] { studySession.getSessionsForDate(endDate); }},
+
+        {"StudyAnalytics", "createFocusChart", [&] { delete analytics.createFocusChart(startDate, endDate, chartWidth); }},
+        {"StudyAnalytics", "createProductivityChart", [&] { delete analytics.createProductivityChart(startDate, endDate, chartWidth); }},
+        {"StudyAnalytics", "createGoalCompletionChart", [&] { delete analytics.createGoalCompletionChart(startDate, endDate); }},
+        {"StudyAnalytics", "createSubjectTimeChart", [&] { delete analytics.createSubjectTimeChart(startDate, endDate); }},
+        {"StudyAnalytics", "createDistractionBarChart", [&] { delete analytics.createDistractionBarChart(startDate, endDate); }},
+        {"StudyAnalytics", "getProductivityByHour", [&] { analytics.getProductivityByHour(); }},
+        {"StudyAnalytics", "getNeglectedSubjects", [&] { analytics.getNeglectedSubjects(7, endDate); }},
+        {"StudyAnalytics", "analyzePatterns", [&] { analytics.analyzePatterns(startDate, endDate); }},
+        {"StudyAnalytics", "getFocusQuantiles", [&] { analytics.getFocusQuantiles(startDate, endDate, quantiles); }},
+        {"StudyAnalytics", "getHourlyFocusQuantiles", [&] { analytics.getHourlyFocusQuantiles(startDate, endDate, quantiles); }},
+        {"StudyAnalytics", "getSubjectFocusQuantiles", [&] { analytics.getSubjectFocusQuantiles(subject, quantiles); }},
+    };
+
+    QJsonArray results;
+    QTextStream err(stderr);
+    for (const Benchmark &benchmark : benchmarks) {
+        if (!filter.isEmpty() && !benchmark.group.contains(filter, Qt::CaseInsensitive)
+            && !benchmark.name.contains(filter, Qt::CaseInsensitive)) {
+            continue;
+        }
+        const QJsonObject result = timeBenchmark(benchmark, iterations);
+        err << QString("%1::%2").arg(benchmark.group, benchmark.name).leftJustified(52)
+            << QString::number(result["median_ms"].toDouble(), 'f', 3).rightJustified(12) << " ms\n";
+        err.flush();
+        results.append(result);
+    }
+
+    QJsonObject report;
+    report["generated_at"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    report["database"] = source;
+    report["qt_version"] = qVersion();
+    report["range_start"] = startDate.toString(Qt::ISODate);
+    report["range_end"] = endDate.toString(Qt::ISODate);
+    report["row_counts"] = rowCounts;
+    report["results"] = results;
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "Cannot write " << file.fileName() << "\n";
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+QT += core gui widgets sql charts
+CONFIG += console c++20
+CONFIG -= app_bundle
+
+TARGET = dbbench
+
+SOURCES += \
+    dbbench.cpp \
+    ../database.cpp \
+    ../studygoals.cpp \
+    ../pomodoro.cpp \
+    ../streak.cpp \
+    ../dayindex.cpp \
+    ../streakengine.cpp \
+    ../achievements.cpp \
+    ../achievementrules.cpp \
+    ../survey.cpp \
+    ../studysession.cpp \
+    ../analytics.cpp \
+    ../downsampler.cpp \
+    ../statistics.cpp \
+    ../tdigest.cpp \
+    ../focussketches.cpp \
+    ../recurrencerule.cpp
+
+HEADERS += \
+    ../database.h \
+    ../studygoals.h \
+    ../pomodoro.h \
+    ../streak.h \
+    ../dayindex.h \
+    ../streakengine.h \
+    ../achievements.h \
+    ../achievementrules.h \
+    ../survey.h \
+    ../studysession.h \
+    ../analytics.h \
+    ../downsampler.h \
+    ../statistics.h \
+    ../tdigest.h \
+    ../focussketches.h \
+    ../recurrencerule.h
+
+# Achievement definitions are read from :/achievements.json
+RESOURCES += \
+    ../resources.qrc
@@ -0,0 +1,329 @@
+// Generates a synthetic studybuddy.db with realistic volumes: detections at
+// webcam frame rate for every session, recurring goals and their instances,
+// sessions, surveys and streak rows. Build with dbgen.pro.
+#include "../database.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRandomGenerator>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+#include <random>
+
+namespace {
+
+struct Options {
+    QString output;
+    int years = 1;
+    int sessionsPerDay = 2;
+    int sessionMinutes = 45;
+    int hz = 30;
+    double studyProbability = 0.85;
+    quint32 seed = 42;
+};
+
+struct RecurringGoal {
+    QString subject;
+    QString category;
+    QString recurrenceType;
+    QString recurrenceValue;
+    int targetMinutes;
+};
+
+struct Counts {
+    qint64 detections = 0;
+    qint64 goals = 0;
+    qint64 sessions = 0;
+    qint64 surveys = 0;
+    qint64 streakDays = 0;
+};
+
+const QStringList kMoods = {"😀", "🙂", "😐", "😕", "😫"};
+const QStringList kDistractions = {"Phone", "Social Media", "Noise", "Hunger", "Tiredness", "Messages", "Daydreaming"};
+const QStringList kAchieved = {"Yes", "Partial", "No"};
+
+QList<RecurringGoal> recurringGoals()
+{
+    return {
+        {"Math", "STEM", "Daily", "", 60},
+        {"Physics", "STEM", "Weekly", "Mon,Wed,Fri", 90},
+        {"Chemistry", "STEM", "Weekly", "Tue,Thu", 45},
+        {"History", "Humanities", "Weekly", "Sat", 60},
+        {"Literature", "Humanities", "Monthly", "1,15", 120},
+        {"Programming", "Projects", "Daily", "", 30},
+        {"Languages", "Languages", "Weekly", "Mon,Tue,Wed,Thu,Fri", 20},
+    };
+}
+
+bool occursOn(const RecurringGoal &goal, const QDate &date)
+{
+    if (goal.recurrenceType == "Daily") return true;
+    const QStringList values = goal.recurrenceValue.split(',', Qt::SkipEmptyParts);
+    if (goal.recurrenceType == "Weekly") return values.contains(date.toString("ddd"));
+    if (goal.recurrenceType == "Monthly") return values.contains(QString::number(date.day()));
+    return false;
+}
+
+// Focus is better in the late morning and early evening, worse after lunch and late at night
+double baseFocusForHour(int hour)
+{
+    static const double curve[24] = {
+        0.45, 0.40, 0.35, 0.35, 0.35, 0.40, 0.50, 0.60, 0.70, 0.78, 0.82, 0.80,
+        0.72, 0.62, 0.65, 0.70, 0.74, 0.76, 0.78, 0.75, 0.70, 0.62, 0.55, 0.50
+    };
+    return curve[qBound(0, hour, 23)];
+}
+
+bool exec(QSqlQuery &query)
+{
+    if (!query.exec()) {
+        qDebug() << "Query failed:" << query.lastError().text() << query.lastQuery();
+        return false;
+    }
+    return true;
+}
+
+bool generate(QSqlDatabase &db, const Options &options, Counts &counts)
+{
+    QRandomGenerator rng(options.seed);
+    std::normal_distribution<double> noise(0.0, 0.15);
+
+    const QDate today = QDate::currentDate();
+    const QDate firstDay = today.addYears(-options.years).addDays(1);
+    const QList<RecurringGoal> templates = recurringGoals();
+
+    QSqlQuery insertGoal(db);
+    insertGoal.prepare("INSERT INTO goals (subject, target_minutes, completed_minutes, start_date, due_date, status, notes, recurrence_type, recurrence_value, last_generated_date, category) "
+                       "VALUES (?, ?, ?, ?, ?, 'Active', ?, ?, ?, ?, ?)");
+    QSqlQuery insertResource(db);
+    insertResource.prepare("INSERT INTO goal_resources (goal_id, type, value, description) VALUES (?, 'resource', ?, '')");
+    QSqlQuery insertSession(db);
+    insertSession.prepare("INSERT INTO study_sessions (planned_session_id, start_time, end_time, type, notes) VALUES (-1, ?, ?, 'webcam', 'Generated session')");
+    QSqlQuery insertSessionGoal(db);
+    insertSessionGoal.prepare("INSERT INTO session_goals (session_id, goal_id) VALUES (?, ?)");
+    QSqlQuery insertDetection(db);
+    insertDetection.prepare("INSERT INTO detections (timestamp, face_count, eyes_detected, blink_count, focus_score) VALUES (?, ?, ?, ?, ?)");
+    QSqlQuery insertSurvey(db);
+    insertSurvey.prepare("INSERT INTO surveys (goal_id, timestamp, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder) "
+                         "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    QSqlQuery insertStreak(db);
+    insertStreak.prepare("INSERT INTO study_streaks (date, study_minutes, streak_count, created_at) VALUES (?, ?, ?, ?)");
+    QSqlQuery updateCompleted(db);
+    updateCompleted.prepare("UPDATE goals SET completed_minutes = ? WHERE id = ?");
+
+    // Recurring parents, already generated up to today like the app would have done
+    for (const RecurringGoal &goal : templates) {
+        insertGoal.addBindValue(goal.subject);
+        insertGoal.addBindValue(goal.targetMinutes);
+        insertGoal.addBindValue(0);
+        insertGoal.addBindValue(firstDay.toString(Qt::ISODate));
+        insertGoal.addBindValue(QVariant(QMetaType::fromType<QString>()));
+        insertGoal.addBindValue("Recurring " + goal.subject);
+        insertGoal.addBindValue(goal.recurrenceType);
+        insertGoal.addBindValue(goal.recurrenceValue);
+        insertGoal.addBindValue(today.toString(Qt::ISODate));
+        insertGoal.addBindValue(goal.category);
+        if (!exec(insertGoal)) return false;
+        ++counts.goals;
+    }
+
+    int streak = 0;
+    const int progressEvery = qMax(1, int(firstDay.daysTo(today) / 20));
+    // A failed day is rolled back so the database is never left inside a transaction
+    auto abandonDay = [&db] {
+        db.rollback();
+        return false;
+    };
+    for (QDate day = firstDay; day <= today; day = day.addDays(1)) {
+        db.transaction();
+
+        // Today's goal instances
+        QList<int> dayGoals;
+        QMap<int, int> completedMinutes;
+        for (const RecurringGoal &goal : templates) {
+            if (!occursOn(goal, day)) continue;
+            insertGoal.addBindValue(goal.subject);
+            insertGoal.addBindValue(goal.targetMinutes);
+            insertGoal.addBindValue(0);
+            insertGoal.addBindValue(day.toString(Qt::ISODate));
+            insertGoal.addBindValue(day.toString(Qt::ISODate));
+            insertGoal.addBindValue("");
+            insertGoal.addBindValue("None");
+            insertGoal.addBindValue("");
+            insertGoal.addBindValue(day.toString(Qt::ISODate));
+            insertGoal.addBindValue(goal.category);
+            if (!exec(insertGoal)) return abandonDay();
+            const int goalId = insertGoal.lastInsertId().toInt();
+            dayGoals.append(goalId);
+            completedMinutes[goalId] = 0;
+            ++counts.goals;
+
+            if (rng.bounded(4) == 0) {
+                insertResource.addBindValue(goalId);
+                insertResource.addBindValue(QString("https://example.org/%1/%2").arg(goal.subject.toLower()).arg(day.dayOfYear()));
+                if (!exec(insertResource)) return abandonDay();
+            }
+        }
+
+        int dayMinutes = 0;
+        if (!dayGoals.isEmpty() && rng.generateDouble() < options.studyProbability) {
+            int hour = 8 + rng.bounded(3);
+            for (int s = 0; s < options.sessionsPerDay && hour < 23; ++s) {
+                const int minutes = qMax(5, int(options.sessionMinutes * (0.7 + 0.6 * rng.generateDouble())));
+                const QDateTime start(day, QTime(hour, rng.bounded(60)));
+                const QDateTime end = start.addSecs(minutes * 60);
+
+                insertSession.addBindValue(start.toString("yyyy-MM-dd HH:mm:ss"));
+                insertSession.addBindValue(end.toString("yyyy-MM-dd HH:mm:ss"));
+                if (!exec(insertSession)) return abandonDay();
+                const int sessionId = insertSession.lastInsertId().toInt();
+                ++counts.sessions;
+
+                const int goalId = dayGoals[rng.bounded(int(dayGoals.size()))];
+                insertSessionGoal.addBindValue(sessionId);
+                insertSessionGoal.addBindValue(goalId);
+                if (!exec(insertSessionGoal)) return abandonDay();
+                completedMinutes[goalId] += minutes;
+
+                // Frame-by-frame detections; focus_score is the running focused ratio, as in the app
+                const qint64 frames = qint64(minutes) * 60 * options.hz;
+                const double base = baseFocusForHour(hour);
+                qint64 focused = 0;
+                int blinks = 0;
+                for (qint64 f = 0; f < frames; ++f) {
+                    const double fatigue = 0.15 * double(f) / frames;
+                    const bool eyes = rng.generateDouble() < qBound(0.05, base - fatigue + noise(rng), 0.99);
+                    if (eyes) ++focused;
+                    if (rng.bounded(options.hz * 4) == 0) ++blinks;
+                    insertDetection.addBindValue(start.addMSecs(f * 1000 / options.hz).toString("yyyy-MM-dd HH:mm:ss"));
+                    insertDetection.addBindValue(eyes ? 1 : 0);
+                    insertDetection.addBindValue(eyes);
+                    insertDetection.addBindValue(blinks);
+                    insertDetection.addBindValue(float(focused) / (f + 1));
+                    if (!exec(insertDetection)) return abandonDay();
+                }
+                counts.detections += frames;
+
+                QStringList distractions;
+                for (int d = rng.bounded(3); d > 0; --d) {
+                    const QString distraction = kDistractions[rng.bounded(int(kDistractions.size()))];
+                    if (!distractions.contains(distraction)) distractions << distraction;
+                }
+                insertSurvey.addBindValue(goalId);
+                insertSurvey.addBindValue(end.toString(Qt::ISODate));
+                insertSurvey.addBindValue(kMoods[rng.bounded(int(kMoods.size()))]);
+                insertSurvey.addBindValue(rng.bounded(101));
+                insertSurvey.addBindValue(distractions.join(", "));
+                insertSurvey.addBindValue(1 + rng.bounded(5));
+                insertSurvey.addBindValue(kAchieved[rng.bounded(int(kAchieved.size()))]);
+                insertSurvey.addBindValue(QString());
+                insertSurvey.addBindValue(rng.bounded(2));
+                if (!exec(insertSurvey)) return abandonDay();
+                if (!Database::addSurveyDistractions(db, insertSurvey.lastInsertId().toLongLong(), distractions.join(", "))) return abandonDay();
+                ++counts.surveys;
+
+                dayMinutes += minutes;
+                hour = end.time().hour() + 1 + rng.bounded(4);
+            }
+        }
+
+        for (auto it = completedMinutes.begin(); it != completedMinutes.end(); ++it) {
+            if (it.value() == 0) continue;
+            updateCompleted.addBindValue(it.value());
+            updateCompleted.addBindValue(it.key());
+            if (!exec(updateCompleted)) return abandonDay();
+        }
+
+        if (dayMinutes > 0) {
+            ++streak;
+            insertStreak.addBindValue(day.toString("yyyy-MM-dd"));
+            insertStreak.addBindValue(dayMinutes);
+            insertStreak.addBindValue(streak);
+            insertStreak.addBindValue(QDateTime(day, QTime(23, 0)).toString("yyyy-MM-dd HH:mm:ss"));
+            if (!exec(insertStreak)) return abandonDay();
+            ++counts.streakDays;
+        } else {
+            streak = 0;
+        }
+
+        if (!db.commit()) {
+            qDebug() << "Commit failed:" << db.lastError().text();
+            return abandonDay();
+        }
+        if (firstDay.daysTo(day) % progressEvery == 0) {
+            QTextStream(stdout) << day.toString(Qt::ISODate) << ": " << counts.detections << " detections\n";
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dbgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generates a synthetic studybuddy.db for benchmarking.");
+    parser.addHelpOption();
+    QCommandLineOption outputOption({"o", "output"}, "Database file to create (overwritten).", "file", "studybuddy.db");
+    QCommandLineOption yearsOption("years", "Years of history ending today.", "n", "1");
+    QCommandLineOption sessionsOption("sessions-per-day", "Webcam sessions on a study day.", "n", "2");
+    QCommandLineOption minutesOption("session-minutes", "Average session length in minutes.", "n", "45");
+    QCommandLineOption hzOption("hz", "Detections per second during a session.", "n", "30");
+    QCommandLineOption probabilityOption("study-probability", "Chance that a day has any study.", "p", "0.85");
+    QCommandLineOption seedOption("seed", "Random seed.", "n", "42");
+    parser.addOptions({outputOption, yearsOption, sessionsOption, minutesOption, hzOption, probabilityOption, seedOption});
+    parser.process(app);
+
+    Options options;
+    options.output = parser.value(outputOption);
+    options.years = qMax(1, parser.value(yearsOption).toInt());
+    options.sessionsPerDay = qMax(0, parser.value(sessionsOption).toInt());
+    options.sessionMinutes = qMax(1, parser.value(minutesOption).toInt());
+    options.hz = qMax(1, parser.value(hzOption).toInt());
+    options.studyProbability = qBound(0.0, parser.value(probabilityOption).toDouble(), 1.0);
+    options.seed = parser.value(seedOption).toUInt();
+
+    if (QFile::exists(options.output) && !QFile::remove(options.output)) {
+        qDebug() << "Cannot overwrite" << options.output;
+        return 1;
+    }
+
+    Counts counts;
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "dbgen");
+        db.setDatabaseName(options.output);
+        if (!db.open()) {
+            qDebug() << "Cannot open" << options.output << db.lastError().text();
+            return 1;
+        }
+        // Bulk load: durability does not matter for a generated file
+        QSqlQuery pragma(db);
+        pragma.exec("PRAGMA journal_mode = MEMORY");
+        pragma.exec("PRAGMA synchronous = OFF");
+
+        QElapsedTimer timer;
+        timer.start();
+        QString error;
+        ok = Database::createSchema(db, &error) && generate(db, options, counts);
+        if (ok) {
+            QTextStream(stdout) << "Generated " << options.output << " in " << timer.elapsed() / 1000.0 << " s\n"
+                                << "  detections:  " << counts.detections << "\n"
+                                << "  goals:       " << counts.goals << "\n"
+                                << "  sessions:    " << counts.sessions << "\n"
+                                << "  surveys:     " << counts.surveys << "\n"
+                                << "  streak days: " << counts.streakDays << "\n";
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("dbgen");
+    return ok ? 0 : 1;
+}
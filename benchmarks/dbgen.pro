@@ -0,0 +1,12 @@
+QT = core sql
+CONFIG += console c++20
+CONFIG -= app_bundle
+
+TARGET = dbgen
+
+SOURCES += \
+    dbgen.cpp \
+    ../database.cpp
+
+HEADERS += \
+    ../database.h
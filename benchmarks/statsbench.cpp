@@ -0,0 +1,89 @@
+// Micro-benchmarks for the statistics kernels, compared against the naive
+// loops StudyAnalytics used before. Build with statsbench.pro and run in release.
+#include "../statistics.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+volatile double sink = 0;
+
+template <typename Fn>
+double bestOfMs(int runs, Fn fn)
+{
+    double best = 1e300;
+    for (int r = 0; r < runs; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+std::vector<float> naiveMovingAverage(const std::vector<float> &data, std::size_t window)
+{
+    std::vector<float> result;
+    for (std::size_t i = 0; i + window <= data.size(); ++i) {
+        float sum = 0;
+        for (std::size_t j = 0; j < window; ++j) {
+            sum += data[i + j];
+        }
+        result.push_back(sum / window);
+    }
+    return result;
+}
+
+float naiveCorrelation(const std::vector<float> &x, const std::vector<float> &y)
+{
+    float sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0, sumY2 = 0;
+    const float n = float(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        sumX += x[i];
+        sumY += y[i];
+        sumXY += x[i] * y[i];
+        sumX2 += x[i] * x[i];
+        sumY2 += y[i] * y[i];
+    }
+    const float denominator = std::sqrt((n * sumX2 - sumX * sumX) * (n * sumY2 - sumY * sumY));
+    return denominator != 0 ? (n * sumXY - sumX * sumY) / denominator : 0;
+}
+
+void report(const char *name, std::size_t n, double ms)
+{
+    std::printf("%-28s n=%-9zu %10.3f ms  %8.1f Mitems/s\n", name, n, ms, n / ms / 1000.0);
+}
+
+}
+
+int main()
+{
+    const std::size_t sizes[] = {1000, 100000, 1000000};
+    const std::size_t window = 60;
+    const int runs = 5;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> focus(70.0f, 12.0f);
+
+    for (std::size_t n : sizes) {
+        std::vector<float> x(n), y(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            x[i] = focus(rng);
+            y[i] = 0.6f * x[i] + 0.4f * focus(rng);
+        }
+
+        report("naive moving average", n, bestOfMs(runs, [&] { sink = naiveMovingAverage(x, window).size(); }));
+        report("Statistics::movingAverage", n, bestOfMs(runs, [&] { sink = Statistics::movingAverage(x, window).size(); }));
+        report("naive correlation", n, bestOfMs(runs, [&] { sink = naiveCorrelation(x, y); }));
+        report("Statistics::correlation", n, bestOfMs(runs, [&] { sink = Statistics::correlation(x, y); }));
+        report("Statistics::moments", n, bestOfMs(runs, [&] { sink = Statistics::moments(x).variance(); }));
+        report("Statistics::quantile(0.9)", n, bestOfMs(runs, [&] { sink = Statistics::quantile(x, 0.9); }));
+
+        std::printf("  correlation naive=%.6f kernel=%.6f\n\n",
+                    naiveCorrelation(x, y), Statistics::correlation(x, y));
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+QT -= core gui
+CONFIG += console c++20
+CONFIG -= app_bundle qt
+
+TARGET = statsbench
+
+SOURCES += \
+    statsbench.cpp \
+    ../statistics.cpp
+
+HEADERS += \
+    ../statistics.h
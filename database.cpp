@@ -0,0 +1,203 @@
+#include "database.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <QHash>
+#include <QSet>
+
+namespace Database {
+
+namespace {
+// Columns added after a table first shipped; older databases get them via ALTER TABLE
+struct AddedColumn {
+    const char *table;
+    const char *column;
+    const char *definition;
+};
+
+const AddedColumn kAddedColumns[] = {
+    // goals: RRULE text and exception dates of recurring goals, and the
+    // recurring goal and date a saved occurrence belongs to
+    {"goals", "rrule", "TEXT"},
+    {"goals", "exdates", "TEXT"},
+    {"goals", "parent_goal_id", "INTEGER"},
+    {"goals", "occurrence_date", "TEXT"},
+    // goals: the larger goal this one is part of
+    {"goals", "part_of_goal_id", "INTEGER"},
+    // surveys: timestamp as epoch seconds, for indexed range queries
+    {"surveys", "ts", "INTEGER"},
+};
+
+bool addMissingColumns(QSqlDatabase &db, QString *error)
+{
+    QHash<QString, QSet<QString>> existing;
+    QSqlQuery query(db);
+    for (const AddedColumn &added : kAddedColumns) {
+        const QString table = added.table;
+        if (!existing.contains(table)) {
+            QSet<QString> &columns = existing[table];
+            if (!query.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+                if (error) *error = query.lastError().text();
+                return false;
+            }
+            while (query.next()) columns.insert(query.value(1).toString());
+        }
+        if (existing[table].contains(added.column)) continue;
+
+        const QString statement = QString("ALTER TABLE %1 ADD COLUMN %2 %3").arg(table, added.column, added.definition);
+        if (!query.exec(statement)) {
+            qDebug() << "Error: Failed to add column" << query.lastError().text();
+            qDebug() << "Query was:" << statement;
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+        existing[table].insert(added.column);
+    }
+    return true;
+}
+
+// Surveys saved before survey_distractions existed, or written without it, get their links
+bool migrateSurveyDistractions(QSqlDatabase &db, QString *error)
+{
+    QSqlQuery query(db);
+    if (!query.exec("SELECT s.id, s.distractions FROM surveys s WHERE coalesce(s.distractions, '') <> '' "
+                    "AND NOT EXISTS (SELECT 1 FROM survey_distractions sd WHERE sd.survey_id = s.id)")) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    QList<QPair<qint64, QString>> unlinked;
+    while (query.next()) unlinked.append({query.value(0).toLongLong(), query.value(1).toString()});
+    if (unlinked.isEmpty()) return true;
+
+    db.transaction();
+    for (const auto &survey : unlinked) {
+        if (!addSurveyDistractions(db, survey.first, survey.second)) {
+            db.rollback();
+            if (error) *error = "could not migrate survey distractions";
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        if (error) *error = db.lastError().text();
+        return false;
+    }
+    qDebug() << "Linked the distractions of" << unlinked.size() << "surveys";
+    return true;
+}
+}
+
+QStringList schemaStatements()
+{
+    return {
+        // detections
+        "CREATE TABLE IF NOT EXISTS detections (id INTEGER PRIMARY KEY AUTOINCREMENT, timestamp TEXT NOT NULL, face_count INTEGER NOT NULL, eyes_detected BOOLEAN NOT NULL, blink_count INTEGER NOT NULL, focus_score REAL NOT NULL)",
+        // session_plans
+        "CREATE TABLE IF NOT EXISTS session_plans (id INTEGER PRIMARY KEY AUTOINCREMENT, subject TEXT NOT NULL, goals TEXT, resource_link TEXT, mental_state TEXT, plan_date TEXT NOT NULL)",
+        // session_reviews
+        "CREATE TABLE IF NOT EXISTS session_reviews (id INTEGER PRIMARY KEY AUTOINCREMENT, session_plan_id INTEGER NOT NULL, focus_score REAL, distraction_events TEXT, effectiveness TEXT, notes TEXT, review_date TEXT NOT NULL, session_id INTEGER, FOREIGN KEY(session_plan_id) REFERENCES session_plans(id))",
+        // study_sessions
+        "CREATE TABLE IF NOT EXISTS study_sessions (id INTEGER PRIMARY KEY AUTOINCREMENT, planned_session_id INTEGER, start_time TEXT, end_time TEXT, type TEXT, notes TEXT)",
+        // goals
+        "CREATE TABLE IF NOT EXISTS goals (id INTEGER PRIMARY KEY AUTOINCREMENT, subject TEXT NOT NULL, target_minutes INTEGER NOT NULL, completed_minutes INTEGER DEFAULT 0, start_date TEXT NOT NULL, due_date TEXT, status TEXT DEFAULT 'Active', notes TEXT, recurrence_type TEXT DEFAULT 'None', recurrence_value TEXT, last_generated_date TEXT, category TEXT DEFAULT 'Uncategorized', rrule TEXT, exdates TEXT, parent_goal_id INTEGER, occurrence_date TEXT, part_of_goal_id INTEGER)",
+        // goal_resources
+        "CREATE TABLE IF NOT EXISTS goal_resources (id INTEGER PRIMARY KEY AUTOINCREMENT, goal_id INTEGER NOT NULL, type TEXT NOT NULL, value TEXT NOT NULL, description TEXT, FOREIGN KEY(goal_id) REFERENCES goals(id))",
+        // session_resources
+        "CREATE TABLE IF NOT EXISTS session_resources (id INTEGER PRIMARY KEY AUTOINCREMENT, session_id INTEGER NOT NULL, type TEXT NOT NULL, value TEXT NOT NULL, description TEXT, FOREIGN KEY(session_id) REFERENCES study_sessions(id))",
+        // goal_prerequisites
+        "CREATE TABLE IF NOT EXISTS goal_prerequisites (id INTEGER PRIMARY KEY AUTOINCREMENT, goal_id INTEGER NOT NULL, prerequisite_id INTEGER NOT NULL, UNIQUE(goal_id, prerequisite_id), FOREIGN KEY(goal_id) REFERENCES goals(id), FOREIGN KEY(prerequisite_id) REFERENCES goals(id))",
+        // session_goals
+        "CREATE TABLE IF NOT EXISTS session_goals (id INTEGER PRIMARY KEY AUTOINCREMENT, session_id INTEGER NOT NULL, goal_id INTEGER NOT NULL, FOREIGN KEY(session_id) REFERENCES study_sessions(id), FOREIGN KEY(goal_id) REFERENCES goals(id))",
+        // surveys
+        "CREATE TABLE IF NOT EXISTS surveys (id INTEGER PRIMARY KEY AUTOINCREMENT, goal_id INTEGER NOT NULL, timestamp TEXT NOT NULL, mood_emoji TEXT, distraction_level INTEGER, distractions TEXT, session_satisfaction INTEGER, goal_achieved TEXT, open_feedback TEXT, set_reminder INTEGER)",
+        // distraction_types: integer codes for distraction names; the survey form's choices keep fixed codes
+        "CREATE TABLE IF NOT EXISTS distraction_types (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE)",
+        "INSERT OR IGNORE INTO distraction_types (id, name) VALUES (1, 'Phone'), (2, 'Social Media'), (3, 'Noise'), (4, 'People'), (5, 'Hunger'), (6, 'Other')",
+        // survey_distractions: the distractions of each survey by code; surveys.distractions keeps the text
+        "CREATE TABLE IF NOT EXISTS survey_distractions (survey_id INTEGER NOT NULL, distraction_id INTEGER NOT NULL, PRIMARY KEY(survey_id, distraction_id), FOREIGN KEY(survey_id) REFERENCES surveys(id), FOREIGN KEY(distraction_id) REFERENCES distraction_types(id)) WITHOUT ROWID",
+        "CREATE TRIGGER IF NOT EXISTS survey_distractions_delete AFTER DELETE ON surveys BEGIN DELETE FROM survey_distractions WHERE survey_id = old.id; END",
+        // study_streaks
+        "CREATE TABLE IF NOT EXISTS study_streaks (id INTEGER PRIMARY KEY AUTOINCREMENT, date TEXT NOT NULL UNIQUE, study_minutes INTEGER NOT NULL, streak_count INTEGER NOT NULL, created_at TEXT NOT NULL)",
+        // achievements
+        "CREATE TABLE IF NOT EXISTS achievements (id TEXT PRIMARY KEY, name TEXT NOT NULL, description TEXT NOT NULL, category TEXT NOT NULL, required_value INTEGER NOT NULL, icon_path TEXT, unlocked_at TEXT, progress INTEGER DEFAULT 0)",
+        // achievement_progress_log: progress of each achievement whenever it is saved, at epoch seconds
+        "CREATE TABLE IF NOT EXISTS achievement_progress_log (achievement_id TEXT NOT NULL, recorded_at INTEGER NOT NULL, progress INTEGER NOT NULL, PRIMARY KEY(achievement_id, recorded_at)) WITHOUT ROWID",
+        // free_time
+        "CREATE TABLE IF NOT EXISTS free_time (date TEXT PRIMARY KEY, morning_minutes INTEGER, evening_minutes INTEGER, night_minutes INTEGER)",
+        // focus_sketches: serialized t-digests of focus scores per hour ("yyyy-MM-dd HH") and per subject,
+        // plus a "cursor" row whose sample_count is the newest detection id in the hour sketches
+        "CREATE TABLE IF NOT EXISTS focus_sketches (scope TEXT NOT NULL, sketch_key TEXT NOT NULL, digest BLOB NOT NULL, sample_count INTEGER NOT NULL, updated_at TEXT NOT NULL, PRIMARY KEY(scope, sketch_key))"
+    };
+}
+
+QStringList indexStatements()
+{
+    return {
+        // One saved occurrence per recurring goal and date
+        "CREATE UNIQUE INDEX IF NOT EXISTS idx_goals_occurrence ON goals(parent_goal_id, occurrence_date) WHERE parent_goal_id IS NOT NULL",
+        // Sub-goals of a goal
+        "CREATE INDEX IF NOT EXISTS idx_goals_part_of ON goals(part_of_goal_id) WHERE part_of_goal_id IS NOT NULL",
+        // Surveys by time, overall and per goal
+        "CREATE INDEX IF NOT EXISTS idx_surveys_ts ON surveys(ts)",
+        "CREATE INDEX IF NOT EXISTS idx_surveys_goal_ts ON surveys(goal_id, ts)",
+        // Writers that only set the local-time timestamp text, e.g. imports, get ts filled in
+        "CREATE TRIGGER IF NOT EXISTS surveys_ts_insert AFTER INSERT ON surveys WHEN new.ts IS NULL BEGIN "
+        "UPDATE surveys SET ts = CAST(strftime('%s', new.timestamp, 'utc') AS INTEGER) WHERE id = new.id; END",
+        "CREATE TRIGGER IF NOT EXISTS surveys_ts_update AFTER UPDATE OF timestamp ON surveys BEGIN "
+        "UPDATE surveys SET ts = CAST(strftime('%s', new.timestamp, 'utc') AS INTEGER) WHERE id = new.id; END"
+    };
+}
+
+bool addSurveyDistractions(QSqlDatabase &db, qint64 surveyId, const QString &distractions)
+{
+    QSqlQuery addType(db);
+    addType.prepare("INSERT OR IGNORE INTO distraction_types (name) VALUES (?)");
+    QSqlQuery link(db);
+    link.prepare("INSERT OR IGNORE INTO survey_distractions (survey_id, distraction_id) SELECT ?, id FROM distraction_types WHERE name = ?");
+    // Saved as ", "-joined names, though older rows used ","
+    for (const QString &part : distractions.split(',', Qt::SkipEmptyParts)) {
+        const QString name = part.trimmed();
+        if (name.isEmpty()) continue;
+        addType.addBindValue(name);
+        link.addBindValue(surveyId);
+        link.addBindValue(name);
+        if (!addType.exec() || !link.exec()) {
+            qDebug() << "Error linking survey distractions:" << addType.lastError().text() << link.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool createSchema(QSqlDatabase &db, QString *error)
+{
+    QSqlQuery query(db);
+    for (const QString &statement : schemaStatements()) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: Failed to create table" << query.lastError().text();
+            qDebug() << "Query was:" << statement;
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+    }
+    if (!addMissingColumns(db, error)) return false;
+
+    // Surveys saved before the ts column; 'utc' reads the text as local time
+    if (!query.exec("UPDATE surveys SET ts = CAST(strftime('%s', timestamp, 'utc') AS INTEGER) WHERE ts IS NULL")) {
+        qDebug() << "Error: Failed to migrate survey timestamps" << query.lastError().text();
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+
+    // Indexes and triggers on migrated columns can only be created once the columns exist
+    for (const QString &statement : indexStatements()) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: Failed to create index" << query.lastError().text();
+            qDebug() << "Query was:" << statement;
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+    }
+    return migrateSurveyDistractions(db, error);
+}
+
+}
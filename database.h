@@ -0,0 +1,23 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <QSqlDatabase>
+#include <QStringList>
+
+// The studybuddy.db schema, shared by the app and the tools in benchmarks/
+namespace Database {
+
+QStringList schemaStatements();
+QStringList indexStatements();
+
+// Creates the tables, adds columns missing from older databases and creates the
+// indexes; on failure returns false and fills error if given
+bool createSchema(QSqlDatabase &db, QString *error = nullptr);
+
+// Links a survey to the codes of its comma-separated distractions, adding names
+// not seen before to distraction_types
+bool addSurveyDistractions(QSqlDatabase &db, qint64 surveyId, const QString &distractions);
+
+}
+
+#endif // DATABASE_H
@@ -0,0 +1,466 @@
+#include "dataexchange.h"
+#include "database.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QDebug>
+#include <vector>
+
+namespace DataExchange {
+
+namespace {
+const int kFormatVersion = 1;
+// Rows per transaction while importing
+const int kBatchSize = 5000;
+const int kMaxErrors = 20;
+
+enum Kind { Text, Integer, Real, Date, DateTime };
+
+struct Column {
+    QString name;
+    Kind kind;
+    QVariant defaultValue; // used when an imported record lacks the field
+    QString references;    // record whose id this column holds, if any
+    bool required = false;
+};
+
+struct RecordType {
+    QString name;
+    QString table;
+    QList<Column> columns; // id is handled separately
+};
+
+// In dependency order: a record only references records written before it, except
+// goals referring to other goals, which are patched once every goal has been read
+const QList<RecordType> &recordTypes()
+{
+    static const QList<RecordType> types = {
+        {"goal", "goals", {
+            {"subject", Text, QVariant(), QString(), true},
+            {"target_minutes", Integer, QVariant(), QString(), true},
+            {"completed_minutes", Integer, 0},
+            {"start_date", Date, QVariant(), QString(), true},
+            {"due_date", Date},
+            {"status", Text, "Active"},
+            {"notes", Text},
+            {"recurrence_type", Text, "None"},
+            {"recurrence_value", Text},
+            {"last_generated_date", Date},
+            {"category", Text, "Uncategorized"},
+            {"rrule", Text},
+            {"exdates", Text},
+            {"parent_goal_id", Integer, QVariant(), "goal"},
+            {"occurrence_date", Date},
+            {"part_of_goal_id", Integer, QVariant(), "goal"},
+        }},
+        {"goal_prerequisite", "goal_prerequisites", {
+            {"goal_id", Integer, QVariant(), "goal", true},
+            {"prerequisite_id", Integer, QVariant(), "goal", true},
+        }},
+        {"resource", "goal_resources", {
+            {"goal_id", Integer, QVariant(), "goal", true},
+            {"type", Text, QVariant(), QString(), true},
+            {"value", Text, QVariant(), QString(), true},
+            {"description", Text},
+        }},
+        {"session", "study_sessions", {
+            {"start_time", Text},
+            {"end_time", Text},
+            {"type", Text},
+            {"notes", Text},
+        }},
+        {"session_goal", "session_goals", {
+            {"session_id", Integer, QVariant(), "session", true},
+            {"goal_id", Integer, QVariant(), "goal", true},
+        }},
+        {"survey", "surveys", {
+            {"goal_id", Integer, QVariant(), "goal", true},
+            {"timestamp", DateTime, QVariant(), QString(), true},
+            {"mood_emoji", Text},
+            {"distraction_level", Integer},
+            {"distractions", Text},
+            {"session_satisfaction", Integer},
+            {"goal_achieved", Text},
+            {"open_feedback", Text},
+            {"set_reminder", Integer},
+        }},
+    };
+    return types;
+}
+
+QJsonValue toJson(const QVariant &value, Kind kind)
+{
+    if (value.isNull()) return QJsonValue::Null;
+    switch (kind) {
+    case Integer: return value.toLongLong();
+    case Real: return value.toDouble();
+    case Text:
+    case Date:
+    case DateTime: break;
+    }
+    return value.toString();
+}
+
+bool fromJson(const QJsonValue &json, const Column &column, QVariant &value, QString &problem)
+{
+    if (json.isUndefined() || json.isNull()) {
+        if (column.required) {
+            problem = QString("missing %1").arg(column.name);
+            return false;
+        }
+        value = json.isUndefined() ? column.defaultValue : QVariant();
+        return true;
+    }
+
+    switch (column.kind) {
+    case Integer:
+        if (!json.isDouble()) break;
+        value = json.toInteger();
+        return true;
+    case Real:
+        if (!json.isDouble()) break;
+        value = json.toDouble();
+        return true;
+    case Date: {
+        if (!json.isString()) break;
+        const QString text = json.toString();
+        if (text.isEmpty() && !column.required) {
+            value = QVariant();
+            return true;
+        }
+        if (!QDate::fromString(text, Qt::ISODate).isValid()) break;
+        value = text;
+        return true;
+    }
+    case DateTime: {
+        // Range queries use the ts column the triggers derive from this text, so it must parse
+        if (!json.isString()) break;
+        const QString text = json.toString();
+        if (text.isEmpty() && !column.required) {
+            value = QVariant();
+            return true;
+        }
+        if (!QDateTime::fromString(text, Qt::ISODate).isValid()) break;
+        value = text;
+        return true;
+    }
+    case Text:
+        if (!json.isString() || (column.required && json.toString().isEmpty())) break;
+        value = json.toString();
+        return true;
+    }
+    problem = QString("invalid %1").arg(column.name);
+    return false;
+}
+
+// A goal link written by the import, by new ids
+struct Link {
+    qint64 goalId;
+    qint64 targetId;
+    qint64 line;
+};
+
+// The importer bypasses StudyGoal::setGoalPartOf() and setPrerequisites(), so it repeats their
+// cycle checks: links are accepted in file order, and one that would close a cycle is undone
+bool dropCycles(QSqlDatabase &db, const QList<Link> &partOfLinks, const QList<Link> &prerequisiteLinks, Report &result)
+{
+    auto report = [&result](const Link &link, const QString &problem) {
+        if (result.errors.size() < kMaxErrors) {
+            result.errors << QString("line %1: %2").arg(link.line).arg(problem);
+        }
+    };
+
+    QHash<qint64, qint64> partOf;
+    QSqlQuery detach(db);
+    detach.prepare("UPDATE goals SET part_of_goal_id = NULL WHERE id = ?");
+    for (const Link &link : partOfLinks) {
+        // A goal cannot be part of itself or of one of its own sub-goals
+        bool cycle = link.targetId == link.goalId;
+        QSet<qint64> seen;
+        for (qint64 ancestor = partOf.value(link.targetId, -1); !cycle && ancestor >= 0 && !seen.contains(ancestor);
+             ancestor = partOf.value(ancestor, -1)) {
+            seen.insert(ancestor);
+            cycle = ancestor == link.goalId;
+        }
+        if (!cycle) {
+            partOf.insert(link.goalId, link.targetId);
+            continue;
+        }
+        detach.addBindValue(link.goalId);
+        if (!detach.exec()) {
+            result.errors << detach.lastError().text();
+            return false;
+        }
+        report(link, "part_of_goal_id would make a cycle, left empty");
+    }
+
+    QHash<qint64, QList<qint64>> prerequisites;
+    auto dependsOn = [&prerequisites](qint64 goalId, qint64 otherGoalId) {
+        QList<qint64> pending = prerequisites.value(goalId);
+        QSet<qint64> seen;
+        while (!pending.isEmpty()) {
+            const qint64 prerequisiteId = pending.takeLast();
+            if (prerequisiteId == otherGoalId) return true;
+            if (seen.contains(prerequisiteId)) continue;
+            seen.insert(prerequisiteId);
+            pending += prerequisites.value(prerequisiteId);
+        }
+        return false;
+    };
+    QSqlQuery unlink(db);
+    unlink.prepare("DELETE FROM goal_prerequisites WHERE goal_id = ? AND prerequisite_id = ?");
+    for (const Link &link : prerequisiteLinks) {
+        if (link.targetId != link.goalId && !dependsOn(link.targetId, link.goalId)) {
+            prerequisites[link.goalId].append(link.targetId);
+            continue;
+        }
+        unlink.addBindValue(link.goalId);
+        unlink.addBindValue(link.targetId);
+        if (!unlink.exec()) {
+            result.errors << unlink.lastError().text();
+            return false;
+        }
+        ++result.skipped;
+        --result.records["goal_prerequisite"];
+        report(link, "prerequisite would make a cycle");
+    }
+    return true;
+}
+}
+
+bool exportJsonLines(QSqlDatabase &db, QIODevice &out, Report *report)
+{
+    Report local;
+    Report &result = report ? *report : local;
+
+    QJsonObject header;
+    header["record"] = "studybuddy";
+    header["version"] = kFormatVersion;
+    header["exported_at"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    out.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n');
+
+    for (const RecordType &type : recordTypes()) {
+        QStringList names{"id"};
+        for (const Column &column : type.columns) names << column.name;
+
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if (!query.exec(QString("SELECT %1 FROM %2 ORDER BY id").arg(names.join(", "), type.table))) {
+            qDebug() << "Error exporting" << type.table << ":" << query.lastError().text();
+            result.errors << query.lastError().text();
+            return false;
+        }
+
+        qint64 rows = 0;
+        while (query.next()) {
+            QJsonObject record;
+            record["record"] = type.name;
+            record["id"] = query.value(0).toLongLong();
+            for (int i = 0; i < type.columns.size(); ++i) {
+                record[type.columns[i].name] = toJson(query.value(i + 1), type.columns[i].kind);
+            }
+            if (out.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n') < 0) {
+                result.errors << out.errorString();
+                return false;
+            }
+            ++rows;
+        }
+        result.records[type.name] = rows;
+    }
+    return true;
+}
+
+bool importJsonLines(QSqlDatabase &db, QIODevice &in, Report *report)
+{
+    Report local;
+    Report &result = report ? *report : local;
+    qint64 lineNumber = 0;
+    auto skip = [&](const QString &problem) {
+        ++result.skipped;
+        if (result.errors.size() < kMaxErrors) {
+            result.errors << QString("line %1: %2").arg(lineNumber).arg(problem);
+        }
+    };
+
+    // One prepared insert per record type, reused for every row
+    const QList<RecordType> &types = recordTypes();
+    QHash<QString, int> typeIndex;
+    std::vector<QSqlQuery> inserts;
+    inserts.reserve(types.size());
+    for (const RecordType &type : types) {
+        QStringList names, placeholders;
+        for (const Column &column : type.columns) {
+            names << column.name;
+            placeholders << "?";
+        }
+        QSqlQuery &insert = inserts.emplace_back(db);
+        if (!insert.prepare(QString("INSERT INTO %1 (%2) VALUES (%3)").arg(type.table, names.join(", "), placeholders.join(", ")))) {
+            qDebug() << "Error preparing import into" << type.table << ":" << insert.lastError().text();
+            result.errors << insert.lastError().text();
+            return false;
+        }
+        typeIndex.insert(type.name, int(inserts.size()) - 1);
+    }
+    // Old id -> new id per record type, to remap references
+    QHash<QString, QHash<qint64, qint64>> idMaps;
+    // References to a record of the same type that had not been read yet, e.g. a chapter
+    // goal exported before the course goal it is part of
+    struct ForwardReference {
+        int typeIndex;
+        QString column;
+        qint64 newId;
+        qint64 oldTarget;
+        qint64 line;
+    };
+    QList<ForwardReference> forwardReferences;
+    // Goal hierarchy and prerequisite links as imported, checked for cycles before the last commit
+    QList<Link> partOfLinks;
+    QList<Link> prerequisiteLinks;
+    auto columnIndex = [&types, &typeIndex](const QString &typeName, const QString &columnName) {
+        const QList<Column> &columns = types[typeIndex.value(typeName)].columns;
+        for (int i = 0; i < columns.size(); ++i) {
+            if (columns[i].name == columnName) return i;
+        }
+        return -1;
+    };
+    const int goalType = typeIndex.value("goal");
+    const int prerequisiteType = typeIndex.value("goal_prerequisite");
+    const int partOfColumn = columnIndex("goal", "part_of_goal_id");
+    const int prerequisiteGoalColumn = columnIndex("goal_prerequisite", "goal_id");
+    const int prerequisiteColumn = columnIndex("goal_prerequisite", "prerequisite_id");
+
+    db.transaction();
+    int pending = 0;
+    while (!in.atEnd()) {
+        const QByteArray line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty()) continue;
+
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        if (!document.isObject()) {
+            skip(parseError.errorString());
+            continue;
+        }
+        const QJsonObject record = document.object();
+        const QString typeName = record.value("record").toString();
+        if (typeName == "studybuddy") {
+            if (record.value("version").toInt() > kFormatVersion) {
+                result.errors << QString("line %1: file format version %2 is newer than this app").arg(lineNumber).arg(record.value("version").toInt());
+                db.rollback();
+                return false;
+            }
+            continue;
+        }
+        const int index = typeIndex.value(typeName, -1);
+        if (index < 0) {
+            skip(QString("unknown record '%1'").arg(typeName));
+            continue;
+        }
+
+        // Validate the whole record before binding anything
+        QVariantList values;
+        QList<QPair<QString, qint64>> unresolved; // optional same-type references to patch later
+        QString problem;
+        for (const Column &column : types[index].columns) {
+            QVariant value;
+            if (!fromJson(record.value(column.name), column, value, problem)) break;
+            if (!column.references.isEmpty() && !value.isNull()) {
+                const QHash<qint64, qint64> &ids = idMaps[column.references];
+                auto mapped = ids.constFind(value.toLongLong());
+                if (mapped != ids.constEnd()) {
+                    value = *mapped;
+                } else if (column.required) {
+                    problem = QString("unknown %1 id %2").arg(column.references).arg(value.toLongLong());
+                    break;
+                } else {
+                    if (column.references == typeName) unresolved.append({column.name, value.toLongLong()});
+                    value = QVariant();
+                }
+            }
+            values << value;
+        }
+        if (!problem.isEmpty()) {
+            skip(problem);
+            continue;
+        }
+
+        QSqlQuery &insert = inserts[index];
+        for (const QVariant &value : values) insert.addBindValue(value);
+        if (!insert.exec()) {
+            skip(insert.lastError().text());
+            continue;
+        }
+        const qint64 newId = insert.lastInsertId().toLongLong();
+        if (types[index].table == "surveys"
+            && !Database::addSurveyDistractions(db, newId, record.value("distractions").toString())) {
+            // A survey without its distraction links would drop out of the distraction stats;
+            // the delete trigger clears any links that did get written
+            QSqlQuery undo(db);
+            undo.prepare("DELETE FROM surveys WHERE id = ?");
+            undo.addBindValue(newId);
+            undo.exec();
+            skip("could not link the survey's distractions");
+            continue;
+        }
+        if (record.contains("id")) {
+            idMaps[typeName].insert(record.value("id").toInteger(), newId);
+        }
+        for (const auto &reference : unresolved) {
+            forwardReferences.append({index, reference.first, newId, reference.second, lineNumber});
+        }
+        if (index == goalType && !values[partOfColumn].isNull()) {
+            partOfLinks.append({newId, values[partOfColumn].toLongLong(), lineNumber});
+        } else if (index == prerequisiteType) {
+            prerequisiteLinks.append({values[prerequisiteGoalColumn].toLongLong(), values[prerequisiteColumn].toLongLong(), lineNumber});
+        }
+        ++result.records[typeName];
+
+        if (++pending >= kBatchSize) {
+            if (!db.commit()) {
+                result.errors << db.lastError().text();
+                db.rollback();
+                return false;
+            }
+            db.transaction();
+            pending = 0;
+        }
+    }
+
+    // Every record has been read, so forward references can be resolved now; ones to
+    // records missing from the file stay NULL
+    for (const ForwardReference &reference : forwardReferences) {
+        const RecordType &type = types[reference.typeIndex];
+        auto mapped = idMaps[type.name].constFind(reference.oldTarget);
+        if (mapped == idMaps[type.name].constEnd()) continue;
+        QSqlQuery update(db);
+        update.prepare(QString("UPDATE %1 SET %2 = ? WHERE id = ?").arg(type.table, reference.column));
+        update.addBindValue(*mapped);
+        update.addBindValue(reference.newId);
+        if (!update.exec()) {
+            result.errors << update.lastError().text();
+            db.rollback();
+            return false;
+        }
+        if (reference.typeIndex == goalType && reference.column == "part_of_goal_id") {
+            partOfLinks.append({reference.newId, *mapped, reference.line});
+        }
+    }
+    if (!dropCycles(db, partOfLinks, prerequisiteLinks, result)) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        result.errors << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+}
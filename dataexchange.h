@@ -0,0 +1,29 @@
+#ifndef DATAEXCHANGE_H
+#define DATAEXCHANGE_H
+
+#include <QSqlDatabase>
+#include <QIODevice>
+#include <QMap>
+#include <QStringList>
+
+// JSON Lines import/export of goals, goal resources and prerequisites, study sessions, session links
+// and surveys. One record per line, e.g. {"record":"goal","id":12,"subject":"Math",...};
+// the first line is a {"record":"studybuddy","version":1} header. Both directions stream
+// row by row; only the old -> new id maps are kept in memory while importing.
+namespace DataExchange {
+
+struct Report {
+    QMap<QString, qint64> records; // record type -> rows written or imported
+    qint64 skipped = 0;
+    QStringList errors;            // first few problems, with line numbers
+};
+
+bool exportJsonLines(QSqlDatabase &db, QIODevice &out, Report *report = nullptr);
+
+// Records are inserted in batched transactions with fresh ids; references between
+// records are remapped and records that fail validation are skipped
+bool importJsonLines(QSqlDatabase &db, QIODevice &in, Report *report = nullptr);
+
+}
+
+#endif // DATAEXCHANGE_H
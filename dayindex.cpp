@@ -0,0 +1,147 @@
+#include "dayindex.h"
+
+void DayIndex::clear()
+{
+    *this = DayIndex();
+}
+
+int DayIndex::offsetOf(const QDate &date) const
+{
+    if (dayCount == 0 || !date.isValid()) return -1;
+    const qint64 offset = origin.daysTo(date);
+    return offset >= 0 && offset < dayCount ? int(offset) : -1;
+}
+
+void DayIndex::coverYear(int year)
+{
+    if (dayCount > 0 && year >= origin.year() && year <= origin.addDays(dayCount - 1).year()) return;
+
+    const int firstYear = dayCount == 0 ? year : qMin(year, origin.year());
+    const int lastYear = dayCount == 0 ? year : qMax(year, origin.addDays(dayCount - 1).year());
+    const QDate newOrigin(firstYear, 1, 1);
+    const int newCount = int(newOrigin.daysTo(QDate(lastYear, 12, 31))) + 1;
+    const int shift = dayCount == 0 ? 0 : int(newOrigin.daysTo(origin));
+
+    // Earlier years shift every bit, so rebuild instead of growing in place
+    std::vector<quint64> newWords((newCount + 63) / 64, 0);
+    std::vector<qint64> newPrefix(newCount + 1, 0);
+    for (int offset = 0; offset < dayCount; ++offset) {
+        if (testBit(offset)) {
+            const int moved = offset + shift;
+            newWords[moved / 64] |= quint64(1) << (moved % 64);
+        }
+        newPrefix[offset + shift + 1] = prefix[offset + 1];
+    }
+    const qint64 total = totalMinutes();
+    for (int offset = shift + dayCount + 1; offset <= newCount; ++offset) newPrefix[offset] = total;
+
+    if (firstDay >= 0) {
+        firstDay += shift;
+        lastDay += shift;
+    }
+    origin = newOrigin;
+    dayCount = newCount;
+    words.swap(newWords);
+    prefix.swap(newPrefix);
+}
+
+void DayIndex::addMinutes(const QDate &date, int minutes)
+{
+    if (!date.isValid()) return;
+    coverYear(date.year());
+    const int offset = offsetOf(date);
+
+    if (minutes != 0) {
+        // Recording usually happens today, near the end of the last year
+        for (size_t i = offset + 1; i < prefix.size(); ++i) prefix[i] += minutes;
+    }
+    if (testBit(offset)) return;
+
+    words[offset / 64] |= quint64(1) << (offset % 64);
+    ++studyDays;
+    firstDay = firstDay < 0 ? offset : qMin(firstDay, offset);
+    lastDay = qMax(lastDay, offset);
+    // Days are only ever added, so the longest run can only grow through this day
+    longest = qMax(longest, runBackward(offset) + runForward(offset) - 1);
+}
+
+bool DayIndex::isStudyDay(const QDate &date) const
+{
+    const int offset = offsetOf(date);
+    return offset >= 0 && testBit(offset);
+}
+
+int DayIndex::minutesOn(const QDate &date) const
+{
+    const int offset = offsetOf(date);
+    return offset < 0 ? 0 : int(prefix[offset + 1] - prefix[offset]);
+}
+
+qint64 DayIndex::minutesBetween(const QDate &from, const QDate &to) const
+{
+    if (dayCount == 0 || !from.isValid() || !to.isValid()) return 0;
+    const qint64 first = qMax<qint64>(0, origin.daysTo(from));
+    const qint64 last = qMin<qint64>(dayCount - 1, origin.daysTo(to));
+    if (first > last) return 0;
+    return prefix[last + 1] - prefix[first];
+}
+
+int DayIndex::studyDaysBetween(const QDate &from, const QDate &to) const
+{
+    if (dayCount == 0 || !from.isValid() || !to.isValid()) return 0;
+    const qint64 first = qMax<qint64>(0, origin.daysTo(from));
+    const qint64 last = qMin<qint64>(dayCount - 1, origin.daysTo(to));
+    if (first > last) return 0;
+
+    int days = 0;
+    for (qint64 word = first / 64; word <= last / 64; ++word) {
+        quint64 bits = words[word];
+        if (word == first / 64) bits &= ~quint64(0) << (first % 64);
+        if (word == last / 64 && last % 64 != 63) bits &= (quint64(1) << (last % 64 + 1)) - 1;
+        days += std::popcount(bits);
+    }
+    return days;
+}
+
+QDate DayIndex::firstStudyDay() const
+{
+    return firstDay < 0 ? QDate() : origin.addDays(firstDay);
+}
+
+QDate DayIndex::lastStudyDay() const
+{
+    return lastDay < 0 ? QDate() : origin.addDays(lastDay);
+}
+
+int DayIndex::runEndingAt(const QDate &date) const
+{
+    const int offset = offsetOf(date);
+    return offset < 0 ? 0 : runBackward(offset);
+}
+
+int DayIndex::runBackward(int offset) const
+{
+    // Move the day to the top bit and count the set bits below it
+    const int bit = offset % 64;
+    int run = std::countl_one(words[offset / 64] << (63 - bit));
+    if (run < bit + 1) return run;
+    for (int word = offset / 64 - 1; word >= 0; --word) {
+        const int ones = std::countl_one(words[word]);
+        run += ones;
+        if (ones < 64) break;
+    }
+    return run;
+}
+
+int DayIndex::runForward(int offset) const
+{
+    const int bit = offset % 64;
+    int run = std::countr_one(words[offset / 64] >> bit);
+    if (run < 64 - bit) return run;
+    for (size_t word = offset / 64 + 1; word < words.size(); ++word) {
+        const int ones = std::countr_one(words[word]);
+        run += ones;
+        if (ones < 64) break;
+    }
+    return run;
+}
@@ -0,0 +1,75 @@
+#ifndef DAYINDEX_H
+#define DAYINDEX_H
+
+#include <QDate>
+#include <QtGlobal>
+#include <vector>
+#include <bit>
+
+// In-memory index of study days: one bit per calendar day plus a prefix sum of
+// minutes, covering whole years from the first to the last recorded year. Range
+// sums are O(1), day counts and runs scan 64 days per word.
+class DayIndex
+{
+public:
+    void clear();
+
+    // Marks the day as studied and adds minutes to it
+    void addMinutes(const QDate &date, int minutes);
+
+    bool isStudyDay(const QDate &date) const;
+    int minutesOn(const QDate &date) const;
+
+    // Inclusive ranges; days outside the indexed years count as empty
+    qint64 minutesBetween(const QDate &from, const QDate &to) const;
+    int studyDaysBetween(const QDate &from, const QDate &to) const;
+
+    int totalStudyDays() const { return studyDays; }
+    qint64 totalMinutes() const { return prefix.empty() ? 0 : prefix.back(); }
+    QDate firstStudyDay() const;
+    QDate lastStudyDay() const;
+
+    // Consecutive study days ending on date; 0 if date was not studied
+    int runEndingAt(const QDate &date) const;
+    int longestRun() const { return longest; }
+
+    // Calls f(date, minutes) for every study day in the range, in date order
+    template<typename F>
+    void forEachStudyDay(const QDate &from, const QDate &to, F f) const;
+
+private:
+    int offsetOf(const QDate &date) const;
+    void coverYear(int year);
+    bool testBit(int offset) const { return (words[offset / 64] >> (offset % 64)) & 1; }
+    int runBackward(int offset) const;
+    int runForward(int offset) const;
+
+    QDate origin;               // January 1st of the first indexed year
+    int dayCount = 0;           // indexed days, whole years
+    std::vector<quint64> words; // bit i: day origin + i was studied
+    std::vector<qint64> prefix; // prefix[i]: minutes on days before origin + i
+    int studyDays = 0;
+    int firstDay = -1;
+    int lastDay = -1;
+    int longest = 0;
+};
+
+template<typename F>
+void DayIndex::forEachStudyDay(const QDate &from, const QDate &to, F f) const
+{
+    if (dayCount == 0 || !from.isValid() || !to.isValid()) return;
+    const int first = qMax<qint64>(0, origin.daysTo(from));
+    const int last = qMin<qint64>(dayCount - 1, origin.daysTo(to));
+    for (int word = first / 64; word <= last / 64 && first <= last; ++word) {
+        quint64 bits = words[word];
+        while (bits) {
+            const int offset = word * 64 + std::countr_zero(bits);
+            bits &= bits - 1;
+            if (offset < first) continue;
+            if (offset > last) return;
+            f(origin.addDays(offset), int(prefix[offset + 1] - prefix[offset]));
+        }
+    }
+}
+
+#endif // DAYINDEX_H
@@ -0,0 +1,143 @@
+#include "downsampler.h"
+#include <QXYSeries>
+#include <QtMath>
+
+namespace Downsampler {
+
+namespace {
+const int kDefaultPixelWidth = 500;
+const int kMinThreshold = 3;
+}
+
+QList<QPointF> lttb(const QList<QPointF> &points, int threshold)
+{
+    const int n = points.size();
+    if (threshold < kMinThreshold || threshold >= n) {
+        return points;
+    }
+
+    QList<QPointF> sampled;
+    sampled.reserve(threshold);
+
+    // First and last points are always kept; the rest is split into buckets
+    const double bucketSize = double(n - 2) / (threshold - 2);
+    int a = 0;
+    sampled.append(points[a]);
+
+    for (int i = 0; i < threshold - 2; ++i) {
+        // Average of the next bucket is the third vertex of the triangle
+        int avgStart = int(qFloor((i + 1) * bucketSize)) + 1;
+        int avgEnd = qMin(int(qFloor((i + 2) * bucketSize)) + 1, n);
+        double avgX = 0, avgY = 0;
+        for (int j = avgStart; j < avgEnd; ++j) {
+            avgX += points[j].x();
+            avgY += points[j].y();
+        }
+        const int avgCount = avgEnd - avgStart;
+        if (avgCount > 0) {
+            avgX /= avgCount;
+            avgY /= avgCount;
+        } else {
+            avgX = points[n - 1].x();
+            avgY = points[n - 1].y();
+        }
+
+        // Pick the point of the current bucket forming the largest triangle
+        int rangeStart = int(qFloor(i * bucketSize)) + 1;
+        int rangeEnd = int(qFloor((i + 1) * bucketSize)) + 1;
+        const double ax = points[a].x();
+        const double ay = points[a].y();
+        double maxArea = -1;
+        int maxIndex = rangeStart;
+        for (int j = rangeStart; j < rangeEnd; ++j) {
+            double area = qAbs((ax - avgX) * (points[j].y() - ay)
+                               - (ax - points[j].x()) * (avgY - ay));
+            if (area > maxArea) {
+                maxArea = area;
+                maxIndex = j;
+            }
+        }
+        sampled.append(points[maxIndex]);
+        a = maxIndex;
+    }
+
+    sampled.append(points[n - 1]);
+    return sampled;
+}
+
+int thresholdForWidth(int pixelWidth)
+{
+    // One point per horizontal pixel is all a line series can show
+    if (pixelWidth <= 0) pixelWidth = kDefaultPixelWidth;
+    return qMax(kMinThreshold, pixelWidth);
+}
+
+void setSeriesPoints(QXYSeries *series, const QList<QPointF> &points, int pixelWidth)
+{
+    if (!series) return;
+    series->replace(lttb(points, thresholdForWidth(pixelWidth)));
+}
+
+void WindowDecimator::reset(double windowWidth, int bucketCount)
+{
+    maxBuckets = qMax(1, bucketCount);
+    bucketWidth = windowWidth > 0 ? windowWidth / maxBuckets : 1.0;
+    buckets.setCapacity(maxBuckets + 1);
+    newestX = 0.0;
+}
+
+void WindowDecimator::clear()
+{
+    buckets.clear();
+    newestX = 0.0;
+}
+
+void WindowDecimator::append(const QPointF &point)
+{
+    const qint64 index = qFloor(point.x() / bucketWidth);
+    newestX = point.x();
+    if (!buckets.isEmpty() && buckets.last().index == index) {
+        Bucket &bucket = buckets.last();
+        if (point.y() < bucket.low.y()) bucket.low = point;
+        if (point.y() > bucket.high.y()) bucket.high = point;
+    } else {
+        buckets.append({index, point, point});
+    }
+    // Buckets that slid out of the window
+    while (buckets.first().index <= index - maxBuckets) buckets.removeFirst();
+}
+
+double WindowDecimator::firstX() const
+{
+    if (buckets.isEmpty()) return 0.0;
+    return qMin(buckets.first().low.x(), buckets.first().high.x());
+}
+
+void WindowDecimator::points(QList<QPointF> &out, int pixelWidth) const
+{
+    // Two points per run, so half as many runs as pixels
+    const int runs = qMax(1, thresholdForWidth(pixelWidth) / 2);
+    const int runLength = (buckets.size() + runs - 1) / runs;
+    out.clear();
+    out.reserve(qMin(buckets.size(), runs) * 2);
+    for (int start = 0; start < buckets.size(); start += runLength) {
+        QPointF low = buckets.at(start).low;
+        QPointF high = buckets.at(start).high;
+        for (int i = start + 1; i < qMin(start + runLength, buckets.size()); ++i) {
+            const Bucket &bucket = buckets.at(i);
+            if (bucket.low.y() < low.y()) low = bucket.low;
+            if (bucket.high.y() > high.y()) high = bucket.high;
+        }
+        if (low.x() == high.x()) {
+            out.append(low);
+        } else if (low.x() < high.x()) {
+            out.append(low);
+            out.append(high);
+        } else {
+            out.append(high);
+            out.append(low);
+        }
+    }
+}
+
+}
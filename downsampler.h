@@ -0,0 +1,56 @@
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+#include <QList>
+#include <QPointF>
+#include "ringbuffer.h"
+
+class QXYSeries;
+
+namespace Downsampler {
+
+// Largest-Triangle-Three-Buckets: keeps the first and last point and picks one
+// visually significant point per bucket. Input must be sorted by x.
+QList<QPointF> lttb(const QList<QPointF> &points, int threshold);
+
+// Number of points worth drawing for a chart that is pixelWidth pixels wide.
+int thresholdForWidth(int pixelWidth);
+
+// Downsamples points for the given pixel width and pushes them into the series
+// with a single replace() instead of per-point append().
+void setSeriesPoints(QXYSeries *series, const QList<QPointF> &points, int pixelWidth);
+
+// Min/max decimation of a live stream over a sliding x window. Each sample only
+// updates the bucket of fixed x width it falls in, and only the buckets are kept,
+// so reading the window costs the bucket count, not the number of samples.
+class WindowDecimator
+{
+public:
+    void reset(double windowWidth, int bucketCount);
+    void clear();
+    // x must not decrease between calls
+    void append(const QPointF &point);
+
+    bool isEmpty() const { return buckets.isEmpty(); }
+    double firstX() const;
+    double lastX() const { return newestX; }
+    // Replaces out with the lowest and highest point of each run of buckets, in x order,
+    // merging adjacent buckets until about pixelWidth points remain; out's allocation is
+    // reused between calls
+    void points(QList<QPointF> &out, int pixelWidth) const;
+
+private:
+    struct Bucket {
+        qint64 index = 0;
+        QPointF low;
+        QPointF high;
+    };
+    RingBuffer<Bucket> buckets;
+    double bucketWidth = 1.0;
+    int maxBuckets = 0;
+    double newestX = 0.0;
+};
+
+}
+
+#endif // DOWNSAMPLER_H
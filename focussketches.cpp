@@ -0,0 +1,306 @@
+#include "focussketches.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDataStream>
+#include <QDebug>
+
+namespace {
+const QString kHourScope = "hour";
+const QString kSubjectScope = "subject";
+// One row whose sample_count is the id of the newest detection in the hour sketches
+const QString kCursorScope = "cursor";
+const QString kCursorKey = "detections";
+const double kCompression = 100.0;
+const quint8 kFormatVersion = 1;
+// About one minute of detections at 30 Hz
+const int kFlushEverySamples = 1800;
+// A week of hours; bounds memory while catching up on a long history
+const int kMaxDirtyHours = 24 * 7;
+
+QString hourKey(const QDateTime &timestamp)
+{
+    return timestamp.toString("yyyy-MM-dd HH");
+}
+}
+
+FocusSketchStore::FocusSketchStore(QSqlDatabase &database, QObject *parent)
+    : QObject(parent),
+      db(database)
+{
+}
+
+void FocusSketchStore::addSample(qint64 detectionId, const QDateTime &timestamp, double focusScore, const QStringList &subjects)
+{
+    if (!timestamp.isValid()) return;
+    if (detectionId > lastDetectionId) {
+        lastDetectionId = detectionId;
+        cursorDirty = true;
+    }
+
+    const QString key = hourKey(timestamp);
+    sketchFor(hourSketches, kHourScope, key).add(focusScore);
+    dirtyHours.insert(key);
+
+    for (const QString &subject : subjects) {
+        const QString name = subject.trimmed();
+        if (name.isEmpty()) continue;
+        sketchFor(subjectSketches, kSubjectScope, name).add(focusScore);
+        dirtySubjects.insert(name);
+    }
+
+    if (++pendingSamples >= kFlushEverySamples) {
+        flush();
+    }
+}
+
+bool FocusSketchStore::flush()
+{
+    if (dirtyHours.isEmpty() && dirtySubjects.isEmpty() && !cursorDirty) return true;
+    if (!db.isOpen()) return false;
+
+    // The cursor commits with the sketches so a detection is never folded in twice
+    db.transaction();
+    if (!writeSketches(kHourScope, hourSketches, dirtyHours) ||
+        !writeSketches(kSubjectScope, subjectSketches, dirtySubjects) ||
+        !writeCursor()) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        qDebug() << "Error committing focus sketches:" << db.lastError().text();
+        return false;
+    }
+
+    // Hour sketches are read back from the table by range, so saved ones need not stay in memory
+    hourSketches.clear();
+    dirtyHours.clear();
+    dirtySubjects.clear();
+    cursorDirty = false;
+    pendingSamples = 0;
+    return true;
+}
+
+void FocusSketchStore::skipDetection(qint64 detectionId)
+{
+    if (detectionId <= lastDetectionId) return;
+    lastDetectionId = detectionId;
+    cursorDirty = true;
+}
+
+bool FocusSketchStore::rebuildFromDetections()
+{
+    if (!loadCursor()) return false;
+
+    // One forward pass over the id range; timestamps are stored as "yyyy-MM-dd HH:mm:ss",
+    // so the hour key is a prefix and no date parsing is needed
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, timestamp, focus_score FROM detections WHERE id > ? ORDER BY id");
+    query.addBindValue(lastDetectionId);
+    if (!query.exec()) {
+        qDebug() << "Error reading detections for focus sketches:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        const QString key = query.value(1).toString().left(13);
+        sketchFor(hourSketches, kHourScope, key).add(query.value(2).toDouble());
+        dirtyHours.insert(key);
+        lastDetectionId = query.value(0).toLongLong();
+        cursorDirty = true;
+        if (dirtyHours.size() >= kMaxDirtyHours && !flush()) return false;
+    }
+    return flush();
+}
+
+bool FocusSketchStore::loadCursor()
+{
+    if (lastDetectionId >= 0) return true;
+
+    QSqlQuery query(db);
+    query.prepare("SELECT sample_count FROM focus_sketches WHERE scope = ? AND sketch_key = ?");
+    query.addBindValue(kCursorScope);
+    query.addBindValue(kCursorKey);
+    if (!query.exec()) {
+        qDebug() << "Error loading focus sketch cursor:" << query.lastError().text();
+        return false;
+    }
+    if (query.next()) {
+        lastDetectionId = query.value(0).toLongLong();
+        return true;
+    }
+
+    // Sketches built before the cursor existed already hold every detection
+    lastDetectionId = 0;
+    if (!query.exec("SELECT EXISTS (SELECT 1 FROM focus_sketches WHERE scope = 'hour'), "
+                    "(SELECT MAX(id) FROM detections)") || !query.next()) {
+        qDebug() << "Error checking focus sketches:" << query.lastError().text();
+        return false;
+    }
+    if (query.value(0).toBool()) {
+        lastDetectionId = query.value(1).toLongLong();
+        cursorDirty = true;
+    }
+    return true;
+}
+
+bool FocusSketchStore::writeCursor()
+{
+    if (!cursorDirty) return true;
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO focus_sketches (scope, sketch_key, digest, sample_count, updated_at) "
+                  "VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(kCursorScope);
+    query.addBindValue(kCursorKey);
+    query.addBindValue(QByteArray(""));
+    query.addBindValue(lastDetectionId);
+    query.addBindValue(QDateTime::currentDateTime().toString(Qt::ISODate));
+    if (!query.exec()) {
+        qDebug() << "Error saving focus sketch cursor:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+TDigest FocusSketchStore::rangeSketch(const QDate &startDate, const QDate &endDate) const
+{
+    TDigest result(kCompression);
+    const QHash<QString, TDigest> sketches = loadHourSketches(startDate, endDate);
+    for (const TDigest &digest : sketches) {
+        result.merge(digest);
+    }
+    return result;
+}
+
+QMap<int, TDigest> FocusSketchStore::hourOfDaySketches(const QDate &startDate, const QDate &endDate) const
+{
+    QMap<int, TDigest> result;
+    const QHash<QString, TDigest> sketches = loadHourSketches(startDate, endDate);
+    for (auto it = sketches.begin(); it != sketches.end(); ++it) {
+        const int hour = it.key().right(2).toInt();
+        auto slot = result.find(hour);
+        if (slot == result.end()) {
+            slot = result.insert(hour, TDigest(kCompression));
+        }
+        slot->merge(it.value());
+    }
+    return result;
+}
+
+TDigest FocusSketchStore::subjectSketch(const QString &subject) const
+{
+    auto it = subjectSketches.find(subject);
+    if (it != subjectSketches.end()) return it.value();
+
+    QSqlQuery query(db);
+    query.prepare("SELECT digest FROM focus_sketches WHERE scope = ? AND sketch_key = ?");
+    query.addBindValue(kSubjectScope);
+    query.addBindValue(subject);
+    if (!query.exec()) {
+        qDebug() << "Error loading subject sketch:" << query.lastError().text();
+        return TDigest(kCompression);
+    }
+    return query.next() ? deserialize(query.value(0).toByteArray()) : TDigest(kCompression);
+}
+
+QByteArray FocusSketchStore::serialize(const TDigest &digest)
+{
+    QByteArray blob;
+    QDataStream out(&blob, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    const std::vector<TDigest::Centroid> &centroids = digest.centroids();
+    out << kFormatVersion << digest.compression() << digest.min() << digest.max()
+        << quint32(centroids.size());
+    for (const TDigest::Centroid &c : centroids) {
+        out << c.mean << c.weight;
+    }
+    return blob;
+}
+
+TDigest FocusSketchStore::deserialize(const QByteArray &blob)
+{
+    QDataStream in(blob);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint8 version = 0;
+    double compression = kCompression, min = 0, max = 0;
+    quint32 count = 0;
+    in >> version >> compression >> min >> max >> count;
+    if (in.status() != QDataStream::Ok || version != kFormatVersion) {
+        qDebug() << "Ignoring unreadable focus sketch, version" << version;
+        return TDigest(kCompression);
+    }
+
+    std::vector<TDigest::Centroid> centroids;
+    centroids.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        TDigest::Centroid c;
+        in >> c.mean >> c.weight;
+        centroids.push_back(c);
+    }
+    return TDigest::fromCentroids(compression, min, max, centroids);
+}
+
+TDigest &FocusSketchStore::sketchFor(QHash<QString, TDigest> &sketches, const QString &scope, const QString &key)
+{
+    auto it = sketches.find(key);
+    if (it != sketches.end()) return it.value();
+
+    // First touch this run: continue from the persisted sketch, if any
+    TDigest digest(kCompression);
+    QSqlQuery query(db);
+    query.prepare("SELECT digest FROM focus_sketches WHERE scope = ? AND sketch_key = ?");
+    query.addBindValue(scope);
+    query.addBindValue(key);
+    if (query.exec() && query.next()) {
+        digest = deserialize(query.value(0).toByteArray());
+    }
+    return sketches.insert(key, digest).value();
+}
+
+QHash<QString, TDigest> FocusSketchStore::loadHourSketches(const QDate &startDate, const QDate &endDate) const
+{
+    QHash<QString, TDigest> result;
+    const QString first = startDate.toString("yyyy-MM-dd") + " 00";
+    const QString last = endDate.toString("yyyy-MM-dd") + " 23";
+
+    QSqlQuery query(db);
+    query.prepare("SELECT sketch_key, digest FROM focus_sketches "
+                  "WHERE scope = ? AND sketch_key BETWEEN ? AND ?");
+    query.addBindValue(kHourScope);
+    query.addBindValue(first);
+    query.addBindValue(last);
+    if (!query.exec()) {
+        qDebug() << "Error loading focus sketches:" << query.lastError().text();
+    }
+    while (query.next()) {
+        result.insert(query.value(0).toString(), deserialize(query.value(1).toByteArray()));
+    }
+
+    // Sketches not flushed yet already include their persisted state and are newer
+    for (auto it = hourSketches.begin(); it != hourSketches.end(); ++it) {
+        if (it.key() >= first && it.key() <= last) {
+            result.insert(it.key(), it.value());
+        }
+    }
+    return result;
+}
+
+bool FocusSketchStore::writeSketches(const QString &scope, const QHash<QString, TDigest> &sketches, const QSet<QString> &keys)
+{
+    const QString now = QDateTime::currentDateTime().toString(Qt::ISODate);
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO focus_sketches (scope, sketch_key, digest, sample_count, updated_at) "
+                  "VALUES (?, ?, ?, ?, ?)");
+    for (const QString &key : keys) {
+        const TDigest digest = sketches.value(key);
+        query.addBindValue(scope);
+        query.addBindValue(key);
+        query.addBindValue(serialize(digest));
+        query.addBindValue(qint64(digest.count()));
+        query.addBindValue(now);
+        if (!query.exec()) {
+            qDebug() << "Error saving focus sketch" << scope << key << ":" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
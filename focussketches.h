@@ -0,0 +1,62 @@
+#ifndef FOCUSSKETCHES_H
+#define FOCUSSKETCHES_H
+
+#include "tdigest.h"
+#include <QObject>
+#include <QSqlDatabase>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QList>
+#include <QByteArray>
+#include <QStringList>
+
+// Focus-score t-digests kept per (day, hour) and per subject, persisted as
+// blobs in focus_sketches. Range quantiles merge sketches instead of
+// scanning detections.
+class FocusSketchStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FocusSketchStore(QSqlDatabase &database, QObject *parent = nullptr);
+
+    // Samples are buffered in memory; call flush() before the database closes.
+    // detectionId is the detections row the sample was logged as
+    void addSample(qint64 detectionId, const QDateTime &timestamp, double focusScore, const QStringList &subjects);
+    bool flush();
+    // Moves the catch-up cursor past a detections row that is not a focus sample,
+    // such as the per-session summary
+    void skipDetection(qint64 detectionId);
+
+    // Folds detections newer than the last one in the hourly sketches, so only
+    // the first run after an upgrade reads the whole table
+    bool rebuildFromDetections();
+
+    TDigest rangeSketch(const QDate &startDate, const QDate &endDate) const;
+    // Hour of day (0-23) -> sketch merged over every day in the range
+    QMap<int, TDigest> hourOfDaySketches(const QDate &startDate, const QDate &endDate) const;
+    TDigest subjectSketch(const QString &subject) const;
+
+    static QByteArray serialize(const TDigest &digest);
+    static TDigest deserialize(const QByteArray &blob);
+
+private:
+    TDigest &sketchFor(QHash<QString, TDigest> &sketches, const QString &scope, const QString &key);
+    QHash<QString, TDigest> loadHourSketches(const QDate &startDate, const QDate &endDate) const;
+    bool writeSketches(const QString &scope, const QHash<QString, TDigest> &sketches, const QSet<QString> &keys);
+    bool loadCursor();
+    bool writeCursor();
+
+    QSqlDatabase &db;
+    QHash<QString, TDigest> hourSketches;    // "yyyy-MM-dd HH" -> digest, until the next flush
+    QHash<QString, TDigest> subjectSketches; // subject -> digest
+    QSet<QString> dirtyHours;
+    QSet<QString> dirtySubjects;
+    int pendingSamples = 0;
+    qint64 lastDetectionId = -1; // newest detection in the hour sketches; -1 until loaded
+    bool cursorDirty = false;
+};
+
+#endif // FOCUSSKETCHES_H
@@ -0,0 +1,64 @@
+#include "iconcache.h"
+#include <QHash>
+#include <QIcon>
+#include <QPainter>
+
+namespace IconCache {
+
+namespace {
+// Far more than the app draws; a cap only guards against unbounded growth
+const int kMaxEntries = 512;
+
+struct Key {
+    QString path;
+    QSize size;
+    State state;
+    qreal devicePixelRatio;
+
+    bool operator==(const Key &other) const
+    {
+        return path == other.path && size == other.size && state == other.state
+               && devicePixelRatio == other.devicePixelRatio;
+    }
+};
+
+size_t qHash(const Key &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.path, key.size.width(), key.size.height(), int(key.state), key.devicePixelRatio);
+}
+
+QHash<Key, QPixmap> &cache()
+{
+    static QHash<Key, QPixmap> pixmaps;
+    return pixmaps;
+}
+
+// Locked achievements are drawn faded
+QPixmap faded(const QPixmap &pixmap)
+{
+    QPixmap result(pixmap.size());
+    result.setDevicePixelRatio(pixmap.devicePixelRatio());
+    result.fill(Qt::transparent);
+    QPainter painter(&result);
+    painter.setOpacity(0.3);
+    painter.drawPixmap(0, 0, pixmap);
+    painter.end();
+    return result;
+}
+}
+
+QPixmap pixmap(const QString &path, const QSize &size, State state, qreal devicePixelRatio)
+{
+    QHash<Key, QPixmap> &pixmaps = cache();
+    const auto found = pixmaps.constFind(Key{path, size, state, devicePixelRatio});
+    if (found != pixmaps.cend()) return found.value();
+
+    if (pixmaps.size() >= kMaxEntries) pixmaps.clear();
+    const QPixmap unlocked = QIcon(path).pixmap(size, devicePixelRatio);
+    const QPixmap locked = unlocked.isNull() ? unlocked : faded(unlocked);
+    pixmaps.insert(Key{path, size, State::Unlocked, devicePixelRatio}, unlocked);
+    pixmaps.insert(Key{path, size, State::Locked, devicePixelRatio}, locked);
+    return state == State::Locked ? locked : unlocked;
+}
+
+}
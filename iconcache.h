@@ -0,0 +1,19 @@
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+// Pixmaps for icons that are drawn over and over, keyed by path, size, state and
+// device pixel ratio. Both states of an icon are rendered on its first use, so
+// switching an achievement between locked and unlocked never repaints an icon.
+namespace IconCache {
+
+enum class State { Unlocked, Locked };
+
+QPixmap pixmap(const QString &path, const QSize &size, State state, qreal devicePixelRatio);
+
+}
+
+#endif // ICONCACHE_H
@@ -3,6 +3,11 @@
 #include "analytics.h"
 #include "achievements.h"
 #include "survey.h"
+#include "downsampler.h"
+#include "database.h"
+#include "dataexchange.h"
+#include "activityheatmap.h"
+#include "iconcache.h"
 #include <QMessageBox>
 #include <QFileInfo>
 #include <QCoreApplication>
@@ -69,6 +74,18 @@
 #endif
 #include <QSettings>
 #include <QTabBar>
+#include <QStandardItem>
+#include <QAbstractItemView>
+#include <QSet>
+#include <QResizeEvent>
+
+namespace {
+const int kFrameIntervalMs = 33;
+const int kLiveChartWindowMinutes = 60;
+// Min/max buckets kept per live series, enough for a chart as wide as a 4K screen;
+// each refresh merges them down to the view's width
+const int kLiveChartBuckets = 3840;
+}
 
 bool MainWindow::initializeDatabase()
 {
@@ -92,42 +109,11 @@ bool MainWindow::initializeDatabase()
 
     qDebug() << "Database connected successfully at" << db.databaseName();
 
-    QSqlQuery query(db);
-    // Create all tables for the unified schema
-    QStringList createTableQueries = {
-        // detections
-        "CREATE TABLE IF NOT EXISTS detections (id INTEGER PRIMARY KEY AUTOINCREMENT, timestamp TEXT NOT NULL, face_count INTEGER NOT NULL, eyes_detected BOOLEAN NOT NULL, blink_count INTEGER NOT NULL, focus_score REAL NOT NULL)",
-        // session_plans
-        "CREATE TABLE IF NOT EXISTS session_plans (id INTEGER PRIMARY KEY AUTOINCREMENT, subject TEXT NOT NULL, goals TEXT, resource_link TEXT, mental_state TEXT, plan_date TEXT NOT NULL)",
-        // session_reviews
-        "CREATE TABLE IF NOT EXISTS session_reviews (id INTEGER PRIMARY KEY AUTOINCREMENT, session_plan_id INTEGER NOT NULL, focus_score REAL, distraction_events TEXT, effectiveness TEXT, notes TEXT, review_date TEXT NOT NULL, session_id INTEGER, FOREIGN KEY(session_plan_id) REFERENCES session_plans(id))",
-        // study_sessions
-        "CREATE TABLE IF NOT EXISTS study_sessions (id INTEGER PRIMARY KEY AUTOINCREMENT, planned_session_id INTEGER, start_time TEXT, end_time TEXT, type TEXT, notes TEXT)",
-        // goals
-        "CREATE TABLE IF NOT EXISTS goals (id INTEGER PRIMARY KEY AUTOINCREMENT, subject TEXT NOT NULL, target_minutes INTEGER NOT NULL, completed_minutes INTEGER DEFAULT 0, start_date TEXT NOT NULL, due_date TEXT, status TEXT DEFAULT 'Active', notes TEXT, recurrence_type TEXT DEFAULT 'None', recurrence_value TEXT, last_generated_date TEXT, category TEXT DEFAULT 'Uncategorized')",
-        // goal_resources
-        "CREATE TABLE IF NOT EXISTS goal_resources (id INTEGER PRIMARY KEY AUTOINCREMENT, goal_id INTEGER NOT NULL, type TEXT NOT NULL, value TEXT NOT NULL, description TEXT, FOREIGN KEY(goal_id) REFERENCES goals(id))",
-        // session_resources
-        "CREATE TABLE IF NOT EXISTS session_resources (id INTEGER PRIMARY KEY AUTOINCREMENT, session_id INTEGER NOT NULL, type TEXT NOT NULL, value TEXT NOT NULL, description TEXT, FOREIGN KEY(session_id) REFERENCES study_sessions(id))",
-        // session_goals
-        "CREATE TABLE IF NOT EXISTS session_goals (id INTEGER PRIMARY KEY AUTOINCREMENT, session_id INTEGER NOT NULL, goal_id INTEGER NOT NULL, FOREIGN KEY(session_id) REFERENCES study_sessions(id), FOREIGN KEY(goal_id) REFERENCES goals(id))",
-        // surveys
-        "CREATE TABLE IF NOT EXISTS surveys (id INTEGER PRIMARY KEY AUTOINCREMENT, goal_id INTEGER NOT NULL, timestamp TEXT NOT NULL, mood_emoji TEXT, distraction_level INTEGER, distractions TEXT, session_satisfaction INTEGER, goal_achieved TEXT, open_feedback TEXT, set_reminder INTEGER)",
-        // study_streaks
-        "CREATE TABLE IF NOT EXISTS study_streaks (id INTEGER PRIMARY KEY AUTOINCREMENT, date TEXT NOT NULL UNIQUE, study_minutes INTEGER NOT NULL, streak_count INTEGER NOT NULL, created_at TEXT NOT NULL)",
-        // achievements
-        "CREATE TABLE IF NOT EXISTS achievements (id TEXT PRIMARY KEY, name TEXT NOT NULL, description TEXT NOT NULL, category TEXT NOT NULL, required_value INTEGER NOT NULL, icon_path TEXT, unlocked_at TEXT, progress INTEGER DEFAULT 0)",
-        // free_time
-        "CREATE TABLE IF NOT EXISTS free_time (date TEXT PRIMARY KEY, morning_minutes INTEGER, evening_minutes INTEGER, night_minutes INTEGER)"
-    };
-    for (const QString& q : createTableQueries) {
-        if (!query.exec(q)) {
-        qDebug() << "Error: Failed to create table" << query.lastError().text();
-            qDebug() << "Query was:" << q;
-        QMessageBox::critical(this, "Database Error", "Failed to create table: " + query.lastError().text());
+    QString schemaError;
+    if (!Database::createSchema(db, &schemaError)) {
+        QMessageBox::critical(this, "Database Error", "Failed to create table: " + schemaError);
         return false;
     }
-    }
     qDebug() << "All tables for studybuddy.db initialized successfully";
     return true;
 }
@@ -166,6 +152,9 @@ MainWindow::MainWindow(QWidget *parent)
         return;
     }
 
+    focusSketches = new FocusSketchStore(db, this);
+    focusSketches->rebuildFromDetections();
+
     // Create StudyGoal and StudyStreak objects
     studyGoal = new StudyGoal(db, this);
     studyStreak = new StudyStreak(db, this);
@@ -173,8 +162,12 @@ MainWindow::MainWindow(QWidget *parent)
     achievementTracker = new Achievement(db, this);
     alertSound = new QSoundEffect(this);
 
-    // Ensure recurring goals are generated for today
-    studyGoal->checkAndGenerateAllRecurringGoals();
+    // Fold instances written by the old recurring goal generator into the rules
+    studyGoal->catchUpRecurringGoals();
+
+    // Full-text index for the toolbar search; the app works without it if SQLite lacks FTS5
+    searchIndex = new SearchIndex(db, this);
+    searchIndex->initialize();
 
     if (!studyStreak->initializeStreaks()) {
         QMessageBox::critical(this, "Error", "Failed to initialize StudyStreak.");
@@ -212,6 +205,17 @@ MainWindow::MainWindow(QWidget *parent)
     connect(timer, &QTimer::timeout, this, &MainWindow::updateFrame);
     connect(timer, &QTimer::timeout, this, &MainWindow::updateDashboard);
 
+    // live charts repaint at their own, much lower rate than the camera
+    chartRefreshTimer = new QTimer(this);
+    chartRefreshTimer->setInterval(1000 / liveChartRefreshHz);
+    connect(chartRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshLiveCharts);
+
+    // A streak can break overnight without any session, so re-check it when the date changes
+    midnightTimer = new QTimer(this);
+    midnightTimer->setSingleShot(true);
+    connect(midnightTimer, &QTimer::timeout, this, &MainWindow::onDateChanged);
+    scheduleMidnightCheck();
+
     // alert sound
     alertSound->setSource(QUrl("qrc:/sounds/alert.wav"));
     alertSound->setVolume(0.75f);
@@ -226,9 +230,7 @@ MainWindow::MainWindow(QWidget *parent)
     studyGoal->connectToPomodoroTimer(pomodoroTimer);
 
     // Connect StudyGoal signals to slots
-    connect(studyGoal, &StudyGoal::goalCreated, this, &MainWindow::handleGoalCreated);
-    connect(studyGoal, &StudyGoal::goalUpdated, this, &MainWindow::handleGoalUpdated);
-    connect(studyGoal, &StudyGoal::goalDeleted, this, &MainWindow::handleGoalDeleted);
+    connect(studyGoal, &StudyGoal::goalsChanged, this, &MainWindow::handleGoalsChanged);
     connect(studyGoal, &StudyGoal::sessionTimeUpdated, this, &MainWindow::onGoalSessionTimeUpdated);
     connect(studyGoal, &StudyGoal::sessionProgressUpdated, this, &MainWindow::onGoalSessionProgressUpdated);
     connect(studyGoal, &StudyGoal::goalTrackingStarted, this, &MainWindow::onGoalTrackingStarted);
@@ -241,6 +243,24 @@ MainWindow::MainWindow(QWidget *parent)
     connect(studyStreak, &StudyStreak::milestoneReached, this, [this](int days) {
         QMessageBox::information(this, "Streak Milestone!", QString("Congratulations! You've reached a %1-day study streak!").arg(days));
     });
+    connect(studyStreak, &StudyStreak::streakUpdated, achievementTracker, &Achievement::trackStreak);
+    connect(achievementTracker, &Achievement::achievementUnlocked, this, &MainWindow::onAchievementUnlocked);
+    connect(achievementTracker, &Achievement::progressUpdated, this, &MainWindow::onAchievementProgressUpdated);
+
+    // Replay history whenever the achievement rules change, a slice at a time
+    achievementBackfill = new AchievementBackfill(db, achievementTracker, studyStreak, this);
+    connect(achievementBackfill, &AchievementBackfill::progressChanged, this, [this](int percent) {
+        achievementBackfillBar->setValue(percent);
+        achievementBackfillBar->setVisible(percent < 100);
+    });
+    connect(achievementBackfill, &AchievementBackfill::finished, this, [this](int newUnlocks) {
+        refreshAchievementsDisplay();
+        if (newUnlocks > 0) {
+            QMessageBox::information(this, "Achievements Unlocked!",
+                                     QString("Your study history earned %1 new achievement(s)!").arg(newUnlocks));
+        }
+    });
+    if (achievementBackfill->isNeeded()) achievementBackfill->start();
 
     setWindowTitle("Study Buddy - Focus Monitor");
     resize(800, 600);
@@ -261,11 +281,29 @@ MainWindow::MainWindow(QWidget *parent)
                 }
             }
         });
-    }
 
-    progressUpdateTimer = new QTimer(this);
-    progressUpdateTimer->setInterval(1000); // 1 second
-    connect(progressUpdateTimer, &QTimer::timeout, this, &MainWindow::updateGoalProgressBars);
+        // Search box; results are queried after a short pause in typing
+        toolbar->addSeparator();
+        globalSearchInput = new QLineEdit(toolbar);
+        globalSearchInput->setPlaceholderText("Search goals, notes, feedback, chats...");
+        globalSearchInput->setClearButtonEnabled(true);
+        globalSearchInput->setMaximumWidth(280);
+        globalSearchInput->setEnabled(searchIndex->isAvailable());
+        toolbar->addWidget(globalSearchInput);
+
+        globalSearchModel = new QStandardItemModel(this);
+        globalSearchCompleter = new QCompleter(globalSearchModel, this);
+        globalSearchCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+        globalSearchCompleter->setWidget(globalSearchInput);
+        connect(globalSearchCompleter, QOverload<const QModelIndex &>::of(&QCompleter::activated),
+                this, &MainWindow::openSearchResult);
+
+        globalSearchTimer = new QTimer(this);
+        globalSearchTimer->setSingleShot(true);
+        globalSearchTimer->setInterval(150);
+        connect(globalSearchTimer, &QTimer::timeout, this, &MainWindow::runGlobalSearch);
+        connect(globalSearchInput, &QLineEdit::textEdited, globalSearchTimer, qOverload<>(&QTimer::start));
+    }
 
     // At the end of MainWindow constructor, after UI setup:
     notifyOverdueAndTodayGoals();
@@ -472,8 +510,14 @@ void MainWindow::createGoalsSection(QVBoxLayout *parentLayout)
     recurrenceTypeCombo = new QComboBox();
     recurrenceTypeCombo->addItems({"None", "Daily", "Weekly", "Monthly"});
     recurrenceValueInput = new QLineEdit();
-    recurrenceValueInput->setPlaceholderText("e.g., 'Mon,Wed,Fri' for weekly");
+    recurrenceValueInput->setPlaceholderText("e.g., 'Mon,Wed,Fri' for weekly, or FREQ=WEEKLY;INTERVAL=2;BYDAY=MO");
     recurrenceValueInput->setEnabled(false);
+
+    // Where the goal sits in a larger syllabus, and what has to be finished first
+    goalPartOfCombo = new QComboBox();
+    goalPrerequisiteList = new QListWidget();
+    goalPrerequisiteList->setMaximumHeight(90);
+    goalPrerequisiteList->setToolTip("Check the goals that must be completed before this one");
     
     connect(recurrenceTypeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             [this](int index) {
@@ -524,6 +568,8 @@ void MainWindow::createGoalsSection(QVBoxLayout *parentLayout)
     createGoalLayout->addRow("Category:", goalCategoryCombo);
     createGoalLayout->addRow("Recurrence:", recurrenceTypeCombo);
     createGoalLayout->addRow("Recurrence Details:", recurrenceValueInput);
+    createGoalLayout->addRow("Part of:", goalPartOfCombo);
+    createGoalLayout->addRow("Requires:", goalPrerequisiteList);
     QHBoxLayout *addEditButtonsLayout = new QHBoxLayout();
     addEditButtonsLayout->addWidget(addGoalButton);
     addEditButtonsLayout->addWidget(cancelEditButton);
@@ -564,6 +610,7 @@ void MainWindow::createGoalsSection(QVBoxLayout *parentLayout)
         }
         if (m_currentSelectedGoalId != -1) {
             if (studyGoal->updateGoal(m_currentSelectedGoalId, subject, targetMinutes, notes, recurrenceType, recurrenceValue, category, resourceList)) {
+                applyGoalStructureInputs(m_currentSelectedGoalId);
                 QMessageBox::information(this, "Success", "Goal updated successfully!");
                 handleCancelEdit();
             } else {
@@ -571,7 +618,9 @@ void MainWindow::createGoalsSection(QVBoxLayout *parentLayout)
             }
         } else {
             if (studyGoal->createGoal(subject, targetMinutes, notes, recurrenceType, recurrenceValue, category, resourceList)) {
+                applyGoalStructureInputs(studyGoal->lastCreatedGoalId());
                 QMessageBox::information(this, "Success", "Goal created successfully!");
+                refreshGoalStructureInputs();
                 refreshGoalsDisplay();
             } else {
                 QMessageBox::critical(this, "Error", "Failed to create goal.");
@@ -581,9 +630,44 @@ void MainWindow::createGoalsSection(QVBoxLayout *parentLayout)
     
     connect(cancelEditButton, &QPushButton::clicked, this, &MainWindow::handleCancelEdit);
 
+    refreshGoalStructureInputs();
     refreshGoalsDisplay();
 }
 
+void MainWindow::refreshGoalStructureInputs()
+{
+    // Every saved goal except the one being edited can be its parent or prerequisite
+    const int partOfGoalId = studyGoal->getGoalDetails(m_currentSelectedGoalId).value("part_of_goal_id", -1).toInt();
+    const QList<int> prerequisites = studyGoal->getPrerequisites(m_currentSelectedGoalId);
+    goalPartOfCombo->clear();
+    goalPartOfCombo->addItem("None (top-level goal)", -1);
+    goalPrerequisiteList->clear();
+    for (const GoalInfo &goal : studyGoal->getSavedGoals()) {
+        if (goal.id == m_currentSelectedGoalId) continue;
+        const QString label = QString("%1 (%2)").arg(goal.subject, goal.category);
+        goalPartOfCombo->addItem(label, goal.id);
+        QListWidgetItem *item = new QListWidgetItem(label, goalPrerequisiteList);
+        item->setData(Qt::UserRole, goal.id);
+        item->setCheckState(prerequisites.contains(goal.id) ? Qt::Checked : Qt::Unchecked);
+    }
+    goalPartOfCombo->setCurrentIndex(qMax(0, goalPartOfCombo->findData(partOfGoalId)));
+}
+
+bool MainWindow::applyGoalStructureInputs(int goalId)
+{
+    QList<int> prerequisites;
+    for (int i = 0; i < goalPrerequisiteList->count(); ++i) {
+        QListWidgetItem *item = goalPrerequisiteList->item(i);
+        if (item->checkState() == Qt::Checked) prerequisites.append(item->data(Qt::UserRole).toInt());
+    }
+    bool ok = studyGoal->setGoalPartOf(goalId, goalPartOfCombo->currentData().toInt());
+    ok = studyGoal->setPrerequisites(goalId, prerequisites) && ok;
+    if (!ok) {
+        QMessageBox::warning(this, "Goal Structure", "A goal cannot be part of, or depend on, one of its own sub-goals or dependents. Those changes were not saved.");
+    }
+    return ok;
+}
+
 void MainWindow::createAnalyticsTab()
 {
     QWidget *analyticsTab = new QWidget();
@@ -596,6 +680,7 @@ void MainWindow::createAnalyticsTab()
     QVBoxLayout *analyticsLayout = new QVBoxLayout(analyticsGroup);
     analyticsLayout->setContentsMargins(0,0,0,0);
     StudyAnalytics *analytics = new StudyAnalytics(this->db, this);
+    analytics->setFocusSketches(focusSketches);
     
     // Add date range selection
     QHBoxLayout *dateRangeLayout = new QHBoxLayout();
@@ -656,8 +741,8 @@ void MainWindow::createAnalyticsTab()
     analytics->analyzePatterns(startDateEdit->date(), endDateEdit->date());
 
     auto updateAllCharts = [=]() {
-        focusChartView->setChart(analytics->createFocusChart(startDateEdit->date(), endDateEdit->date()));
-        productivityChartView->setChart(analytics->createProductivityChart(startDateEdit->date(), endDateEdit->date()));
+        focusChartView->setChart(analytics->createFocusChart(startDateEdit->date(), endDateEdit->date(), focusChartView->width()));
+        productivityChartView->setChart(analytics->createProductivityChart(startDateEdit->date(), endDateEdit->date(), productivityChartView->width()));
         goalChartView->setChart(analytics->createGoalCompletionChart(startDateEdit->date(), endDateEdit->date()));
         subjectTimeChartView->setChart(analytics->createSubjectTimeChart(startDateEdit->date(), endDateEdit->date()));
         distractionBarChartView->setChart(analytics->createDistractionBarChart(startDateEdit->date(), endDateEdit->date()));
@@ -668,6 +753,23 @@ void MainWindow::createAnalyticsTab()
     connect(startDateEdit, &QDateEdit::dateChanged, updateAllCharts);
     connect(endDateEdit, &QDateEdit::dateChanged, updateAllCharts);
 
+    // Downsampled charts follow their view's width: a resize rebuilds them once it settles
+    historyChartResizeTimer = new QTimer(this);
+    historyChartResizeTimer->setSingleShot(true);
+    historyChartResizeTimer->setInterval(250);
+    connect(historyChartResizeTimer, &QTimer::timeout, [=]() {
+        QChart *previous = focusChartView->chart();
+        focusChartView->setChart(analytics->createFocusChart(startDateEdit->date(), endDateEdit->date(), focusChartView->width()));
+        delete previous;
+        previous = productivityChartView->chart();
+        productivityChartView->setChart(analytics->createProductivityChart(startDateEdit->date(), endDateEdit->date(), productivityChartView->width()));
+        delete previous;
+    });
+    for (QChartView *view : {focusChartView, productivityChartView}) {
+        view->setProperty("downsampledChart", true);
+        view->installEventFilter(this);
+    }
+
     QScrollArea *scrollArea = new QScrollArea();
     scrollArea->setWidgetResizable(true);
     scrollArea->setWidget(analyticsGroup);
@@ -714,8 +816,6 @@ void MainWindow::createSettingsTab()
     longBreakSpin->setRange(5, 60);
     cyclesSpin = new QSpinBox();
     cyclesSpin->setRange(1, 10);
-    minStudySpin = new QSpinBox();
-    minStudySpin->setRange(1, 180);
     pomodoroLayout->addRow("Study Duration (min):", studyDurationSpin);
     pomodoroLayout->addRow("Short Break (min):", shortBreakSpin);
     pomodoroLayout->addRow("Long Break (min):", longBreakSpin);
@@ -729,15 +829,71 @@ void MainWindow::createSettingsTab()
     // Minimum minutes for study day
     QGroupBox *streakGroup = new QGroupBox("Streak/Yearly Activity");
     QFormLayout *streakLayout = new QFormLayout(streakGroup);
-    QSpinBox *minStudySpin = new QSpinBox();
-    minStudySpin->setRange(1, 180); minStudySpin->setValue(1);
+    minStudySpin = new QSpinBox();
+    minStudySpin->setRange(1, 180);
+    minStudySpin->setValue(QSettings("StudyBuddy", "FocusMonitor").value("minStudyMinutes", 1).toInt());
     streakLayout->addRow("Minimum minutes to count as study day:", minStudySpin);
+    QSpinBox *graceDaysSpin = new QSpinBox();
+    graceDaysSpin->setRange(0, 7);
+    graceDaysSpin->setValue(QSettings("StudyBuddy", "FocusMonitor").value("streakGraceDays", 0).toInt());
+    graceDaysSpin->setToolTip("Missed days in a row that don't break a streak");
+    streakLayout->addRow("Grace days:", graceDaysSpin);
+    QCheckBox *weekendsOffCheck = new QCheckBox("Weekends neither count nor break a streak");
+    weekendsOffCheck->setChecked(QSettings("StudyBuddy", "FocusMonitor").value("streakWeekendsOff", false).toBool());
+    streakLayout->addRow("Weekends off:", weekendsOffCheck);
     layout->addWidget(streakGroup);
+
+    // Live chart settings
+    QGroupBox *chartGroup = new QGroupBox("Live Charts");
+    QFormLayout *chartLayout = new QFormLayout(chartGroup);
+    QSpinBox *chartRefreshSpin = new QSpinBox();
+    chartRefreshSpin->setRange(1, 30);
+    chartRefreshSpin->setValue(QSettings("StudyBuddy", "FocusMonitor").value("liveChartRefreshHz", 4).toInt());
+    chartLayout->addRow("Chart refresh rate (Hz):", chartRefreshSpin);
+    QCheckBox *chartOpenGLCheck = new QCheckBox();
+    chartOpenGLCheck->setChecked(QSettings("StudyBuddy", "FocusMonitor").value("liveChartOpenGL", false).toBool());
+    chartOpenGLCheck->setToolTip("Draw live charts with OpenGL; turn off if the charts stay blank");
+    chartLayout->addRow("Hardware acceleration:", chartOpenGLCheck);
+    layout->addWidget(chartGroup);
+    connect(chartRefreshSpin, QOverload<int>::of(&QSpinBox::valueChanged), [this](int v){
+        liveChartRefreshHz = v;
+        if (chartRefreshTimer) chartRefreshTimer->setInterval(1000 / v);
+        saveSettings();
+    });
+    connect(chartOpenGLCheck, &QCheckBox::toggled, [this](bool checked){
+        liveChartOpenGL = checked;
+        if (focusSeries) focusSeries->setUseOpenGL(checked);
+        if (blinkSeries) blinkSeries->setUseOpenGL(checked);
+        saveSettings();
+    });
     connect(minStudySpin, QOverload<int>::of(&QSpinBox::valueChanged), [this](int v){
-        // You would use this value in your streak/yearly activity logic
+        streakRules.minMinutes = v;
+        studyStreak->setRules(streakRules);
+        saveSettings();
+    });
+    connect(graceDaysSpin, QOverload<int>::of(&QSpinBox::valueChanged), [this](int v){
+        streakRules.graceDays = v;
+        studyStreak->setRules(streakRules);
+        saveSettings();
+    });
+    connect(weekendsOffCheck, &QCheckBox::toggled, [this](bool checked){
+        streakRules.restDays = checked ? StreakRules::Weekends : 0;
+        studyStreak->setRules(streakRules);
         saveSettings();
     });
 
+    // Moving goals, sessions and surveys between machines
+    QGroupBox *dataGroup = new QGroupBox("Data");
+    QHBoxLayout *dataLayout = new QHBoxLayout(dataGroup);
+    QPushButton *exportDataBtn = new QPushButton("Export (JSON Lines)...");
+    QPushButton *importDataBtn = new QPushButton("Import (JSON Lines)...");
+    dataLayout->addWidget(exportDataBtn);
+    dataLayout->addWidget(importDataBtn);
+    dataLayout->addStretch();
+    layout->addWidget(dataGroup);
+    connect(exportDataBtn, &QPushButton::clicked, this, &MainWindow::exportJsonLines);
+    connect(importDataBtn, &QPushButton::clicked, this, &MainWindow::importJsonLines);
+
     layout->addStretch();
     tabWidget->addTab(settingsTab, "Settings");
 
@@ -771,7 +927,6 @@ void MainWindow::createSettingsTab()
     shortBreakSpin->setValue(settings.value("pomodoroShortBreak", 5).toInt());
     longBreakSpin->setValue(settings.value("pomodoroLongBreak", 15).toInt());
     cyclesSpin->setValue(settings.value("pomodoroCycles", 4).toInt());
-    minStudySpin->setValue(settings.value("minStudyMinutes", 1).toInt());
 
     // At the end of createSettingsTab()
     QHBoxLayout *buttonLayout = new QHBoxLayout();
@@ -812,21 +967,10 @@ void MainWindow::createAchievementsTab()
     int row = 0, col = 0;
     for (const auto &info : allAchievements) {
         QPushButton *iconButton = new QPushButton();
-        QIcon icon(info.iconPath);
-        bool isUnlocked = achievementTracker->isAchievementUnlocked(info.id);
-        if (!isUnlocked) {
-            // Fade locked achievements
-            QPixmap pixmap = icon.pixmap(96, 96);
-            QPixmap faded(pixmap.size());
-            faded.fill(Qt::transparent);
-            QPainter p(&faded);
-            p.setOpacity(0.3);
-            p.drawPixmap(0, 0, pixmap);
-            p.end();
-            iconButton->setIcon(QIcon(faded));
-        } else {
-            iconButton->setIcon(icon);
-        }
+        // Locked achievements get the cached faded variant
+        const IconCache::State state = achievementTracker->isAchievementUnlocked(info.id) ? IconCache::State::Unlocked
+                                                                                           : IconCache::State::Locked;
+        iconButton->setIcon(QIcon(IconCache::pixmap(info.iconPath, QSize(96, 96), state, devicePixelRatioF())));
         iconButton->setIconSize(QSize(96, 96));
         iconButton->setFixedSize(110, 130);
         iconButton->setFlat(true);
@@ -874,8 +1018,39 @@ void MainWindow::createAchievementsTab()
     m_achievementDescriptionLabel->setStyleSheet("font-style: italic; color: #888;");
     achievementsLayout->addWidget(m_achievementDescriptionLabel);
 
+    // Shown while history is replayed through new achievement rules
+    achievementBackfillBar = new QProgressBar();
+    achievementBackfillBar->setRange(0, 100);
+    achievementBackfillBar->setFormat("Checking your history for achievements... %p%");
+    achievementBackfillBar->setVisible(false);
+    achievementsLayout->addWidget(achievementBackfillBar);
+
     layout->addWidget(achievementsGroup);
+
+    // Progress over time for one achievement, and which rules cost the most to evaluate
+    QGroupBox *insightsGroup = new QGroupBox("Progress Timeline");
+    QVBoxLayout *insightsLayout = new QVBoxLayout(insightsGroup);
+    achievementTimelineCombo = new QComboBox();
+    for (const auto &info : allAchievements) {
+        achievementTimelineCombo->addItem(info.name, info.id);
+    }
+    insightsLayout->addWidget(achievementTimelineCombo);
+    achievementTimelineView = new QChartView(new QChart());
+    achievementTimelineView->setRenderHint(QPainter::Antialiasing);
+    achievementTimelineView->setMinimumHeight(220);
+    insightsLayout->addWidget(achievementTimelineView);
+    insightsLayout->addWidget(new QLabel("Most expensive rules:"));
+    achievementRuleCostList = new QListWidget();
+    achievementRuleCostList->setMaximumHeight(120);
+    insightsLayout->addWidget(achievementRuleCostList);
+    layout->addWidget(insightsGroup);
+
+    connect(achievementTimelineCombo, &QComboBox::currentIndexChanged, this, &MainWindow::refreshAchievementInsights);
     tabWidget->addTab(achievementsTab, "Achievements");
+    // Charted when the tab is shown rather than on every progress update
+    connect(tabWidget, &QTabWidget::currentChanged, this, [this, achievementsTab](int) {
+        if (tabWidget->currentWidget() == achievementsTab) refreshAchievementInsights();
+    });
 
     // Update stats
     totalAchievementsLabel->setText(QString("Total Achievements: %1").arg(achievementTracker->getTotalAchievements()));
@@ -889,6 +1064,12 @@ MainWindow::~MainWindow()
     if (webcamActive) {
         stopWebcam();
     }
+
+    // Write buffered progress and sketches now: the children are destroyed after this,
+    // and StudyGoal closes the shared connection when it goes
+    if (achievementBackfill) achievementBackfill->cancel();
+    if (achievementTracker) achievementTracker->flush();
+    if (focusSketches) focusSketches->flush();
     
     // Clean up chart components
     delete focusChartView;
@@ -990,9 +1171,15 @@ void MainWindow::startWebcam()
         qDebug() << "startWebcam: goal dialog cancelled";
         return;
     }
+    sessionSubjects.clear();
     for (QListWidgetItem *item : goalList->selectedItems()) {
         selectedGoalIds.append(item->data(Qt::UserRole).toInt());
     }
+    for (const auto &goal : allGoals) {
+        if (selectedGoalIds.contains(goal.id) && !sessionSubjects.contains(goal.subject)) {
+            sessionSubjects.append(goal.subject);
+        }
+    }
     // End goal selection dialog
 
     if (!capture.open(0)) {
@@ -1008,7 +1195,10 @@ void MainWindow::startWebcam()
     qDebug() << "startWebcam: sessionId=" << sessionId;
 
     // Link selected goals to this session
-    for (int goalId : selectedGoalIds) {
+    for (int selectedId : selectedGoalIds) {
+        // Unsaved occurrences of recurring goals need a row before they can be linked
+        int goalId = studyGoal->materializeGoal(selectedId);
+        if (goalId < 0) continue;
         QSqlQuery linkQuery(db);
         linkQuery.prepare("INSERT INTO session_goals (session_id, goal_id) VALUES (?, ?)");
         linkQuery.addBindValue(sessionId);
@@ -1027,8 +1217,9 @@ void MainWindow::startWebcam()
     clearCharts();
 
     webcamActive = true;
+    if (chartRefreshTimer) chartRefreshTimer->start();
     if (timer) {
-    timer->start(33);
+    timer->start(kFrameIntervalMs);
         qDebug() << "startWebcam: timer started";
     } else {
         qDebug() << "startWebcam: timer is null!";
@@ -1049,6 +1240,7 @@ void MainWindow::stopWebcam()
         }
     }
     timer->stop();
+    if (chartRefreshTimer) chartRefreshTimer->stop();
     capture.release();
     webcamActive = false;
     startButton->setEnabled(true);
@@ -1062,8 +1254,8 @@ void MainWindow::stopWebcam()
     qDebug() << "Focus Score:" << focusScore;
     qDebug() << "Total Blinks:" << blinkCount;
 
-    // Emit session completed signal for achievement tracking
-    achievementTracker->sessionCompleted();
+    const QDateTime sessionEnd = QDateTime::currentDateTime();
+    achievementTracker->trackSession(sessionEnd.addMSecs(-sessionTimer.elapsed()), sessionEnd);
 
     // Log final session summary
     QSqlQuery query;
@@ -1079,8 +1271,13 @@ void MainWindow::stopWebcam()
         qDebug() << "Error: Failed to log session summary" << query.lastError().text();
     } else {
         qDebug() << "Successfully logged session summary with focus score:" << focusScore;
+        if (focusSketches) focusSketches->skipDetection(query.lastInsertId().toLongLong());
     }
 
+    if (focusSketches) focusSketches->flush();
+    achievementTracker->flush();
+    sessionSubjects.clear();
+
     int durationMinutes = sessionTimer.elapsed() / 60000;
     studyStreak->recordStudySession(durationMinutes);
 
@@ -1090,15 +1287,20 @@ void MainWindow::stopWebcam()
         studySession->endSession(sessionId);
         studySession->setCurrentSessionId(-1);
 
-        //Update progress for all linked goals
+        //Update progress for all linked goals in one batch
+        QHash<int, int> minutesByGoal;
         QSqlQuery linkQuery(db);
         linkQuery.prepare("SELECT goal_id FROM session_goals WHERE session_id = ?");
         linkQuery.addBindValue(sessionId);
         if (linkQuery.exec()) {
             while (linkQuery.next()) {
-                int goalId = linkQuery.value(0).toInt();
-                qDebug() << "Adding progress to goal" << goalId << "for duration" << durationMinutes << "minutes (camera session)";
-                studyGoal->addProgress(goalId, durationMinutes);
+                minutesByGoal.insert(linkQuery.value(0).toInt(), durationMinutes);
+            }
+        }
+        qDebug() << "Adding" << durationMinutes << "minutes to goals" << minutesByGoal.keys() << "(camera session)";
+        if (durationMinutes > 0 && studyGoal->addProgressBatch(minutesByGoal)) {
+            for (int goalId : minutesByGoal.keys()) {
+                notifyGoalCompleted(goalId);
             }
         }
 
@@ -1266,7 +1468,8 @@ void MainWindow::logFaceDetection(int faceCount, bool eyesDetected, float focusS
     }
 
     QSqlQuery query(db);
-    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    QDateTime now = QDateTime::currentDateTime();
+    QString timestamp = now.toString("yyyy-MM-dd HH:mm:ss");
 
     // Updated query
     query.prepare("INSERT INTO detections (timestamp, face_count, eyes_detected, blink_count, focus_score) "
@@ -1285,6 +1488,8 @@ void MainWindow::logFaceDetection(int faceCount, bool eyesDetected, float focusS
                  << "blinks:" << blinkCount
                  << "focus:" << focusScore;
     } else {
+        if (focusSketches) focusSketches->addSample(query.lastInsertId().toLongLong(), now, focusScore, sessionSubjects);
+        achievementTracker->trackFocusScore(focusScore);
         qDebug() << "Successfully logged detection - Timestamp:" << timestamp
                  << "Faces:" << faceCount
                  << "Eyes:" << (eyesDetected ? "Yes" : "No")
@@ -1387,6 +1592,14 @@ void MainWindow::loadSettings()
     alertsEnabled = settings.value("alertsEnabled", true).toBool();
     alertThreshold = settings.value("alertThreshold", 5).toInt();
     faceDetectionEnabled = settings.value("faceDetectionEnabled", true).toBool();
+    liveChartRefreshHz = qBound(1, settings.value("liveChartRefreshHz", 4).toInt(), 30);
+    if (chartRefreshTimer) chartRefreshTimer->setInterval(1000 / liveChartRefreshHz);
+    liveChartOpenGL = settings.value("liveChartOpenGL", false).toBool();
+
+    streakRules.minMinutes = qBound(1, settings.value("minStudyMinutes", 1).toInt(), 180);
+    streakRules.graceDays = qBound(0, settings.value("streakGraceDays", 0).toInt(), 7);
+    streakRules.restDays = settings.value("streakWeekendsOff", false).toBool() ? StreakRules::Weekends : 0;
+    if (studyStreak) studyStreak->setRules(streakRules);
 }
 
 void MainWindow::saveSettings()
@@ -1395,6 +1608,11 @@ void MainWindow::saveSettings()
     settings.setValue("alertsEnabled", alertsEnabled);
     settings.setValue("alertThreshold", alertThreshold);
     settings.setValue("faceDetectionEnabled", faceDetectionEnabled);
+    settings.setValue("liveChartRefreshHz", liveChartRefreshHz);
+    settings.setValue("liveChartOpenGL", liveChartOpenGL);
+    settings.setValue("minStudyMinutes", streakRules.minMinutes);
+    settings.setValue("streakGraceDays", streakRules.graceDays);
+    settings.setValue("streakWeekendsOff", streakRules.restDays == StreakRules::Weekends);
 }
 
 void MainWindow::playAlertSound()
@@ -1642,9 +1860,17 @@ void MainWindow::setupCharts()
         focusChart->setTheme(QChart::ChartThemeDark);
         blinkChart->setTheme(QChart::ChartThemeDark);
 
-        // Enable chart animations
-        focusChart->setAnimationOptions(QChart::SeriesAnimations);
-        blinkChart->setAnimationOptions(QChart::SeriesAnimations);
+        // Live series are replaced several times a second; animating them only costs frames
+        focusChart->setAnimationOptions(QChart::NoAnimation);
+        blinkChart->setAnimationOptions(QChart::NoAnimation);
+        // OpenGL series are opt-in: some drivers and remote sessions leave them blank
+        liveChartOpenGL = QSettings("StudyBuddy", "FocusMonitor").value("liveChartOpenGL", false).toBool();
+        focusSeries->setUseOpenGL(liveChartOpenGL);
+        blinkSeries->setUseOpenGL(liveChartOpenGL);
+
+        // Samples are folded into fixed buckets as they arrive, so a refresh never walks the hour
+        focusPoints.reset(kLiveChartWindowMinutes, kLiveChartBuckets);
+        blinkPoints.reset(kLiveChartWindowMinutes, kLiveChartBuckets);
 
     } catch (const std::exception& e) {
         qDebug() << "Exception in setupCharts:" << e.what();
@@ -1655,62 +1881,46 @@ void MainWindow::setupCharts()
 
 void MainWindow::updateChartData()
 {
-    if (!focusSeries || !blinkSeries || !timeAxis || !focusAxis || !blinkAxis) {
-        qDebug() << "Chart components not initialized";
-        return;
-    }
-
-    try {
-        // Get elapsed time in minutes
-        double elapsedMinutes = sessionTimer.elapsed() / 60000.0;
-        
-        // Calculate current focus score as percentage
-        currentFocusScore = totalFrames > 0 ? (float)focusedFrames / totalFrames * 100.0f : 0.0f;
-        
-        // Calculate blink rate (blinks per minute)
-        static int lastBlinkCount = 0;
-        blinkRate = blinkCount - lastBlinkCount;
-        lastBlinkCount = blinkCount;
-        
-        // Add new data points
-        focusSeries->append(elapsedMinutes, currentFocusScore);
-        blinkSeries->append(elapsedMinutes, blinkRate);
-
-        // Keep only last hour of data (60 minutes)
-        while (focusSeries->count() > 0 && 
-               focusSeries->at(0).x() < elapsedMinutes - 60.0) {
-            focusSeries->remove(0);
-        }
-        while (blinkSeries->count() > 0 && 
-               blinkSeries->at(0).x() < elapsedMinutes - 60.0) {
-            blinkSeries->remove(0);
-        }
+    // Runs once per camera frame: only record the sample, repainting happens in refreshLiveCharts()
+    double elapsedMinutes = sessionTimer.elapsed() / 60000.0;
 
-        // Update axes ranges
-        if (focusSeries->count() > 0) {
-            double minTime = focusSeries->at(0).x();
-            double maxTime = qMax(minTime + 1.0, elapsedMinutes);
-            timeAxis->setRange(minTime, maxTime);
-            focusAxis->setRange(0, 100);
-            blinkAxis->setRange(0, qMax(30.0, blinkRate * 1.2));
-        }
+    // Calculate current focus score as percentage
+    currentFocusScore = totalFrames > 0 ? (float)focusedFrames / totalFrames * 100.0f : 0.0f;
 
-        // Update focus progress bar
-        if (focusProgressBar) {
-            focusProgressBar->setValue(static_cast<int>(currentFocusScore));
-        }
+    // Calculate blink rate (blinks per minute)
+    static int lastBlinkCount = 0;
+    blinkRate = blinkCount - lastBlinkCount;
+    lastBlinkCount = blinkCount;
 
-        // update of chart views
-        if (focusChartView) focusChartView->update();
-        if (blinkChartView) blinkChartView->update();
+    // The decimators drop buckets older than the last hour themselves
+    focusPoints.append(QPointF(elapsedMinutes, currentFocusScore));
+    blinkPoints.append(QPointF(elapsedMinutes, blinkRate));
 
-        qDebug() << "Chart updated - Time:" << elapsedMinutes 
-                 << "Focus Score:" << currentFocusScore 
-                 << "Blink Rate:" << blinkRate;
+    // Update focus progress bar
+    if (focusProgressBar) {
+        focusProgressBar->setValue(static_cast<int>(currentFocusScore));
     }
-    catch (const std::exception& e) {
-        qDebug() << "Error updating charts:" << e.what();
+}
+
+void MainWindow::refreshLiveCharts()
+{
+    if (!focusSeries || !blinkSeries || !timeAxis || !focusAxis || !blinkAxis) {
+        qDebug() << "Chart components not initialized";
+        return;
     }
+    if (focusPoints.isEmpty()) return;
+
+    // Series only receive the bucket extremes, in one replace() each through a reused list
+    focusPoints.points(liveChartPoints, focusChartView ? focusChartView->width() : 0);
+    focusSeries->replace(liveChartPoints);
+    blinkPoints.points(liveChartPoints, blinkChartView ? blinkChartView->width() : 0);
+    blinkSeries->replace(liveChartPoints);
+
+    // Update axes ranges
+    double minTime = focusPoints.firstX();
+    double maxTime = qMax(minTime + 1.0, focusPoints.lastX());
+    timeAxis->setRange(minTime, maxTime);
+    blinkAxis->setRange(0, qMax(30.0, blinkRate * 1.2));
 }
 
 void MainWindow::clearCharts()
@@ -1721,6 +1931,8 @@ void MainWindow::clearCharts()
     }
 
     try {
+        focusPoints.clear();
+        blinkPoints.clear();
         focusSeries->clear();
         blinkSeries->clear();
         sessionTimer.restart();
@@ -1748,20 +1960,7 @@ void MainWindow::updatePomodoroDisplay(const QString &time)
     if (pomodoroTimeLabel) {
         pomodoroTimeLabel->setText(time);
     }
-    // Real-time update of active goal progress bar
-    if (m_activeGoalProgressBar && m_currentActiveGoalId != -1) {
-        // Do NOT increment m_currentSessionProgress here. Only use the value set by onGoalSessionTimeUpdated.
-        int completed = studyGoal->getProgress(m_currentActiveGoalId);
-        int target = studyGoal->getTarget(m_currentActiveGoalId);
-        if (target <= 0) target = 1;
-        int elapsedSeconds = m_currentSessionProgress.value(m_currentActiveGoalId, 0);
-        int elapsedMinutes = elapsedSeconds / 60;
-        int total = completed + elapsedMinutes;
-        float percent = (target > 0) ? (float)total / target * 100.0f : 0.0f;
-        m_activeGoalProgressBar->setRange(0, target);
-        m_activeGoalProgressBar->setValue(total);
-        m_activeGoalProgressBar->setFormat(QString("%1/%2 minutes (%3%)").arg(total).arg(target).arg(percent, 0, 'f', 1));
-    }
+    // The tracked goal's progress bar is updated from onGoalSessionTimeUpdated
 }
 
 void MainWindow::handlePomodoroModeChanged(bool isStudyTime)
@@ -1780,8 +1979,7 @@ void MainWindow::handlePomodoroCycleChanged(int cycle)
 
 void MainWindow::handlePomodoroTimerCompleted()
 {
-    // Emit Pomodoro completed signal for achievement tracking
-    achievementTracker->pomodoroCompleted();
+    achievementTracker->trackPomodoro();
 
     // Desktop notification for Pomodoro completion
     if (trayIcon && QSystemTrayIcon::supportsMessages() && enableDesktopNotif->isChecked() && notifPomodoro->isChecked()) {
@@ -1796,167 +1994,234 @@ void MainWindow::handleAddGoal()
 {
 }
 
-void MainWindow::refreshGoalsDisplay()
+MainWindow::GoalCard MainWindow::createGoalCard(const GoalInfo &goal)
 {
-    // Clear old cards
-    QLayoutItem *child;
-    while ((child = goalsCardLayout->takeAt(0)) != nullptr) {
-        if (child->widget()) child->widget()->deleteLater();
-        delete child;
-    }
+    GoalCard goalCard;
+    QWidget *card = new QWidget();
+    QVBoxLayout *cardLayout = new QVBoxLayout(card);
+    const int goalId = goal.id;
+
+    // --- Resource emoji row ---
+    QHBoxLayout *resourceEmojiLayout = new QHBoxLayout();
+    resourceEmojiLayout->addStretch();
+    QPushButton *resourceBtn = new QPushButton();
+    resourceBtn->setFlat(true);
+    resourceBtn->setCursor(Qt::PointingHandCursor);
+    resourceBtn->setStyleSheet("QPushButton { background: transparent; font-size: 20px; } QPushButton:hover { color: #C3073F; }");
+    resourceEmojiLayout->addWidget(resourceBtn, 0, Qt::AlignRight);
+    // Popup menu on click; resources are looked up when clicked so edits are picked up
+    connect(resourceBtn, &QPushButton::clicked, this, [this, goalId, resourceBtn]() {
+        QMenu *menu = new QMenu(resourceBtn);
+        for (const QString &res : studyGoal->getResourcesForGoal(goalId)) {
+            QAction *act = new QAction(res, menu);
+            connect(act, &QAction::triggered, this, [this, res]() {
+                openResourceInApp(res);
+            });
+            menu->addAction(act);
+        }
+        menu->exec(QCursor::pos());
+    });
+    cardLayout->addLayout(resourceEmojiLayout);
+
+    // Title, category, and recurrence (all in one line)
+    QLabel *title = new QLabel();
+    title->setStyleSheet("font-weight: bold; font-size: 16px;");
+    title->setTextFormat(Qt::RichText);
+    cardLayout->addWidget(title);
+
+    // Progress bar
+    QProgressBar *progress = new QProgressBar();
+    progress->setObjectName("goalProgressBar");
+    progress->setStyleSheet("QProgressBar::chunk { background-color: #C3073F; min-width: 2px; }"); // Always visible
+    cardLayout->addWidget(progress);
+
+    // Inline actions
+    QHBoxLayout *actions = new QHBoxLayout();
+    QPushButton *startBtn = new QPushButton("Start");
+    startBtn->setToolTip("Start Tracking");
+    QPushButton *stopBtn = new QPushButton("Stop");
+    stopBtn->setToolTip("Stop Tracking");
+    QPushButton *deleteBtn = new QPushButton("Delete");
+    deleteBtn->setToolTip("Delete Goal");
+    actions->addWidget(startBtn);
+    actions->addWidget(stopBtn);
+    actions->addWidget(deleteBtn);
+    QString btnStyle = "QPushButton { background-color: #6F2232; color: white; border: none; padding: 5px 10px; border-radius: 3px;width: 100px; } QPushButton:hover { background-color: #950740; }";
+    startBtn->setStyleSheet(btnStyle);
+    stopBtn->setStyleSheet(btnStyle);
+    deleteBtn->setStyleSheet(btnStyle);
+    actions->addStretch();
+    cardLayout->addLayout(actions);
+
+    connect(startBtn, &QPushButton::clicked, this, [this, goalId]() {
+        if (!pomodoroTimer || !studyGoal) {
+            qDebug() << "Error: pomodoroTimer or studyGoal is null!";
+            return;
+        }
+        // Prevent tracking if goal is already completed
+        int completed = studyGoal->getProgress(goalId);
+        int target = studyGoal->getTarget(goalId);
+        if (target > 0 && completed >= target) {
+            QMessageBox::warning(this, "Goal Already Completed", "You cannot track a goal that is already completed.");
+            return;
+        }
+        if (studyGoal->isBlocked(goalId)
+            && QMessageBox::question(this, "Prerequisites Not Done", "This goal has unfinished prerequisites. Start anyway?",
+                                     QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+            return;
+        }
+        // Clear session progress for all other goals
+        m_currentSessionProgress.clear();
+        m_currentActiveGoalId = goalId;
+        int initialElapsedSeconds = 0;
+        studyGoal->startTrackingGoal(goalId, initialElapsedSeconds);
+        pomodoroTimer->start();
+    });
+    connect(stopBtn, &QPushButton::clicked, this, [this]() {
+        if (!pomodoroTimer || !studyGoal) {
+            qDebug() << "Error: pomodoroTimer or studyGoal is null!";
+            return;
+        }
+        qDebug() << "Stop button clicked";
+        pomodoroTimer->pause();
+        studyGoal->stopTrackingGoal();
+    });
+    connect(deleteBtn, &QPushButton::clicked, this, [this, goalId]() {
+        if (QMessageBox::question(this, "Confirm Deletion", "Are you sure you want to delete this goal?", QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
+            // goalDeleted triggers the refresh that removes this card
+            studyGoal->deleteGoal(goalId);
+        }
+    });
 
-    m_activeGoalProgressBar = nullptr; // Reset before rebuilding
-    QList<GoalInfo> goals = studyGoal->getGoalsForDate(QDate::currentDate());
-    for (const auto& goal : goals) {
-        qDebug() << "Goal" << goal.id << "completed:" << goal.completedMinutes << "target:" << goal.targetMinutes;
+    card->setStyleSheet("background: #222; border: 1px solid #6F2232; border-radius: 8px; padding: 10px;");
+    card->setFixedHeight(360);
+
+    // --- Enable editing on card click ---
+    card->setCursor(Qt::PointingHandCursor);
+    card->installEventFilter(this);
+    card->setProperty("goalId", goalId);
+
+    goalCard.card = card;
+    goalCard.resourceButton = resourceBtn;
+    goalCard.title = title;
+    goalCard.progress = progress;
+    return goalCard;
+}
+
+void MainWindow::updateGoalCard(GoalCard &goalCard, const GoalInfo &goal)
+{
+    // Show only one emoji: 📎 if any file, otherwise 🔗 if any link
+    bool hasFile = false;
+    for (const QString &res : goal.resources) {
+        if (!res.startsWith("http")) hasFile = true;
     }
+    goalCard.resourceButton->setText(hasFile ? "📎" : "🔗");
+    goalCard.resourceButton->setVisible(!goal.resources.isEmpty());
 
-    if (goals.isEmpty()) {
-        QLabel *emptyLabel = new QLabel("No goals yet! Create your first goal above.");
-        emptyLabel->setAlignment(Qt::AlignCenter);
-        emptyLabel->setStyleSheet("color: #aaa; font-style: italic;");
-        goalsCardLayout->addWidget(emptyLabel, 0, 0);
-        return;
+    QString titleText = QString("%1 (%2)").arg(goal.subject, goal.category);
+    if (goal.recurrenceType != "None") {
+        titleText += QString("  <span style='background:#6F2232; color:#fff; border-radius:4px; padding:2px 6px; font-size:12px;'>[%1: %2]</span>")
+            .arg(goal.recurrenceType, goal.recurrenceValue);
+    }
+    const GoalRollup rollup = studyGoal->getRollup(goal.id);
+    const bool blocked = studyGoal->isBlocked(goal.id);
+    if (rollup.goalCount > 1) {
+        titleText += QString("  <span style='background:#4E4E50; color:#fff; border-radius:4px; padding:2px 6px; font-size:12px;'>[%1 sub-goals]</span>")
+            .arg(rollup.goalCount - 1);
+    }
+    if (blocked) {
+        titleText += "  <span style='background:#950740; color:#fff; border-radius:4px; padding:2px 6px; font-size:12px;'>[Blocked]</span>";
     }
+    goalCard.title->setText(titleText);
 
-    int colCount = 3; // Number of cards per row
-    int row = 0, col = 0;
+    goalCard.shown = goal;
+    goalCard.shownRollup = rollup;
+    goalCard.shownBlocked = blocked;
+    updateGoalProgressBar(goal.id);
+}
+
+void MainWindow::refreshGoalsDisplay()
+{
+    QList<GoalInfo> goals = studyGoal->getGoalsForDate(QDate::currentDate());
+
+    // Drop cards whose goal is gone
+    QSet<int> currentIds;
     for (const auto &goal : goals) {
-        QWidget *card = new QWidget();
-        QVBoxLayout *cardLayout = new QVBoxLayout(card);
-
-        // --- Resource emoji row ---
-        QHBoxLayout *resourceEmojiLayout = new QHBoxLayout();
-        resourceEmojiLayout->addStretch();
-        if (!goal.resources.isEmpty()) {
-            QPushButton *resourceBtn = new QPushButton();
-            resourceBtn->setFlat(true);
-            resourceBtn->setCursor(Qt::PointingHandCursor);
-            resourceBtn->setStyleSheet("QPushButton { background: transparent; font-size: 20px; } QPushButton:hover { color: #C3073F; }");
-            // Show only one emoji: 📎 if any file, otherwise 🔗 if any link
-            bool hasFile = false, hasLink = false;
-            for (const QString &res : goal.resources) {
-                if (res.startsWith("http")) hasLink = true;
-                else hasFile = true;
-            }
-            QString emoji;
-            if (hasFile) emoji = "📎";
-            else emoji = "🔗";
-            resourceBtn->setText(emoji);
-            resourceEmojiLayout->addWidget(resourceBtn, 0, Qt::AlignRight);
-            // Popup menu on click
-            connect(resourceBtn, &QPushButton::clicked, this, [this, goal, resourceBtn]() {
-                QMenu *menu = new QMenu(resourceBtn);
-                for (const QString &res : goal.resources) {
-                    QAction *act = new QAction(res, menu);
-                    connect(act, &QAction::triggered, this, [this, res]() {
-                        openResourceInApp(res);
-                    });
-                    menu->addAction(act);
-                }
-                menu->exec(QCursor::pos());
-            });
+        currentIds.insert(goal.id);
+    }
+    for (auto it = m_goalCards.begin(); it != m_goalCards.end();) {
+        if (!currentIds.contains(it.key())) {
+            goalsCardLayout->removeWidget(it->card);
+            it->card->deleteLater();
+            it = m_goalCards.erase(it);
+        } else {
+            ++it;
         }
-        cardLayout->addLayout(resourceEmojiLayout);
+    }
 
-        // Title, category, and recurrence (all in one line)
-        QString titleText = QString("%1 (%2)").arg(goal.subject, goal.category);
-        if (goal.recurrenceType != "None") {
-            titleText += QString("  <span style='background:#6F2232; color:#fff; border-radius:4px; padding:2px 6px; font-size:12px;'>[%1: %2]</span>")
-                .arg(goal.recurrenceType, goal.recurrenceValue);
+    // Add new cards, patch changed ones, leave the rest alone
+    QList<int> order;
+    for (const auto &goal : goals) {
+        order.append(goal.id);
+        auto it = m_goalCards.find(goal.id);
+        if (it == m_goalCards.end()) {
+            updateGoalCard(*m_goalCards.insert(goal.id, createGoalCard(goal)), goal);
+            continue;
         }
-        QLabel *title = new QLabel(titleText);
-        title->setStyleSheet("font-weight: bold; font-size: 16px;");
-        title->setTextFormat(Qt::RichText);
-        cardLayout->addWidget(title);
-
-        // Progress bar
-        int completed = goal.completedMinutes;
-        int target = goal.targetMinutes > 0 ? goal.targetMinutes : 1; // Prevent zero range
-        float percent = (target > 0) ? (float)completed / target * 100.0f : 0.0f;
-        QProgressBar *progress = new QProgressBar();
-        progress->setObjectName("goalProgressBar");
-        progress->setRange(0, target);
-        progress->setValue(completed);
-        progress->setFormat(QString("%1/%2 minutes (%3%)").arg(completed).arg(target).arg(percent, 0, 'f', 1));
-        progress->setStyleSheet("QProgressBar::chunk { background-color: #C3073F; min-width: 2px; }"); // Always visible
-        cardLayout->addWidget(progress);
-        if (goal.id == m_currentActiveGoalId) {
-            m_activeGoalProgressBar = progress;
-        }
-
-        // Inline actions
-        QHBoxLayout *actions = new QHBoxLayout();
-        QPushButton *startBtn = new QPushButton("Start");
-        startBtn->setToolTip("Start Tracking");
-        QPushButton *stopBtn = new QPushButton("Stop");
-        stopBtn->setToolTip("Stop Tracking");
-        QPushButton *deleteBtn = new QPushButton("Delete");
-        deleteBtn->setToolTip("Delete Goal");
-        actions->addWidget(startBtn);
-        actions->addWidget(stopBtn);
-        actions->addWidget(deleteBtn);
-        QString btnStyle = "QPushButton { background-color: #6F2232; color: white; border: none; padding: 5px 10px; border-radius: 3px;width: 100px; } QPushButton:hover { background-color: #950740; }";
-        startBtn->setStyleSheet(btnStyle);
-        stopBtn->setStyleSheet(btnStyle);
-        deleteBtn->setStyleSheet(btnStyle);
-        actions->addStretch();
-        cardLayout->addLayout(actions);
-
-        connect(startBtn, &QPushButton::clicked, this, [this, goal]() {
-            if (!pomodoroTimer || !studyGoal) {
-                qDebug() << "Error: pomodoroTimer or studyGoal is null!";
-                return;
-            }
-            // Prevent tracking if goal is already completed
-            int completed = studyGoal->getProgress(goal.id);
-            int target = studyGoal->getTarget(goal.id);
-            if (target > 0 && completed >= target) {
-                QMessageBox::warning(this, "Goal Already Completed", "You cannot track a goal that is already completed.");
-                return;
-            }
-            // Clear session progress for all other goals
-            m_currentSessionProgress.clear();
-            m_currentActiveGoalId = goal.id;
-            int initialElapsedSeconds = 0;
-            studyGoal->startTrackingGoal(goal.id, initialElapsedSeconds);
-            pomodoroTimer->start();
-        });
-        connect(stopBtn, &QPushButton::clicked, this, [this]() {
-            if (!pomodoroTimer || !studyGoal) {
-                qDebug() << "Error: pomodoroTimer or studyGoal is null!";
-                return;
-            }
-            qDebug() << "Stop button clicked";
-            pomodoroTimer->pause();
-            studyGoal->stopTrackingGoal();
-        });
-        connect(deleteBtn, &QPushButton::clicked, this, [this, goal, card]() {
-            if (QMessageBox::question(this, "Confirm Deletion", "Are you sure you want to delete this goal?", QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
-                studyGoal->deleteGoal(goal.id);
-                card->deleteLater();
-            }
-        });
+        const GoalInfo &shown = it->shown;
+        if (shown.subject != goal.subject || shown.category != goal.category
+            || shown.recurrenceType != goal.recurrenceType || shown.recurrenceValue != goal.recurrenceValue
+            || shown.resources != goal.resources || shown.completedMinutes != goal.completedMinutes
+            || shown.targetMinutes != goal.targetMinutes
+            || it->shownRollup != studyGoal->getRollup(goal.id) || it->shownBlocked != studyGoal->isBlocked(goal.id)) {
+            updateGoalCard(*it, goal);
+        }
+    }
 
-        card->setStyleSheet("background: #222; border: 1px solid #6F2232; border-radius: 8px; padding: 10px;");
-        card->setFixedHeight(360);
-        goalsCardLayout->addWidget(card, row, col);
-        col++;
-        if (col >= colCount) { col = 0; row++; }
+    if (goals.isEmpty()) {
+        if (!m_goalsEmptyLabel) {
+            m_goalsEmptyLabel = new QLabel("No goals yet! Create your first goal above.");
+            m_goalsEmptyLabel->setAlignment(Qt::AlignCenter);
+            m_goalsEmptyLabel->setStyleSheet("color: #aaa; font-style: italic;");
+            goalsCardLayout->addWidget(m_goalsEmptyLabel, 0, 0);
+        }
+        m_goalsEmptyLabel->show();
+        m_goalCardOrder.clear();
+        return;
+    }
+    if (m_goalsEmptyLabel) {
+        m_goalsEmptyLabel->hide();
+    }
 
-        // --- Enable editing on card click ---
-        card->setCursor(Qt::PointingHandCursor);
-        card->installEventFilter(this);
-        card->setProperty("goalId", goal.id);
+    // Reflow the grid only when the set or order of cards changed
+    if (order == m_goalCardOrder) return;
+    m_goalCardOrder = order;
+    for (int goalId : order) {
+        goalsCardLayout->removeWidget(m_goalCards[goalId].card);
+    }
+    int colCount = 3; // Number of cards per row
+    for (int i = 0; i < order.size(); ++i) {
+        goalsCardLayout->addWidget(m_goalCards[order[i]].card, i / colCount, i % colCount);
     }
 }
-void MainWindow::handleGoalCreated(int goalId)
+void MainWindow::scheduleMidnightCheck()
 {
-    refreshGoalsDisplay();
+    // A second past midnight, so currentDate() has already moved on
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime nextDay(now.date().addDays(1), QTime(0, 0, 1));
+    midnightTimer->start(int(qMax<qint64>(1000, now.msecsTo(nextDay))));
 }
 
-void MainWindow::handleGoalUpdated(int goalId)
+void MainWindow::onDateChanged()
 {
+    if (studyStreak) studyStreak->checkAndUpdateStreak();
+    scheduleMidnightCheck();
+}
+
+void MainWindow::handleGoalsChanged(const GoalDelta &delta)
+{
+    // One refresh per store change, however many goals it touched
+    if (delta.isEmpty()) return;
     refreshGoalsDisplay();
 }
 
@@ -1964,16 +2229,26 @@ void MainWindow::onGoalSessionTimeUpdated(int goalId, int elapsedSeconds)
 {
     qDebug() << "MainWindow: Goal" << goalId << "session time updated:" << elapsedSeconds << "seconds";
     // Store the temporary session progress in seconds
+    bool minuteChanged = !m_currentSessionProgress.contains(goalId)
+                         || m_currentSessionProgress.value(goalId) / 60 != elapsedSeconds / 60;
     m_currentSessionProgress[goalId] = elapsedSeconds;
-    // No more goalsListWidget updates here
+    // The bar shows whole minutes, so only repaint when that number moves
+    if (minuteChanged) {
+        updateGoalProgressBar(goalId);
+    }
 }
 
 void MainWindow::onGoalSessionProgressUpdated(int goalId, int sessionMinutes)
 {
     qDebug() << "onGoalSessionProgressUpdated called for goal" << goalId << "sessionMinutes:" << sessionMinutes;
+    // goalsChanged already rebuilt the cards; only this bar still shows the session minutes
     m_currentSessionProgress.remove(goalId);
-    refreshGoalsDisplay();
+    updateGoalProgressBar(goalId);
+    notifyGoalCompleted(goalId);
+}
 
+void MainWindow::notifyGoalCompleted(int goalId)
+{
     // Check if goal is completed
     float completionPercentage = studyGoal->getCompletionPercentage(goalId);
     if (completionPercentage >= 100.0f) {
@@ -1988,6 +2263,11 @@ void MainWindow::onGoalSessionProgressUpdated(int goalId, int sessionMinutes)
         }
         QMessageBox::information(this, "Goal Completed!",
                                  QString("Congratulations! You have completed your goal for '%1'!").arg(studyGoal->getGoalDetails(goalId)["subject"].toString()));
+        bool allDone = true;
+        for (const GoalInfo &goal : studyGoal->getGoalsForDate(QDate::currentDate())) {
+            if (goal.targetMinutes > 0 && goal.completedMinutes < goal.targetMinutes) allDone = false;
+        }
+        if (allDone) achievementTracker->trackDailyGoalsCompleted();
         refreshGoalsDisplay(); // Ensure UI updates after dialog
     }
 }
@@ -1996,22 +2276,11 @@ void MainWindow::onGoalTrackingStarted(int goalId)
 {
     Q_UNUSED(goalId);
     m_currentActiveGoalId = goalId;
-    progressUpdateTimer->start();
     QMessageBox::information(this, "Goal Tracking", "Tracking started for selected goal.");
 }
 
 void MainWindow::onGoalTrackingStopped()
 {
-    progressUpdateTimer->stop();
-}
-
-void MainWindow::handleGoalDeleted(int goalId)
-{
-    Q_UNUSED(goalId);
-    if (m_currentActiveGoalId == goalId) {
-       // handleStopGoalTracking();
-    }
-    refreshGoalsDisplay();
 }
 
 void MainWindow::onAchievementUnlocked(const QString &achievementId, const QString &name)
@@ -2039,6 +2308,54 @@ void MainWindow::refreshAchievementsDisplay()
         .arg(achievementTracker->getCompletionPercentage(), 0, 'f', 1));
 }
 
+void MainWindow::refreshAchievementInsights()
+{
+    const QString id = achievementTimelineCombo->currentData().toString();
+    int target = 1;
+    for (const auto &info : achievementTracker->getUnlockedAchievements() + achievementTracker->getLockedAchievements()) {
+        if (info.id == id) target = qMax(1, info.requiredValue);
+    }
+
+    QLineSeries *series = new QLineSeries();
+    QList<QPointF> points;
+    for (const auto &snapshot : achievementTracker->getProgressHistory(id)) {
+        points.append(QPointF(snapshot.first.toMSecsSinceEpoch(), qMin(100.0, 100.0 * snapshot.second / target)));
+    }
+    series->replace(points);
+
+    QChart *chart = new QChart();
+    chart->addSeries(series);
+    chart->setTitle(achievementTimelineCombo->currentText());
+    chart->legend()->hide();
+    QDateTimeAxis *axisX = new QDateTimeAxis();
+    axisX->setFormat("MMM dd");
+    chart->addAxis(axisX, Qt::AlignBottom);
+    series->attachAxis(axisX);
+    QValueAxis *axisY = new QValueAxis();
+    axisY->setRange(0, 100);
+    axisY->setTitleText("Progress %");
+    chart->addAxis(axisY, Qt::AlignLeft);
+    series->attachAxis(axisY);
+    chart->setTheme(QChart::ChartThemeDark);
+    QPen pen(QColor("#C3073F"));
+    pen.setWidth(3);
+    series->setPen(pen);
+
+    QChart *previous = achievementTimelineView->chart();
+    achievementTimelineView->setChart(chart);
+    delete previous;
+
+    achievementRuleCostList->clear();
+    for (const Achievement::RuleCost &cost : achievementTracker->getRuleCosts()) {
+        if (cost.evaluations == 0) continue;
+        achievementRuleCostList->addItem(QString("%1: %2 evaluations, %3 ms total, %4 µs each")
+            .arg(cost.name)
+            .arg(cost.evaluations)
+            .arg(cost.nanoseconds / 1e6, 0, 'f', 2)
+            .arg(cost.nanoseconds / 1e3 / cost.evaluations, 0, 'f', 2));
+    }
+}
+
 void MainWindow::handleCancelEdit()
 {
     m_currentSelectedGoalId = -1;
@@ -2049,6 +2366,7 @@ void MainWindow::handleCancelEdit()
     recurrenceTypeCombo->setCurrentIndex(0);
     recurrenceValueInput->clear();
     goalCategoryCombo->setCurrentIndex(0);
+    refreshGoalStructureInputs();
 
     addGoalButton->setText("Add Goal");
     cancelEditButton->setEnabled(false);
@@ -2186,19 +2504,64 @@ void MainWindow::exportToCSV()
     QMessageBox::information(this, tr("Success"), tr("All data exported successfully to %1").arg(fileName));
 }
 
+void MainWindow::exportJsonLines()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Goals and Sessions"), "studybuddy.jsonl", tr("JSON Lines (*.jsonl);;All Files (*)"));
+    if (fileName.isEmpty()) return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        QMessageBox::critical(this, tr("Error"), tr("Could not open file for writing."));
+        return;
+    }
+
+    DataExchange::Report report;
+    if (!DataExchange::exportJsonLines(db, file, &report)) {
+        QMessageBox::critical(this, tr("Error"), tr("Export failed: %1").arg(report.errors.join("\n")));
+        return;
+    }
+    QMessageBox::information(this, tr("Success"), tr("Exported %1 goals, %2 sessions and %3 surveys to %4")
+                             .arg(report.records.value("goal")).arg(report.records.value("session"))
+                             .arg(report.records.value("survey")).arg(fileName));
+}
+
+void MainWindow::importJsonLines()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Import Goals and Sessions"), QString(), tr("JSON Lines (*.jsonl);;All Files (*)"));
+    if (fileName.isEmpty()) return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QMessageBox::critical(this, tr("Error"), tr("Could not open file for reading."));
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    DataExchange::Report report;
+    const bool ok = DataExchange::importJsonLines(db, file, &report);
+    QApplication::restoreOverrideCursor();
+    // Goals changed behind StudyGoal's back
+    studyGoal->reloadGoals();
+
+    QString summary = tr("Imported %1 goals, %2 resources, %3 sessions and %4 surveys.")
+                          .arg(report.records.value("goal")).arg(report.records.value("resource"))
+                          .arg(report.records.value("session")).arg(report.records.value("survey"));
+    if (report.skipped > 0) {
+        summary += tr("\nSkipped %1 invalid records:\n%2").arg(report.skipped).arg(report.errors.join("\n"));
+    }
+    if (ok) {
+        QMessageBox::information(this, tr("Import"), summary);
+    } else {
+        // The error that stopped the import is always the last one
+        QMessageBox::critical(this, tr("Import Failed"), summary + "\n" + report.errors.value(report.errors.size() - 1));
+    }
+}
+
 void MainWindow::showSummaryPopup(bool weekly)
 {
     QDate startDate = weekly ? QDate::currentDate().addDays(-6) : QDate::currentDate();
     QDate endDate = QDate::currentDate();
 
     // Study time
-    int totalMinutes = 0;
-    if (weekly) {
-        QMap<QDate, int> history = studyStreak->getStudyHistory(startDate, endDate);
-        for (auto minutes : history.values()) totalMinutes += minutes;
-    } else {
-        totalMinutes = studyStreak->getStudyHistory(endDate, endDate).value(endDate, 0);
-    }
+    int totalMinutes = studyStreak->getStudyMinutesBetween(startDate, endDate);
 
     // Sessions
     int sessionCount = 0;
@@ -2252,35 +2615,28 @@ void MainWindow::showSummaryPopup(bool weekly)
     msgBox.exec();
 }
 
-void MainWindow::updateGoalProgressBars()
+void MainWindow::updateGoalProgressBar(int goalId)
 {
-    QList<GoalInfo> goals = studyGoal->getGoalsForDate(QDate::currentDate());
-    for (int i = 0; i < goals.size(); ++i) {
-        const GoalInfo& goal = goals[i];
-        QLayoutItem* item = goalsCardLayout->itemAtPosition(i / 3, i % 3);
-        if (!item) continue;
-        QWidget* card = item->widget();
-        if (!card) continue;
-        QProgressBar* progress = card->findChild<QProgressBar*>();
-        if (!progress) continue;
-
-        int completed = goal.completedMinutes;
-        int target = goal.targetMinutes > 0 ? goal.targetMinutes : 1;
-        int total = completed;
-
-        // Only use session progress for the currently tracked goal, and only if tracking is active
-        if (goal.id == m_currentActiveGoalId && pomodoroTimer && pomodoroTimer->isRunning()) {
-            int elapsedSeconds = m_currentSessionProgress.value(goal.id, 0);
-            int elapsedMinutes = elapsedSeconds / 60;
-            total = completed + elapsedMinutes;
-        }
-        // For all other goals, always use completedMinutes from the database
-
-        float percent = (target > 0) ? (float)total / target * 100.0f : 0.0f;
-        progress->setRange(0, target);
-        progress->setValue(total);
-        progress->setFormat(QString("%1/%2 minutes (%3%)").arg(total).arg(target).arg(percent, 0, 'f', 1));
+    auto card = m_goalCards.constFind(goalId);
+    if (card == m_goalCards.constEnd() || !card->progress) return;
+    QProgressBar *progress = card->progress;
+
+    // Goals with sub-goals show the rolled-up minutes of everything they contain
+    const GoalRollup rollup = studyGoal->getRollup(goalId);
+    int completed = rollup.goalCount > 1 ? rollup.completedMinutes : studyGoal->getProgress(goalId);
+    int target = rollup.goalCount > 1 ? rollup.targetMinutes : studyGoal->getTarget(goalId);
+    if (target <= 0) target = 1;
+    int total = completed;
+
+    // Only the tracked goal has in-flight session minutes on top of its saved progress
+    if (goalId == m_currentActiveGoalId) {
+        total += m_currentSessionProgress.value(goalId, 0) / 60;
     }
+
+    float percent = (float)total / target * 100.0f;
+    progress->setRange(0, target);
+    progress->setValue(total);
+    progress->setFormat(QString("%1/%2 minutes (%3%)").arg(total).arg(target).arg(percent, 0, 'f', 1));
 }
 
 void MainWindow::showYearlyActivityDialog()
@@ -2298,91 +2654,56 @@ void MainWindow::showYearlyActivityDialog()
     QLabel *yearLabel = new QLabel(QString::number(currentYear));
     yearLabel->setAlignment(Qt::AlignCenter);
     yearLabel->setMinimumWidth(60);
+    QSpinBox *yearCountSpin = new QSpinBox();
+    yearCountSpin->setRange(1, 5);
+    yearCountSpin->setSuffix(" year(s)");
     yearNavLayout->addWidget(prevYearBtn);
     yearNavLayout->addWidget(yearLabel);
     yearNavLayout->addWidget(nextYearBtn);
+    yearNavLayout->addWidget(new QLabel("Show:"));
+    yearNavLayout->addWidget(yearCountSpin);
     yearNavLayout->addStretch();
     mainLayout->addLayout(yearNavLayout);
 
-    // Widgets to update
     QLabel *counter = new QLabel();
     mainLayout->addWidget(counter, 0, Qt::AlignLeft);
-    QHBoxLayout *monthLayout = new QHBoxLayout();
-    monthLayout->addSpacing(40);
-    for (int m = 1; m <= 12; ++m) {
-        QLabel *monthLabel = new QLabel(QLocale::system().monthName(m, QLocale::ShortFormat));
-        monthLabel->setAlignment(Qt::AlignCenter);
-        monthLabel->setMinimumWidth(70);
-        monthLayout->addWidget(monthLabel);
-    }
-    mainLayout->addLayout(monthLayout);
-    QGridLayout *grid = new QGridLayout();
-    QStringList weekdays = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
-    for (int i = 0; i < weekdays.size(); ++i) {
-        QLabel *lbl = new QLabel(weekdays[i]);
-        lbl->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        grid->addWidget(lbl, i+1, 0);
-    }
-    mainLayout->addLayout(grid);
-
-    auto updateCalendar = [&](int year) {
-        yearLabel->setText(QString::number(year));
-        // Remove old cells
-        QLayoutItem *item;
-        while ((item = grid->takeAt(grid->count()-1))) {
-            if (item->widget() && item->widget()->parent() == &dialog) {
-                delete item->widget();
+    ActivityHeatmap *heatmap = new ActivityHeatmap();
+    QScrollArea *heatmapScroll = new QScrollArea();
+    heatmapScroll->setWidget(heatmap);
+    heatmapScroll->setWidgetResizable(false);
+    heatmapScroll->setFrameShape(QFrame::NoFrame);
+    mainLayout->addWidget(heatmapScroll, 1);
+
+    // Years are loaded once per dialog; navigating back and forth only repaints
+    auto updateCalendar = [&](int lastYear, int yearCount) {
+        for (int year = lastYear - yearCount + 1; year <= lastYear; ++year) {
+            if (heatmap->hasYearData(year)) continue;
+            const QDate firstDay(year, 1, 1);
+            QVector<int> minutes(firstDay.daysInYear(), 0);
+            const QMap<QDate, int> studyDays = studyStreak->getStudyHistory(firstDay, QDate(year, 12, 31));
+            for (auto it = studyDays.constBegin(); it != studyDays.constEnd(); ++it) {
+                minutes[it.key().dayOfYear() - 1] = it.value();
             }
-            delete item;
-        }
-        // Re-add weekday labels
-        for (int i = 0; i < weekdays.size(); ++i) {
-            QLabel *lbl = new QLabel(weekdays[i]);
-            lbl->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            grid->addWidget(lbl, i+1, 0);
-        }
-        // Get study days
-        QMap<QDate, int> studyDays = studyStreak->getStudyHistory(QDate(year, 1, 1), QDate(year, 12, 31));
-        int totalEvents = 0;
-        for (auto v : studyDays.values()) if (v > 0) totalEvents++;
-        counter->setText(QString("<b>Total study days this year:</b> %1").arg(totalEvents));
-        // Fill grid
-        QDate firstDay(year, 1, 1);
-        QDate lastDay(year, 12, 31);
-        int colOffset = 1;
-        QDate d = firstDay;
-        while (d <= lastDay) {
-            int week = d.weekNumber();
-            int weekday = d.dayOfWeek();
-            int col = ((d.dayOfYear() - 1) / 7) + colOffset;
-            int row = weekday;
-            QFrame *cell = new QFrame();
-            cell->setFixedSize(16, 16);
-            int minutes = studyDays.value(d, 0);
-            // Heatmap color: white (no study), light red (few min), dark red (many min)
-            QString color;
-            if (minutes == 0) color = "#eee";
-            else if (minutes < 15) color = "#ffb3b3";
-            else if (minutes < 30) color = "#ff6666";
-            else if (minutes < 60) color = "#ff1a1a";
-            else if (minutes < 120) color = "#c3073f";
-            else color = "#800000";
-            cell->setStyleSheet(QString("background:%1; border-radius:3px; border:1px solid #eee;").arg(color));
-            // Tooltip with date and minutes
-            cell->setToolTip(QString("%1\n%2 minutes studied").arg(d.toString("yyyy-MM-dd")).arg(minutes));
-            grid->addWidget(cell, row, col);
-            d = d.addDays(1);
+            heatmap->setYearData(year, minutes);
         }
+        heatmap->setShownYears(lastYear, yearCount);
+        heatmap->resize(heatmap->sizeHint());
+        yearLabel->setText(yearCount > 1 ? QString("%1–%2").arg(lastYear - yearCount + 1).arg(lastYear) : QString::number(lastYear));
+        counter->setText(QString("<b>Total study days %1:</b> %2")
+                             .arg(yearCount > 1 ? "in these years" : "this year").arg(heatmap->studyDayCount()));
     };
     int shownYear = currentYear;
-    updateCalendar(shownYear);
+    updateCalendar(shownYear, 1);
     QObject::connect(prevYearBtn, &QPushButton::clicked, [&]() {
         shownYear--;
-        updateCalendar(shownYear);
+        updateCalendar(shownYear, yearCountSpin->value());
     });
     QObject::connect(nextYearBtn, &QPushButton::clicked, [&]() {
         shownYear++;
-        updateCalendar(shownYear);
+        updateCalendar(shownYear, yearCountSpin->value());
+    });
+    QObject::connect(yearCountSpin, QOverload<int>::of(&QSpinBox::valueChanged), [&](int yearCount) {
+        updateCalendar(shownYear, yearCount);
     });
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
     connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
@@ -2392,40 +2713,115 @@ void MainWindow::showYearlyActivityDialog()
 
 // Add eventFilter to MainWindow to handle card clicks
 bool MainWindow::eventFilter(QObject *obj, QEvent *event) {
+    if (event->type() == QEvent::Resize && obj->property("downsampledChart").toBool()) {
+        const QResizeEvent *resize = static_cast<QResizeEvent *>(event);
+        if (resize->size().width() != resize->oldSize().width()) historyChartResizeTimer->start();
+    }
     if (event->type() == QEvent::MouseButtonPress) {
         QWidget *card = qobject_cast<QWidget *>(obj);
         if (card && card->property("goalId").isValid()) {
-            int goalId = card->property("goalId").toInt();
-            // Find the goal info
-            QList<GoalInfo> goals = studyGoal->getGoalsForDate(QDate::currentDate());
-            for (const auto &goal : goals) {
-                if (goal.id == goalId) {
-                    goalSubjectInput->setText(goal.subject);
-                    goalTargetMinutesInput->setValue(goal.targetMinutes);
-                    goalNotesInput->setPlainText(goal.notes);
-                    goalCategoryCombo->setCurrentText(goal.category);
-                    recurrenceTypeCombo->setCurrentText(goal.recurrenceType);
-                    recurrenceValueInput->setText(goal.recurrenceValue);
-                    // Resources
-                    QListWidget *resourceList = createGoalGroup->findChild<QListWidget *>();
-                    if (resourceList) {
-                        resourceList->clear();
-                        for (const QString &res : goal.resources) {
-                            resourceList->addItem(res);
-                        }
-                    }
-                    m_currentSelectedGoalId = goal.id;
-                    addGoalButton->setText("Update Goal");
-                    cancelEditButton->setEnabled(true);
-                    break;
-                }
-            }
+            showGoalInEditor(card->property("goalId").toInt());
             return true;
         }
     }
     return QMainWindow::eventFilter(obj, event);
 }
 
+// Loads a goal into the create/edit form
+bool MainWindow::showGoalInEditor(int goalId) {
+    QMap<QString, QVariant> goal = studyGoal->getGoalDetails(goalId);
+    if (goal.isEmpty()) return false;
+
+    goalSubjectInput->setText(goal["subject"].toString());
+    goalTargetMinutesInput->setValue(goal["target_minutes"].toInt());
+    goalNotesInput->setPlainText(goal["notes"].toString());
+    goalCategoryCombo->setCurrentText(goal["category"].toString());
+    recurrenceTypeCombo->setCurrentText(goal["recurrence_type"].toString());
+    recurrenceValueInput->setText(goal["recurrence_value"].toString());
+    // Resources
+    QListWidget *resourceList = createGoalGroup->findChild<QListWidget *>();
+    if (resourceList) {
+        resourceList->clear();
+        for (const QString &res : studyGoal->getResourcesForGoal(goalId)) {
+            resourceList->addItem(res);
+        }
+    }
+    m_currentSelectedGoalId = goalId;
+    refreshGoalStructureInputs();
+    addGoalButton->setText("Update Goal");
+    cancelEditButton->setEnabled(true);
+    return true;
+}
+
+void MainWindow::runGlobalSearch() {
+    const QString text = globalSearchInput->text().trimmed();
+    globalSearchModel->clear();
+    if (text.isEmpty()) {
+        globalSearchCompleter->popup()->hide();
+        return;
+    }
+
+    static const QMap<QString, QString> kindLabels = {
+        {"goal", "Goal"}, {"resource", "Resource"}, {"survey", "Survey"}, {"chat", "Buddy"}
+    };
+    for (const SearchHit &hit : searchIndex->search(text, 15)) {
+        QString label = QString("%1: %2").arg(kindLabels.value(hit.kind, hit.kind), hit.title);
+        if (!hit.snippet.isEmpty()) label += " - " + hit.snippet.simplified();
+        QStandardItem *item = new QStandardItem(label);
+        item->setData(hit.kind, Qt::UserRole);
+        item->setData(hit.ref, Qt::UserRole + 1);
+        globalSearchModel->appendRow(item);
+    }
+    if (globalSearchModel->rowCount() > 0) {
+        globalSearchCompleter->complete();
+    } else {
+        globalSearchCompleter->popup()->hide();
+    }
+}
+
+void MainWindow::openSearchResult(const QModelIndex &index) {
+    const QString kind = index.data(Qt::UserRole).toString();
+    const QString ref = index.data(Qt::UserRole + 1).toString();
+    auto showTab = [this](const QString &name) {
+        for (int i = 0; i < tabWidget->count(); ++i) {
+            if (tabWidget->tabText(i) == name) {
+                tabWidget->setCurrentIndex(i);
+                break;
+            }
+        }
+    };
+
+    if (kind == "goal" || kind == "resource") {
+        showTab("Dashboard");
+        if (!showGoalInEditor(ref.toInt())) {
+            QMessageBox::information(this, "Search", "This goal no longer exists.");
+        }
+    } else if (kind == "survey") {
+        QSqlQuery query(db);
+        query.prepare("SELECT s.timestamp, s.open_feedback, g.subject FROM surveys s LEFT JOIN goals g ON g.id = s.goal_id WHERE s.id = ?");
+        query.addBindValue(ref.toInt());
+        if (query.exec() && query.next()) {
+            showTab("Surveys");
+            QMessageBox::information(this, "Survey Feedback",
+                QString("%1 (%2)\n\n%3").arg(query.value(2).toString(),
+                                             QDateTime::fromString(query.value(0).toString(), Qt::ISODate).toString("yyyy-MM-dd HH:mm"),
+                                             query.value(1).toString()));
+        }
+    } else if (kind == "chat") {
+        showTab("Buddy");
+        // Clear the conversation filter so list rows match conversation indexes again
+        if (buddyConversationSearch) buddyConversationSearch->clear();
+        for (int i = 0; i < buddyConversations.size(); ++i) {
+            if (buddyConversations[i].id == ref) {
+                buddyConversationList->setCurrentRow(i);
+                switchBuddyConversation(i);
+                break;
+            }
+        }
+    }
+    globalSearchInput->clear();
+}
+
 void MainWindow::createSurveysTab()
 {
     QWidget *surveysTab = new QWidget();
@@ -2615,6 +3011,7 @@ for (int i = 0; i < maxStars; ++i) {
         result.openFeedback = openFeedback;
         result.setReminder = setReminder;
         if (survey->saveSurveyResult(result)) {
+            achievementTracker->trackSurvey(result.sessionSatisfaction);
             statusLabel->setText("Survey saved! Thank you for your feedback.");
             for (QPushButton *btn : emojiButtons) btn->setChecked(false);
             distractionSlider->setValue(0);
@@ -2971,10 +3368,20 @@ void MainWindow::createBuddyChatTab() {
 void MainWindow::filterBuddyConversations(const QString& text) {
     buddyConversationSearchText = text.trimmed();
     buddyConversationList->clear();
+
+    // Ask the index which conversations match, falling back to scanning the messages
+    QSet<QString> indexedMatches;
+    const bool useIndex = searchIndex && searchIndex->isAvailable() && !buddyConversationSearchText.isEmpty();
+    if (useIndex) {
+        for (const SearchHit &hit : searchIndex->search(buddyConversationSearchText, buddyConversations.size(), {"chat"})) {
+            indexedMatches.insert(hit.ref);
+        }
+    }
     for (int i = 0; i < buddyConversations.size(); ++i) {
         const auto& conv = buddyConversations[i];
-        bool match = conv.title.contains(buddyConversationSearchText, Qt::CaseInsensitive);
-        if (!match) {
+        bool match = useIndex ? indexedMatches.contains(conv.id)
+                              : conv.title.contains(buddyConversationSearchText, Qt::CaseInsensitive);
+        if (!match && !useIndex) {
             for (const auto& msg : conv.messages) {
                 if (msg.second.contains(buddyConversationSearchText, Qt::CaseInsensitive)) {
                     match = true;
@@ -3013,6 +3420,7 @@ void MainWindow::loadBuddyConversations() {
         }
         buddyConversations.append(conv);
     }
+    syncBuddySearchIndex();
 }
 
 void MainWindow::saveBuddyConversations() {
@@ -3037,6 +3445,18 @@ void MainWindow::saveBuddyConversations() {
         file.write(QJsonDocument(arr).toJson());
         file.close();
     }
+    syncBuddySearchIndex();
+}
+
+void MainWindow::syncBuddySearchIndex() {
+    if (!searchIndex || !searchIndex->isAvailable()) return;
+    QList<SearchIndex::Document> documents;
+    for (const auto& conv : buddyConversations) {
+        QStringList texts;
+        for (const auto& msg : conv.messages) texts << msg.second;
+        documents.append(SearchIndex::Document{conv.id, conv.title, texts.join('\n')});
+    }
+    searchIndex->syncConversations(documents);
 }
 
 void MainWindow::startNewBuddyConversation() {
@@ -3497,10 +3917,23 @@ void MainWindow::openDayPlannerDialog(const QDate& date) {
         int eveningFree = freeTimeInputs["evening"]->value();
         int nightFree = freeTimeInputs["night"]->value();
         QList<GoalInfo> goals = studyGoal->getGoalsForDate(date);
+        QSet<int> listed;
+        for (const auto& goal : goals) listed.insert(goal.id);
         QStringList plan;
         int m = morningFree, e = eveningFree, n = nightFree;
         for (const auto& goal : goals) {
-            int minutes = goal.targetMinutes - goal.completedMinutes;
+            // A larger goal due the same day is planned with its rolled-up minutes, covering its sub-goals
+            bool coveredByAncestor = false;
+            for (int ancestorId : studyGoal->getAncestors(goal.id)) {
+                if (listed.contains(ancestorId)) coveredByAncestor = true;
+            }
+            if (coveredByAncestor) continue;
+            if (studyGoal->isBlocked(goal.id)) {
+                plan << QString("%1: waiting on prerequisites").arg(goal.subject);
+                continue;
+            }
+            const GoalRollup rollup = studyGoal->getRollup(goal.id);
+            int minutes = rollup.targetMinutes - rollup.completedMinutes;
             if (minutes <= 0) continue;
             int remaining = minutes;
             QStringList assignedParts;
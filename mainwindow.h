@@ -37,15 +37,21 @@
 #include "analytics.h"
 #include "achievements.h"
 #include "achievementitemdelegate.h"
+#include "achievementbackfill.h"
 #include <QMap>
 #include <QComboBox>
 #include "streak.h"
 #include "studysession.h"
+#include "downsampler.h"
+#include "focussketches.h"
+#include "searchindex.h"
 #include <QGridLayout>
 #include <QNetworkAccessManager>
 #include <QString>
 #include <QCalendarWidget>
 #include <QPointer>
+#include <QCompleter>
+#include <QStandardItemModel>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -174,9 +180,8 @@ private slots:
     //void handleStartGoalTracking();
     //void handleStopGoalTracking();
     void refreshGoalsDisplay();
-    void handleGoalCreated(int goalId);
-    void handleGoalDeleted(int goalId);
-    void handleGoalUpdated(int goalId);
+    void handleGoalsChanged(const GoalDelta &delta);
+    void onDateChanged();
     void onGoalSessionTimeUpdated(int goalId, int elapsedSeconds);
     void onGoalSessionProgressUpdated(int goalId, int sessionMinutes);
     void onGoalTrackingStarted(int goalId);
@@ -186,9 +191,14 @@ private slots:
     void onAchievementUnlocked(const QString &achievementId, const QString &name);
     void onAchievementProgressUpdated(const QString &achievementId, int progress);
     void refreshAchievementsDisplay();
+    void refreshAchievementInsights();
     void handleCancelEdit();
 
-    void updateGoalProgressBars();
+    void updateGoalProgressBar(int goalId);
+
+    // Global search
+    void runGlobalSearch();
+    void openSearchResult(const QModelIndex &index);
 
 public slots:
     void showYearlyActivityDialog();
@@ -209,6 +219,8 @@ private:
     QPushButton *settingsButton;
     QCheckBox *enableFaceDetectionCheckbox;
     QTimer *timer;
+    QTimer *midnightTimer = nullptr;
+    QTimer *historyChartResizeTimer = nullptr;
     QLabel *blinkCountLabel;
     QProgressBar *focusProgressBar;
     QSystemTrayIcon *trayIcon;
@@ -240,19 +252,59 @@ private:
     QPushButton *cancelEditButton;
     QComboBox *recurrenceTypeCombo;
     QLineEdit *recurrenceValueInput;
+    QComboBox *goalPartOfCombo = nullptr;
+    QListWidget *goalPrerequisiteList = nullptr;
+    void refreshGoalStructureInputs();
+    bool applyGoalStructureInputs(int goalId);
     QGridLayout *goalsCardLayout; // For the card/grid view of goals
+    // One card per goal id, kept across refreshes and only patched when the goal changes
+    struct GoalCard {
+        QWidget *card = nullptr;
+        QPushButton *resourceButton = nullptr;
+        QLabel *title = nullptr;
+        QProgressBar *progress = nullptr;
+        GoalInfo shown;
+        GoalRollup shownRollup;
+        bool shownBlocked = false;
+    };
+    QHash<int, GoalCard> m_goalCards;
+    QList<int> m_goalCardOrder;
+    QLabel *m_goalsEmptyLabel = nullptr;
+    GoalCard createGoalCard(const GoalInfo &goal);
+    void notifyGoalCompleted(int goalId);
+    void scheduleMidnightCheck();
+    void updateGoalCard(GoalCard &card, const GoalInfo &goal);
+    bool showGoalInEditor(int goalId);
+
+    // Global search box in the toolbar
+    SearchIndex *searchIndex = nullptr;
+    QLineEdit *globalSearchInput = nullptr;
+    QCompleter *globalSearchCompleter = nullptr;
+    QStandardItemModel *globalSearchModel = nullptr;
+    QTimer *globalSearchTimer = nullptr;
     // Achievement Elements
     QLabel *totalAchievementsLabel;
     QLabel *unlockedAchievementsLabel;
     QLabel *achievementCompletionPercentageLabel;
-    Achievement *achievementTracker;
+    Achievement *achievementTracker = nullptr;
     QLabel *m_achievementDescriptionLabel;
+    AchievementBackfill *achievementBackfill = nullptr;
+    QProgressBar *achievementBackfillBar = nullptr;
+    QComboBox *achievementTimelineCombo = nullptr;
+    QChartView *achievementTimelineView = nullptr;
+    QListWidget *achievementRuleCostList = nullptr;
 
     // Chart Elements
     QChartView *focusChartView;
     QChartView *blinkChartView;
     QLineSeries *focusSeries;
     QLineSeries *blinkSeries;
+    Downsampler::WindowDecimator focusPoints; // last hour of live data, decimated for focusSeries
+    Downsampler::WindowDecimator blinkPoints;
+    QList<QPointF> liveChartPoints; // reused by every refresh
+    QTimer *chartRefreshTimer = nullptr;
+    int liveChartRefreshHz = 4;
+    bool liveChartOpenGL = false;
     QValueAxis *timeAxis;
     QValueAxis *focusAxis;
     QValueAxis *blinkAxis;
@@ -270,6 +322,7 @@ private:
     bool faceDetectionEnabled;
     bool alertsEnabled;
     int alertThreshold;
+    StreakRules streakRules;
     QString soundFile;
 
     // Detection Variables
@@ -314,6 +367,8 @@ private:
     float calculateHeadPose(const std::vector<cv::Point2f>& landmarks);
     void playAlertSound();
     void exportToCSV();
+    void exportJsonLines();
+    void importJsonLines();
     void saveSettings();
     void loadSettings();
     void createSurveysTab();
@@ -323,6 +378,7 @@ private:
     // Chart Functions
     void setupCharts();
     void updateChartData();
+    void refreshLiveCharts();
     void clearCharts();
 
     void setupDarkAcademiaTheme();
@@ -332,12 +388,11 @@ private:
     StudyStreak* studyStreak;
     QLabel* streakSummaryLabel;
     StudySession* studySession;
+    FocusSketchStore *focusSketches = nullptr;
+    QStringList sessionSubjects; // subjects of the goals linked to the running webcam session
 
     void showSummaryPopup(bool weekly = false);
 
-    QTimer *progressUpdateTimer;
-
-    QProgressBar *m_activeGoalProgressBar = nullptr;
     QGroupBox *createGoalGroup;
     void openResourceInApp(const QString &res);
 
@@ -372,6 +427,7 @@ private:
     void switchBuddyConversation(int index);
     void deleteBuddyConversation(int index);
     void filterBuddyConversations(const QString& text);
+    void syncBuddySearchIndex();
     void handleBuddyPromptClicked();
 
     // Gemini API integration
@@ -0,0 +1,218 @@
+#include "recurrencerule.h"
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+const char *const kDayCodes[] = {"MO", "TU", "WE", "TH", "FR", "SA", "SU"};
+const char *const kDayNames[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+int dayFromCode(const QString &code)
+{
+    for (int i = 0; i < 7; ++i) {
+        if (code.compare(kDayCodes[i], Qt::CaseInsensitive) == 0 ||
+            code.compare(kDayNames[i], Qt::CaseInsensitive) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+QDate mondayOf(const QDate &date)
+{
+    return date.addDays(1 - date.dayOfWeek());
+}
+
+int monthsBetween(const QDate &from, const QDate &to)
+{
+    return (to.year() - from.year()) * 12 + to.month() - from.month();
+}
+}
+
+RecurrenceRule RecurrenceRule::fromString(const QString &rrule, const QDate &start)
+{
+    RecurrenceRule rule;
+    rule.start = start;
+    QString text = rrule.trimmed();
+    if (text.startsWith("RRULE:", Qt::CaseInsensitive)) text = text.mid(6);
+
+    for (const QString &part : text.split(';', Qt::SkipEmptyParts)) {
+        const QString key = part.section('=', 0, 0).trimmed().toUpper();
+        const QString value = part.section('=', 1).trimmed();
+        if (key == "FREQ") {
+            const QString freq = value.toUpper();
+            rule.freq = freq == "DAILY" ? Daily : freq == "WEEKLY" ? Weekly : freq == "MONTHLY" ? Monthly : None;
+        } else if (key == "INTERVAL") {
+            rule.step = std::max(1, value.toInt());
+        } else if (key == "COUNT") {
+            rule.maxCount = std::max(0, value.toInt());
+        } else if (key == "UNTIL") {
+            // Date-times ("20261231T235959Z") are cut to their date
+            rule.lastDate = QDate::fromString(value.left(8), "yyyyMMdd");
+        } else if (key == "BYDAY") {
+            for (const QString &item : value.split(',', Qt::SkipEmptyParts)) {
+                const QString token = item.trimmed();
+                if (token.size() < 2) continue;
+                WeekDay weekDay;
+                weekDay.day = dayFromCode(token.right(2));
+                weekDay.ordinal = token.chopped(2).toInt();
+                if (weekDay.day > 0 && !rule.weekDays.contains(weekDay)) rule.weekDays.append(weekDay);
+            }
+        } else if (key == "BYMONTHDAY") {
+            for (const QString &item : value.split(',', Qt::SkipEmptyParts)) {
+                const int day = item.trimmed().toInt();
+                if (day != 0 && day >= -31 && day <= 31 && !rule.monthDays.contains(day)) rule.monthDays.append(day);
+            }
+        }
+    }
+    rule.resolveCount();
+    return rule;
+}
+
+RecurrenceRule RecurrenceRule::fromLegacy(const QString &type, const QString &value, const QDate &start)
+{
+    if (value.trimmed().startsWith("FREQ=", Qt::CaseInsensitive) ||
+        value.trimmed().startsWith("RRULE:", Qt::CaseInsensitive)) {
+        return fromString(value, start);
+    }
+
+    RecurrenceRule rule;
+    rule.start = start;
+    const QStringList items = value.split(',', Qt::SkipEmptyParts);
+    if (type == "Daily") {
+        rule.freq = Daily;
+    } else if (type == "Weekly") {
+        rule.freq = Weekly;
+        for (const QString &item : items) {
+            WeekDay weekDay;
+            weekDay.day = dayFromCode(item.trimmed());
+            if (weekDay.day > 0 && !rule.weekDays.contains(weekDay)) rule.weekDays.append(weekDay);
+        }
+    } else if (type == "Monthly") {
+        rule.freq = Monthly;
+        for (const QString &item : items) {
+            const int day = item.trimmed().toInt();
+            if (day >= 1 && day <= 31 && !rule.monthDays.contains(day)) rule.monthDays.append(day);
+        }
+    }
+    return rule;
+}
+
+QString RecurrenceRule::toString() const
+{
+    if (freq == None) return QString();
+    QStringList parts;
+    parts << QString("FREQ=%1").arg(freq == Daily ? "DAILY" : freq == Weekly ? "WEEKLY" : "MONTHLY");
+    if (step > 1) parts << QString("INTERVAL=%1").arg(step);
+    if (!weekDays.isEmpty()) {
+        QStringList days;
+        for (const WeekDay &weekDay : weekDays) {
+            days << (weekDay.ordinal != 0 ? QString::number(weekDay.ordinal) : QString()) + kDayCodes[weekDay.day - 1];
+        }
+        parts << "BYDAY=" + days.join(',');
+    }
+    if (!monthDays.isEmpty()) {
+        QStringList days;
+        for (int day : monthDays) days << QString::number(day);
+        parts << "BYMONTHDAY=" + days.join(',');
+    }
+    if (maxCount > 0) parts << QString("COUNT=%1").arg(maxCount);
+    if (lastDate.isValid()) parts << "UNTIL=" + lastDate.toString("yyyyMMdd");
+    return parts.join(';');
+}
+
+bool RecurrenceRule::matchesPattern(const QDate &date) const
+{
+    if (!isValid() || !date.isValid() || date < start) return false;
+
+    auto matchesMonthDay = [&](const QList<int> &days) {
+        for (int day : days) {
+            const int resolved = day > 0 ? day : date.daysInMonth() + 1 + day;
+            if (date.day() == resolved) return true;
+        }
+        return false;
+    };
+    auto matchesWeekDay = [&](bool useOrdinals) {
+        for (const WeekDay &weekDay : weekDays) {
+            if (weekDay.day != date.dayOfWeek()) continue;
+            if (!useOrdinals || weekDay.ordinal == 0) return true;
+            const int nth = weekDay.ordinal > 0 ? (date.day() - 1) / 7 + 1
+                                                : -((date.daysInMonth() - date.day()) / 7 + 1);
+            if (nth == weekDay.ordinal) return true;
+        }
+        return false;
+    };
+
+    switch (freq) {
+    case Daily:
+        if (start.daysTo(date) % step != 0) return false;
+        if (!weekDays.isEmpty() && !matchesWeekDay(false)) return false;
+        return monthDays.isEmpty() || matchesMonthDay(monthDays);
+    case Weekly:
+        if ((mondayOf(start).daysTo(mondayOf(date)) / 7) % step != 0) return false;
+        if (weekDays.isEmpty()) return date.dayOfWeek() == start.dayOfWeek();
+        return matchesWeekDay(false);
+    case Monthly:
+        if (monthsBetween(start, date) % step != 0) return false;
+        if (weekDays.isEmpty() && monthDays.isEmpty()) return date.day() == start.day();
+        if (!weekDays.isEmpty() && !matchesWeekDay(true)) return false;
+        return monthDays.isEmpty() || matchesMonthDay(monthDays);
+    case None:
+        break;
+    }
+    return false;
+}
+
+void RecurrenceRule::resolveCount()
+{
+    endDate = lastDate;
+    if (maxCount == 0 || !isValid()) return;
+
+    // Walked once here, so COUNT rules answer occursOn() in constant time; a pattern
+    // that stops matching is given up on after a century
+    const QDate limit = lastDate.isValid() ? std::min(lastDate, start.addYears(100)) : start.addYears(100);
+    int matches = 0;
+    QDate day = start;
+    for (; day <= limit; day = day.addDays(1)) {
+        if (matchesPattern(day) && ++matches == maxCount) break;
+    }
+    endDate = std::min(day, limit);
+}
+
+bool RecurrenceRule::occursOn(const QDate &date) const
+{
+    if (endDate.isValid() && date > endDate) return false;
+    return !exceptions.contains(date) && matchesPattern(date);
+}
+
+QList<QDate> RecurrenceRule::occurrences(const QDate &from, const QDate &to) const
+{
+    QList<QDate> result;
+    if (!isValid()) return result;
+    const QDate first = std::max(from, start);
+    const QDate last = endDate.isValid() ? std::min(to, endDate) : to;
+
+    // Excluded dates still use up COUNT, as in RFC 5545; endDate already accounts for that
+    for (QDate day = first; day <= last; day = day.addDays(1)) {
+        if (matchesPattern(day) && !exceptions.contains(day)) result.append(day);
+    }
+    return result;
+}
+
+QSet<QDate> RecurrenceRule::parseDateList(const QString &isoDates)
+{
+    QSet<QDate> dates;
+    for (const QString &item : isoDates.split(',', Qt::SkipEmptyParts)) {
+        const QDate date = QDate::fromString(item.trimmed(), Qt::ISODate);
+        if (date.isValid()) dates.insert(date);
+    }
+    return dates;
+}
+
+QString RecurrenceRule::formatDateList(const QSet<QDate> &dates)
+{
+    QList<QDate> sorted(dates.begin(), dates.end());
+    std::sort(sorted.begin(), sorted.end());
+    QStringList items;
+    for (const QDate &date : sorted) items << date.toString(Qt::ISODate);
+    return items.join(',');
+}
@@ -0,0 +1,70 @@
+#ifndef RECURRENCERULE_H
+#define RECURRENCERULE_H
+
+#include <QDate>
+#include <QString>
+#include <QList>
+#include <QSet>
+
+// Subset of iCalendar RRULE (RFC 5545): FREQ=DAILY|WEEKLY|MONTHLY with INTERVAL,
+// BYDAY (ordinals like 1MO / -1FR for monthly rules), BYMONTHDAY, COUNT and UNTIL,
+// plus exception dates. Occurrences are computed on demand, never materialized.
+class RecurrenceRule
+{
+public:
+    enum Frequency { None, Daily, Weekly, Monthly };
+
+    struct WeekDay {
+        int ordinal = 0; // 0 = every such weekday, n = nth in the month, -n = nth from the end
+        int day = 1;     // 1 = Monday ... 7 = Sunday, as in QDate::dayOfWeek()
+
+        bool operator==(const WeekDay &other) const { return ordinal == other.ordinal && day == other.day; }
+    };
+
+    RecurrenceRule() = default;
+
+    // Accepts "FREQ=WEEKLY;BYDAY=MO,WE", optionally prefixed with "RRULE:"
+    static RecurrenceRule fromString(const QString &rrule, const QDate &start);
+    // Maps the recurrence combo values ("Daily", "Weekly" + "Mon,Wed", "Monthly" + "1,15");
+    // a value that is itself an RRULE wins over the type
+    static RecurrenceRule fromLegacy(const QString &type, const QString &value, const QDate &start);
+
+    QString toString() const;
+    bool isValid() const { return freq != None && start.isValid(); }
+
+    bool occursOn(const QDate &date) const;
+    QList<QDate> occurrences(const QDate &from, const QDate &to) const;
+
+    Frequency frequency() const { return freq; }
+    int interval() const { return step; }
+    int count() const { return maxCount; }
+    QDate until() const { return lastDate; }
+    QDate startDate() const { return start; }
+    const QList<WeekDay> &byDay() const { return weekDays; }
+    const QList<int> &byMonthDay() const { return monthDays; }
+
+    void setExceptions(const QSet<QDate> &dates) { exceptions = dates; }
+    void addException(const QDate &date) { exceptions.insert(date); }
+    const QSet<QDate> &exceptionDates() const { return exceptions; }
+
+    static QSet<QDate> parseDateList(const QString &isoDates);
+    static QString formatDateList(const QSet<QDate> &dates);
+
+private:
+    // Pattern match ignoring COUNT, UNTIL and exceptions
+    bool matchesPattern(const QDate &date) const;
+    // Sets endDate to the earlier of UNTIL and the COUNT-th occurrence
+    void resolveCount();
+
+    Frequency freq = None;
+    int step = 1;
+    int maxCount = 0; // 0 = unbounded
+    QDate lastDate;   // UNTIL, inclusive
+    QDate endDate;    // last possible occurrence under UNTIL and COUNT
+    QDate start;
+    QList<WeekDay> weekDays;
+    QList<int> monthDays;
+    QSet<QDate> exceptions;
+};
+
+#endif // RECURRENCERULE_H
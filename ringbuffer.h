@@ -0,0 +1,71 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QList>
+#include <QtGlobal>
+
+// Fixed-capacity FIFO. append() and removeFirst() are O(1); once full, the
+// oldest element is overwritten.
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int capacity = 0) { setCapacity(capacity); }
+
+    void setCapacity(int capacity)
+    {
+        m_data = QList<T>(qMax(capacity, 0));
+        m_head = 0;
+        m_size = 0;
+    }
+
+    int capacity() const { return m_data.size(); }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    bool isFull() const { return m_size == m_data.size(); }
+    void clear() { m_head = 0; m_size = 0; }
+
+    void append(const T &value)
+    {
+        if (m_data.isEmpty()) return;
+        m_data[(m_head + m_size) % m_data.size()] = value;
+        if (m_size < m_data.size()) {
+            ++m_size;
+        } else {
+            m_head = (m_head + 1) % m_data.size();
+        }
+    }
+
+    void removeFirst()
+    {
+        if (m_size == 0) return;
+        m_head = (m_head + 1) % m_data.size();
+        --m_size;
+    }
+
+    // Index 0 is the oldest element
+    const T &at(int i) const { return m_data.at((m_head + i) % m_data.size()); }
+    const T &first() const { return at(0); }
+    const T &last() const { return at(m_size - 1); }
+    T &last() { return m_data[(m_head + m_size - 1) % m_data.size()]; }
+
+    // Contents in insertion order, copied in at most two contiguous runs
+    QList<T> toList() const
+    {
+        QList<T> result;
+        result.reserve(m_size);
+        const int firstRun = qMin(m_size, m_data.size() - m_head);
+        result.append(m_data.mid(m_head, firstRun));
+        if (firstRun < m_size) {
+            result.append(m_data.mid(0, m_size - firstRun));
+        }
+        return result;
+    }
+
+private:
+    QList<T> m_data;
+    int m_head = 0;
+    int m_size = 0;
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,221 @@
+#include "searchindex.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRegularExpression>
+#include <QDebug>
+
+namespace {
+// Row ids are derived from the source row, id * 8 + kind, so triggers can
+// replace or delete an entry without scanning the index
+const QStringList kTriggers = {
+    "CREATE TRIGGER IF NOT EXISTS search_goals_insert AFTER INSERT ON goals BEGIN "
+    "INSERT INTO search_index(rowid, kind, ref, title, body) VALUES (new.id * 8 + 1, 'goal', new.id, new.subject, coalesce(new.notes, '')); END",
+    "CREATE TRIGGER IF NOT EXISTS search_goals_update AFTER UPDATE OF subject, notes ON goals BEGIN "
+    "DELETE FROM search_index WHERE rowid = old.id * 8 + 1; "
+    "INSERT INTO search_index(rowid, kind, ref, title, body) VALUES (new.id * 8 + 1, 'goal', new.id, new.subject, coalesce(new.notes, '')); END",
+    // Resources are not deleted with their goal, so their entries go here; recreated
+    // because earlier versions only removed the goal's own entry
+    "DROP TRIGGER IF EXISTS search_goals_delete",
+    "CREATE TRIGGER search_goals_delete AFTER DELETE ON goals BEGIN "
+    "DELETE FROM search_index WHERE rowid = old.id * 8 + 1; "
+    "DELETE FROM search_index WHERE rowid IN (SELECT id * 8 + 2 FROM goal_resources WHERE goal_id = old.id); END",
+
+    "CREATE TRIGGER IF NOT EXISTS search_resources_insert AFTER INSERT ON goal_resources BEGIN "
+    "INSERT INTO search_index(rowid, kind, ref, title, body) VALUES (new.id * 8 + 2, 'resource', new.goal_id, new.value, coalesce(new.description, '')); END",
+    "CREATE TRIGGER IF NOT EXISTS search_resources_update AFTER UPDATE OF goal_id, value, description ON goal_resources BEGIN "
+    "DELETE FROM search_index WHERE rowid = old.id * 8 + 2; "
+    "INSERT INTO search_index(rowid, kind, ref, title, body) VALUES (new.id * 8 + 2, 'resource', new.goal_id, new.value, coalesce(new.description, '')); END",
+    "CREATE TRIGGER IF NOT EXISTS search_resources_delete AFTER DELETE ON goal_resources BEGIN "
+    "DELETE FROM search_index WHERE rowid = old.id * 8 + 2; END",
+
+    // Surveys are titled with their goal's subject; only written feedback is indexed
+    "CREATE TRIGGER IF NOT EXISTS search_surveys_insert AFTER INSERT ON surveys BEGIN "
+    "INSERT INTO search_index(rowid, kind, ref, title, body) SELECT new.id * 8 + 3, 'survey', new.id, "
+    "coalesce((SELECT subject FROM goals WHERE id = new.goal_id), ''), new.open_feedback WHERE coalesce(new.open_feedback, '') <> ''; END",
+    "CREATE TRIGGER IF NOT EXISTS search_surveys_update AFTER UPDATE OF goal_id, open_feedback ON surveys BEGIN "
+    "DELETE FROM search_index WHERE rowid = old.id * 8 + 3; "
+    "INSERT INTO search_index(rowid, kind, ref, title, body) SELECT new.id * 8 + 3, 'survey', new.id, "
+    "coalesce((SELECT subject FROM goals WHERE id = new.goal_id), ''), new.open_feedback WHERE coalesce(new.open_feedback, '') <> ''; END",
+    "CREATE TRIGGER IF NOT EXISTS search_surveys_delete AFTER DELETE ON surveys BEGIN "
+    "DELETE FROM search_index WHERE rowid = old.id * 8 + 3; END",
+};
+
+const QStringList kBackfill = {
+    "INSERT INTO search_index(rowid, kind, ref, title, body) SELECT id * 8 + 1, 'goal', id, subject, coalesce(notes, '') FROM goals",
+    "INSERT INTO search_index(rowid, kind, ref, title, body) SELECT id * 8 + 2, 'resource', goal_id, value, coalesce(description, '') FROM goal_resources",
+    "INSERT INTO search_index(rowid, kind, ref, title, body) SELECT s.id * 8 + 3, 'survey', s.id, coalesce(g.subject, ''), s.open_feedback "
+    "FROM surveys s LEFT JOIN goals g ON g.id = s.goal_id WHERE coalesce(s.open_feedback, '') <> ''",
+};
+
+// Conversation ids are strings; each gets a numeric key here, and its entry the
+// negated key as row id, so it never meets the id * 8 + kind range
+const QString kConversationKeys =
+    "CREATE TABLE IF NOT EXISTS search_conversation_keys (id INTEGER PRIMARY KEY, ref TEXT NOT NULL UNIQUE)";
+}
+
+SearchIndex::SearchIndex(QSqlDatabase &database, QObject *parent)
+    : QObject(parent),
+      db(database)
+{
+}
+
+bool SearchIndex::initialize()
+{
+    QSqlQuery query(db);
+    if (!query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'search_index'")) {
+        qDebug() << "Error checking search index:" << query.lastError().text();
+        return false;
+    }
+    const bool exists = query.next();
+
+    if (!exists && !query.exec("CREATE VIRTUAL TABLE search_index USING fts5(kind UNINDEXED, ref UNINDEXED, title, body, "
+                               "tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3')")) {
+        qDebug() << "Full-text search unavailable:" << query.lastError().text();
+        return false;
+    }
+
+    db.transaction();
+    QStringList statements = kTriggers;
+    statements.prepend(kConversationKeys);
+    if (!exists) statements += kBackfill;
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error setting up search index:" << query.lastError().text();
+            qDebug() << "Query was:" << statement;
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        qDebug() << "Error committing search index:" << db.lastError().text();
+        return false;
+    }
+    available = true;
+    return true;
+}
+
+QString SearchIndex::matchExpression(const QString &text)
+{
+    static const QRegularExpression separators("[^\\w]+", QRegularExpression::UseUnicodePropertiesOption);
+    QStringList terms;
+    for (const QString &word : text.split(separators, Qt::SkipEmptyParts)) {
+        terms << QString("\"%1\"*").arg(word);
+    }
+    return terms.join(' ');
+}
+
+QList<SearchHit> SearchIndex::search(const QString &text, int limit, const QStringList &kinds) const
+{
+    QList<SearchHit> hits;
+    const QString expression = matchExpression(text);
+    if (!available || expression.isEmpty()) return hits;
+
+    // Title matches weigh more than body matches
+    QString sql = "SELECT kind, ref, title, snippet(search_index, 3, '[', ']', '...', 12), "
+                  "bm25(search_index, 0.0, 0.0, 4.0, 1.0) AS score "
+                  "FROM search_index WHERE search_index MATCH ?";
+    if (!kinds.isEmpty()) {
+        sql += QString(" AND kind IN (%1)").arg(QStringList(kinds.size(), "?").join(", "));
+    }
+    sql += " ORDER BY score LIMIT ?";
+
+    QSqlQuery query(db);
+    query.prepare(sql);
+    query.addBindValue(expression);
+    for (const QString &kind : kinds) query.addBindValue(kind);
+    query.addBindValue(limit);
+    if (!query.exec()) {
+        qDebug() << "Error searching:" << query.lastError().text();
+        return hits;
+    }
+    while (query.next()) {
+        SearchHit hit;
+        hit.kind = query.value(0).toString();
+        hit.ref = query.value(1).toString();
+        hit.title = query.value(2).toString();
+        hit.snippet = query.value(3).toString();
+        hit.score = query.value(4).toDouble();
+        hits.append(hit);
+    }
+    return hits;
+}
+
+qint64 SearchIndex::conversationRowId(const QString &conversationId)
+{
+    auto cached = conversationRowIds.constFind(conversationId);
+    if (cached != conversationRowIds.constEnd()) return *cached;
+
+    QSqlQuery query(db);
+    query.prepare("INSERT OR IGNORE INTO search_conversation_keys (ref) VALUES (?)");
+    query.addBindValue(conversationId);
+    QSqlQuery key(db);
+    key.prepare("SELECT id FROM search_conversation_keys WHERE ref = ?");
+    key.addBindValue(conversationId);
+    if (!query.exec() || !key.exec() || !key.next()) {
+        qDebug() << "Error keying conversation" << conversationId << ":" << query.lastError().text() << key.lastError().text();
+        return 0;
+    }
+    const qint64 rowId = -key.value(0).toLongLong();
+    conversationRowIds.insert(conversationId, rowId);
+    return rowId;
+}
+
+bool SearchIndex::syncConversations(const QList<Document> &conversations)
+{
+    if (!available) return false;
+
+    db.transaction();
+    QSqlQuery query(db);
+    // Entries from an earlier run may be stale; start from scratch once per run
+    if (!conversationsLoaded && !query.exec("DELETE FROM search_index WHERE kind = 'chat'")) {
+        qDebug() << "Error clearing conversation index:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    QHash<QString, size_t> indexed;
+    QSqlQuery remove(db);
+    remove.prepare("DELETE FROM search_index WHERE rowid = ?");
+    QSqlQuery insert(db);
+    insert.prepare("INSERT INTO search_index(rowid, kind, ref, title, body) VALUES (?, 'chat', ?, ?, ?)");
+    for (const Document &conversation : conversations) {
+        const size_t digest = qHash(conversation.title) ^ (qHash(conversation.body) * 31);
+        indexed.insert(conversation.ref, digest);
+        auto previous = indexedConversations.constFind(conversation.ref);
+        if (conversationsLoaded && previous != indexedConversations.constEnd() && *previous == digest) continue;
+
+        const qint64 rowId = conversationRowId(conversation.ref);
+        if (rowId == 0) {
+            db.rollback();
+            return false;
+        }
+        remove.addBindValue(rowId);
+        insert.addBindValue(rowId);
+        insert.addBindValue(conversation.ref);
+        insert.addBindValue(conversation.title);
+        insert.addBindValue(conversation.body);
+        if (!remove.exec() || !insert.exec()) {
+            qDebug() << "Error indexing conversation:" << remove.lastError().text() << insert.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    QSqlQuery forget(db);
+    forget.prepare("DELETE FROM search_conversation_keys WHERE ref = ?");
+    for (auto it = indexedConversations.constBegin(); it != indexedConversations.constEnd(); ++it) {
+        if (indexed.contains(it.key())) continue;
+        remove.addBindValue(conversationRowId(it.key()));
+        remove.exec();
+        forget.addBindValue(it.key());
+        forget.exec();
+        conversationRowIds.remove(it.key());
+    }
+
+    if (!db.commit()) {
+        qDebug() << "Error committing conversation index:" << db.lastError().text();
+        return false;
+    }
+    indexedConversations = indexed;
+    conversationsLoaded = true;
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+struct SearchHit {
+    QString kind;    // "goal", "resource", "survey" or "chat"
+    QString ref;     // goal id for goals and resources, survey id, conversation id
+    QString title;
+    QString snippet; // matched text with the hits in [brackets]
+    double score = 0.0; // bm25, lower is better
+};
+
+// SQLite FTS5 index over goal subjects and notes, resources, survey feedback and
+// Buddy conversations. Database rows are kept in sync by triggers; conversations
+// live in a JSON file and are synced explicitly.
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SearchIndex(QSqlDatabase &database, QObject *parent = nullptr);
+
+    // Creates the index and its triggers, filling it from existing rows the first
+    // time; returns false when the SQLite build has no FTS5
+    bool initialize();
+    bool isAvailable() const { return available; }
+
+    // Every word is a prefix match, so partial input already ranks results
+    QList<SearchHit> search(const QString &text, int limit = 20, const QStringList &kinds = QStringList()) const;
+
+    struct Document {
+        QString ref;
+        QString title;
+        QString body;
+    };
+    // Re-indexes changed conversations and drops the ones that are gone
+    bool syncConversations(const QList<Document> &conversations);
+
+    static QString matchExpression(const QString &text);
+
+private:
+    // Negative row id of a conversation's entry, from its key in search_conversation_keys; 0 on error
+    qint64 conversationRowId(const QString &conversationId);
+
+    QSqlDatabase &db;
+    bool available = false;
+    QHash<QString, size_t> indexedConversations; // conversation id -> digest of what is indexed
+    bool conversationsLoaded = false;
+    QHash<QString, qint64> conversationRowIds;
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,178 @@
+#include "statistics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Statistics {
+
+namespace {
+const std::size_t kLanes = 8;
+const std::size_t kBlockSize = 4096;
+
+// Sums term(i) for i in [0, n) using independent accumulators per lane
+template <typename Term>
+double laneSum(std::size_t n, Term term)
+{
+    double acc[kLanes] = {};
+    std::size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            acc[lane] += term(i + lane);
+        }
+    }
+    double total = 0.0;
+    for (; i < n; ++i) {
+        total += term(i);
+    }
+    for (double a : acc) {
+        total += a;
+    }
+    return total;
+}
+
+double interpolate(const std::vector<float> &sorted, double q)
+{
+    const double pos = std::clamp(q, 0.0, 1.0) * (sorted.size() - 1);
+    const std::size_t lower = static_cast<std::size_t>(pos);
+    const std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+    const double frac = pos - lower;
+    return sorted[lower] + (double(sorted[upper]) - sorted[lower]) * frac;
+}
+}
+
+double sum(std::span<const float> data)
+{
+    const float *p = data.data();
+    return laneSum(data.size(), [p](std::size_t i) { return double(p[i]); });
+}
+
+double mean(std::span<const float> data)
+{
+    return data.empty() ? 0.0 : sum(data) / data.size();
+}
+
+Moments merge(const Moments &a, const Moments &b)
+{
+    if (a.count == 0) return b;
+    if (b.count == 0) return a;
+    Moments result;
+    result.count = a.count + b.count;
+    const double delta = b.mean - a.mean;
+    result.mean = a.mean + delta * b.count / result.count;
+    result.m2 = a.m2 + b.m2 + delta * delta * (double(a.count) * b.count / result.count);
+    return result;
+}
+
+Moments moments(std::span<const float> data)
+{
+    // Two vectorizable passes per cache-sized block, blocks combined with Chan's update
+    Moments total;
+    for (std::size_t start = 0; start < data.size(); start += kBlockSize) {
+        std::span<const float> block = data.subspan(start, std::min(kBlockSize, data.size() - start));
+        const float *p = block.data();
+        Moments part;
+        part.count = block.size();
+        part.mean = sum(block) / part.count;
+        const double m = part.mean;
+        part.m2 = laneSum(block.size(), [p, m](std::size_t i) {
+            const double d = p[i] - m;
+            return d * d;
+        });
+        total = merge(total, part);
+    }
+    return total;
+}
+
+std::vector<float> movingAverage(std::span<const float> data, std::size_t window)
+{
+    std::vector<float> result;
+    if (window == 0 || data.size() < window) return result;
+
+    // Prefix sums turn every window into a single subtraction
+    std::vector<double> prefix(data.size() + 1);
+    prefix[0] = 0.0;
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        prefix[i + 1] = prefix[i] + data[i];
+    }
+
+    const std::size_t count = data.size() - window + 1;
+    result.resize(count);
+    const double inv = 1.0 / window;
+    for (std::size_t i = 0; i < count; ++i) {
+        result[i] = float((prefix[i + window] - prefix[i]) * inv);
+    }
+    return result;
+}
+
+double correlation(std::span<const float> x, std::span<const float> y)
+{
+    if (x.size() != y.size() || x.empty()) return 0.0;
+
+    const float *px = x.data();
+    const float *py = y.data();
+    const double mx = mean(x);
+    const double my = mean(y);
+    const std::size_t n = x.size();
+
+    // Two passes: the means above, then the centered sums together; centering first
+    // keeps the sums accurate for scores that sit far from zero
+    double accXY[kLanes] = {}, accXX[kLanes] = {}, accYY[kLanes] = {};
+    std::size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            const double dx = px[i + lane] - mx;
+            const double dy = py[i + lane] - my;
+            accXY[lane] += dx * dy;
+            accXX[lane] += dx * dx;
+            accYY[lane] += dy * dy;
+        }
+    }
+    double sxy = 0.0, sxx = 0.0, syy = 0.0;
+    for (; i < n; ++i) {
+        const double dx = px[i] - mx;
+        const double dy = py[i] - my;
+        sxy += dx * dy;
+        sxx += dx * dx;
+        syy += dy * dy;
+    }
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+        sxy += accXY[lane];
+        sxx += accXX[lane];
+        syy += accYY[lane];
+    }
+
+    const double denominator = std::sqrt(sxx * syy);
+    return denominator > 0.0 ? sxy / denominator : 0.0;
+}
+
+double quantile(std::span<const float> data, double q)
+{
+    if (data.empty()) return 0.0;
+    std::vector<float> values(data.begin(), data.end());
+    const double pos = std::clamp(q, 0.0, 1.0) * (values.size() - 1);
+    const std::size_t lower = static_cast<std::size_t>(pos);
+
+    // Only the two neighbouring order statistics are needed, not a full sort
+    std::nth_element(values.begin(), values.begin() + lower, values.end());
+    const double lowerValue = values[lower];
+    if (lower + 1 >= values.size()) return lowerValue;
+    const double upperValue = *std::min_element(values.begin() + lower + 1, values.end());
+    return lowerValue + (upperValue - lowerValue) * (pos - lower);
+}
+
+std::vector<double> quantiles(std::span<const float> data, std::span<const double> qs)
+{
+    std::vector<double> result;
+    result.reserve(qs.size());
+    if (data.empty()) {
+        result.assign(qs.size(), 0.0);
+        return result;
+    }
+    std::vector<float> sorted(data.begin(), data.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (double q : qs) {
+        result.push_back(interpolate(sorted, q));
+    }
+    return result;
+}
+
+}
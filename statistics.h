@@ -0,0 +1,41 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Numeric kernels over contiguous float samples. Accumulation is done in
+// double, and the hot loops are written as independent lanes so the
+// compiler can vectorize them without -ffast-math.
+namespace Statistics {
+
+struct Moments {
+    std::size_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0; // sum of squared deviations from the mean
+
+    double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+    double populationVariance() const { return count > 0 ? m2 / count : 0.0; }
+};
+
+double sum(std::span<const float> data);
+double mean(std::span<const float> data);
+
+// Welford/Chan variance, computed block-wise and merged
+Moments moments(std::span<const float> data);
+Moments merge(const Moments &a, const Moments &b);
+
+// Averages of every full window, O(n) regardless of the window size
+std::vector<float> movingAverage(std::span<const float> data, std::size_t window);
+
+// Pearson correlation; 0 when the inputs differ in length or either is constant
+double correlation(std::span<const float> x, std::span<const float> y);
+
+// Linearly interpolated quantile, q in [0, 1]
+double quantile(std::span<const float> data, double q);
+std::vector<double> quantiles(std::span<const float> data, std::span<const double> qs);
+
+}
+
+#endif // STATISTICS_H
@@ -19,86 +19,88 @@ StudyStreak::~StudyStreak()
 bool StudyStreak::initializeStreaks()
 {
     QSqlQuery query(db);
-    
-    // Get the last study date and streak count
-    query.exec("SELECT date, streak_count FROM study_streaks ORDER BY date DESC LIMIT 1");
-    if (query.next()) {
-        lastStudyDate = QDate::fromString(query.value("date").toString(), "yyyy-MM-dd");
-        currentStreak = query.value("streak_count").toInt();
+    if (!query.exec("SELECT date, study_minutes FROM study_streaks ORDER BY date")) {
+        qDebug() << "Error loading study days:" << query.lastError().text();
+        return false;
     }
 
-    // Get the longest streak
-    query.exec("SELECT MAX(streak_count) as longest FROM study_streaks");
-    if (query.next()) {
-        longestStreak = query.value("longest").toInt();
+    // Streaks are derived from the days themselves rather than the stored
+    // streak_count, so backfilled days and clock changes can't skew them
+    days.clear();
+    while (query.next()) {
+        days.addMinutes(QDate::fromString(query.value(0).toString(), "yyyy-MM-dd"), query.value(1).toInt());
     }
-
+    engine.recompute(days, QDate::currentDate());
+    refreshStreaks(QDate::currentDate());
     return true;
 }
 
-bool StudyStreak::recordStudySession(int minutes)
+void StudyStreak::refreshStreaks(const QDate &changed)
 {
-    QDate today = QDate::currentDate();
-    QSqlQuery query(db);
-    QString currentTime = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    const QDate today = QDate::currentDate();
+    engine.update(days, changed, today);
+    currentStreak = engine.currentStreak(days, today);
+    longestStreak = engine.longestStreak();
+    lastStudyDate = days.lastStudyDay();
+}
 
-    query.prepare("SELECT study_minutes FROM study_streaks WHERE date = ?");
-    query.addBindValue(today.toString("yyyy-MM-dd"));
-    
-    if (query.exec() && query.next()) {
-        // Update existing record
-        int currentMinutes = query.value(0).toInt();
-        query.prepare("UPDATE study_streaks SET study_minutes = ? WHERE date = ?");
-        query.addBindValue(currentMinutes + minutes);
-        query.addBindValue(today.toString("yyyy-MM-dd"));
-    } else {
-        // Insert new record
-        query.prepare("INSERT INTO study_streaks (date, study_minutes, streak_count, created_at) "
-                     "VALUES (?, ?, ?, ?)");
-        query.addBindValue(today.toString("yyyy-MM-dd"));
-        query.addBindValue(minutes);
-        query.addBindValue(currentStreak + 1);
-        query.addBindValue(currentTime);
+void StudyStreak::setRules(const StreakRules &rules)
+{
+    if (rules == engine.rules()) return;
+    const int previousStreak = currentStreak;
+    engine.setRules(rules);
+    engine.recompute(days, QDate::currentDate());
+    refreshStreaks(QDate::currentDate());
+    // A rule change isn't an achievement, so no milestones or broken streak here
+    if (currentStreak != previousStreak) {
+        emit streakUpdated(currentStreak);
+    }
+}
+
+void StudyStreak::reportStreakChange(int previousStreak)
+{
+    if (currentStreak == previousStreak) return;
+    if (currentStreak < previousStreak) {
+        emit streakBroken();
+    }
+    emit streakUpdated(currentStreak);
+    if (previousStreak > 0) {
+        checkMilestones(previousStreak);
     }
+}
 
+bool StudyStreak::recordStudySession(int minutes)
+{
+    const QDate today = QDate::currentDate();
+
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO study_streaks (date, study_minutes, streak_count, created_at) VALUES (?, ?, ?, ?) "
+                  "ON CONFLICT(date) DO UPDATE SET study_minutes = study_minutes + excluded.study_minutes, "
+                  "streak_count = excluded.streak_count");
+    query.addBindValue(today.toString("yyyy-MM-dd"));
+    query.addBindValue(minutes);
+    query.addBindValue(engine.streakWith(today, days.minutesOn(today) + minutes));
+    query.addBindValue(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"));
     if (!query.exec()) {
         qDebug() << "Error recording study session:" << query.lastError().text();
         return false;
     }
 
+    const int previousStreak = currentStreak;
+    days.addMinutes(today, minutes);
+    refreshStreaks(today);
     emit studyTimeUpdated(minutes);
-    return checkAndUpdateStreak();
+    reportStreakChange(previousStreak);
+    return true;
 }
 
 bool StudyStreak::checkAndUpdateStreak()
 {
-    QDate today = QDate::currentDate();
-    
-    if (lastStudyDate.addDays(1) == today) {
-        currentStreak++;
-        if (currentStreak > longestStreak) {
-            longestStreak = currentStreak;
-        }
-        updateStreakCount();
-        checkMilestones();
-        emit streakUpdated(currentStreak);
-        return true;
-    }
-    else if (lastStudyDate.addDays(1) < today) {
-        if (currentStreak > 0) {
-            emit streakBroken();
-        }
-        currentStreak = 1;
-        updateStreakCount();
-        emit streakUpdated(currentStreak);
-        return true;
-    }
-    else if (lastStudyDate == today) {
-        updateStreakCount();
-        return true;
-    }
-
-    return false;
+    // Extends the history to today and reports a change; MainWindow calls it after midnight
+    const int previousStreak = currentStreak;
+    refreshStreaks(QDate::currentDate());
+    reportStreakChange(previousStreak);
+    return currentStreak != previousStreak;
 }
 
 int StudyStreak::getCurrentStreak() const
@@ -113,13 +115,7 @@ int StudyStreak::getLongestStreak() const
 
 int StudyStreak::getTotalStudyDays() const
 {
-    QSqlQuery query(db);
-    query.exec("SELECT COUNT(DISTINCT date) as total FROM study_streaks");
-    
-    if (query.next()) {
-        return query.value("total").toInt();
-    }
-    return 0;
+    return days.totalStudyDays();
 }
 
 QDate StudyStreak::getLastStudyDate() const
@@ -127,47 +123,44 @@ QDate StudyStreak::getLastStudyDate() const
     return lastStudyDate;
 }
 
+QDate StudyStreak::getFirstStudyDate() const
+{
+    return days.firstStudyDay();
+}
+
+int StudyStreak::getStreakOn(const QDate &date) const
+{
+    return engine.streakOn(date);
+}
+
 QMap<QDate, int> StudyStreak::getStudyHistory(const QDate &startDate, const QDate &endDate)
 {
     QMap<QDate, int> history;
-    QSqlQuery query(db);
-    
-    query.prepare("SELECT date, study_minutes FROM study_streaks "
-                 "WHERE date BETWEEN ? AND ? ORDER BY date");
-    query.addBindValue(startDate.toString("yyyy-MM-dd"));
-    query.addBindValue(endDate.toString("yyyy-MM-dd"));
-    
-    if (query.exec()) {
-        while (query.next()) {
-            QDate date = QDate::fromString(query.value("date").toString(), "yyyy-MM-dd");
-            int minutes = query.value("study_minutes").toInt();
-            history[date] = minutes;
-        }
-    }
-    
+    days.forEachStudyDay(startDate, endDate, [&history](const QDate &date, int minutes) {
+        history.insert(history.cend(), date, minutes);
+    });
     return history;
 }
 
 int StudyStreak::getAverageStudyTime() const
 {
-    QSqlQuery query(db);
-    query.exec("SELECT AVG(study_minutes) as average FROM study_streaks");
-    
-    if (query.next()) {
-        return query.value("average").toInt();
-    }
-    return 0;
+    const int studyDays = days.totalStudyDays();
+    return studyDays > 0 ? int(days.totalMinutes() / studyDays) : 0;
 }
 
 int StudyStreak::getTotalStudyTime() const
 {
-    QSqlQuery query(db);
-    query.exec("SELECT SUM(study_minutes) as total FROM study_streaks");
-    
-    if (query.next()) {
-        return query.value("total").toInt();
-    }
-    return 0;
+    return int(days.totalMinutes());
+}
+
+int StudyStreak::getStudyMinutesBetween(const QDate &startDate, const QDate &endDate) const
+{
+    return int(days.minutesBetween(startDate, endDate));
+}
+
+int StudyStreak::getStudyDaysBetween(const QDate &startDate, const QDate &endDate) const
+{
+    return days.studyDaysBetween(startDate, endDate);
 }
 
 bool StudyStreak::hasReachedMilestone(int days) const
@@ -203,25 +196,14 @@ QList<int> StudyStreak::getUpcomingMilestones() const
     return upcoming;
 }
 
-bool StudyStreak::updateStreakCount()
-{
-    QSqlQuery query(db);
-    QString today = QDate::currentDate().toString("yyyy-MM-dd");
-    
-    query.prepare("UPDATE study_streaks SET streak_count = ? WHERE date = ?");
-    query.addBindValue(currentStreak);
-    query.addBindValue(today);
-    
-    return query.exec();
-}
-
-bool StudyStreak::checkMilestones()
+bool StudyStreak::checkMilestones(int previousStreak)
 {
     QList<int> milestones = getMilestones();
     QList<int> newMilestones;
-    
+
+    // Every milestone passed since the streak was last reported
     for (int milestone : milestones) {
-        if (currentStreak == milestone) {
+        if (milestone > previousStreak && milestone <= currentStreak) {
             newMilestones.append(milestone);
         }
     }
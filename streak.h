@@ -7,6 +7,8 @@
 #include <QDateTime>
 #include <QString>
 #include <QMap>
+#include "dayindex.h"
+#include "streakengine.h"
 
 class StudyStreak : public QObject
 {
@@ -20,17 +22,26 @@ public:
     bool initializeStreaks();
     bool recordStudySession(int minutes);
     bool checkAndUpdateStreak();
+
+    // Minimum minutes, grace days and rest days; streaks are recomputed on change
+    void setRules(const StreakRules &rules);
+    StreakRules rules() const { return engine.rules(); }
     
     // Streak Information
     int getCurrentStreak() const;
     int getLongestStreak() const;
     int getTotalStudyDays() const;
     QDate getLastStudyDate() const;
+    QDate getFirstStudyDate() const;
+    // Streak as of the end of a past day, under the current rules
+    int getStreakOn(const QDate &date) const;
     
-    // Statistics
+    // Statistics, answered from the in-memory day index
     QMap<QDate, int> getStudyHistory(const QDate &startDate, const QDate &endDate);
     int getAverageStudyTime() const;
     int getTotalStudyTime() const;
+    int getStudyMinutesBetween(const QDate &startDate, const QDate &endDate) const;
+    int getStudyDaysBetween(const QDate &startDate, const QDate &endDate) const;
     
     // Milestones
     bool hasReachedMilestone(int days) const;
@@ -45,12 +56,16 @@ signals:
 
 private:
     QSqlDatabase& db;
+    DayIndex days;
+    StreakEngine engine;
+    // Derived from days; kept to notice when a streak grows or breaks
     int currentStreak;
     int longestStreak;
     QDate lastStudyDate;
-    
-    bool updateStreakCount();
-    bool checkMilestones();
+
+    void refreshStreaks(const QDate &changed);
+    void reportStreakChange(int previousStreak);
+    bool checkMilestones(int previousStreak);
     void emitMilestoneSignals(const QList<int> &newMilestones);
     QList<int> getMilestones() const;
 };
@@ -0,0 +1,77 @@
+#include "streakengine.h"
+
+StreakEngine::DayState StreakEngine::step(DayState state, int dayOfWeek, int minutes) const
+{
+    if (minutes > 0 && minutes >= streakRules.minMinutes) {
+        state.run++;
+        state.missed = 0;
+    } else if (state.run > 0 && !streakRules.isRestDay(dayOfWeek)) {
+        if (++state.missed > streakRules.graceDays) {
+            state.run = 0;
+            state.missed = 0;
+        }
+    }
+    state.longest = qMax(state.longest, state.run);
+    return state;
+}
+
+StreakEngine::DayState StreakEngine::stateBefore(const QDate &date) const
+{
+    if (states.empty() || !date.isValid()) return DayState();
+    const qint64 offset = origin.daysTo(date);
+    if (offset <= 0) return DayState();
+    return states[qMin<qint64>(offset, states.size()) - 1];
+}
+
+void StreakEngine::recompute(const DayIndex &days, const QDate &through)
+{
+    states.clear();
+    origin = days.firstStudyDay();
+    update(days, origin, through);
+}
+
+void StreakEngine::update(const DayIndex &days, const QDate &changed, const QDate &through)
+{
+    const QDate first = days.firstStudyDay();
+    if (!first.isValid()) {
+        states.clear();
+        origin = QDate();
+        return;
+    }
+    // A day before the history began moves the origin; start over
+    if (states.empty() || first < origin) {
+        states.clear();
+        origin = first;
+    }
+
+    const qint64 end = origin.daysTo(qMax(through, days.lastStudyDay())) + 1;
+    const qint64 start = qBound<qint64>(0, changed.isValid() ? origin.daysTo(changed) : 0, qint64(states.size()));
+    states.resize(end);
+
+    DayState state = start > 0 ? states[start - 1] : DayState();
+    QDate date = origin.addDays(start);
+    int dayOfWeek = date.dayOfWeek();
+    for (qint64 i = start; i < end; ++i) {
+        state = step(state, dayOfWeek, days.minutesOn(date));
+        states[i] = state;
+        date = date.addDays(1);
+        dayOfWeek = dayOfWeek % 7 + 1;
+    }
+}
+
+int StreakEngine::streakOn(const QDate &date) const
+{
+    return stateBefore(date.addDays(1)).run;
+}
+
+int StreakEngine::currentStreak(const DayIndex &days, const QDate &today) const
+{
+    const int minutes = days.minutesOn(today);
+    if (minutes > 0 && minutes >= streakRules.minMinutes) return streakOn(today);
+    return streakOn(today.addDays(-1));
+}
+
+int StreakEngine::streakWith(const QDate &date, int minutes) const
+{
+    return step(stateBefore(date), date.dayOfWeek(), minutes).run;
+}
@@ -0,0 +1,55 @@
+#ifndef STREAKENGINE_H
+#define STREAKENGINE_H
+
+#include <QDate>
+#include <vector>
+#include "dayindex.h"
+
+struct StreakRules {
+    int minMinutes = 1;  // a day counts once it has this much study time
+    int graceDays = 0;   // missed days in a row that don't break a streak
+    int restDays = 0;    // bit (dayOfWeek - 1) set: the day neither counts nor breaks
+
+    static const int Weekends = (1 << 5) | (1 << 6);
+
+    bool isRestDay(int dayOfWeek) const { return restDays & (1 << (dayOfWeek - 1)); }
+    bool operator==(const StreakRules &other) const = default;
+};
+
+// Streaks recomputed from the per-day history under a set of rules. Every day from
+// the first study day on keeps the state after it, so a change on one day only
+// recomputes the days from there to the end.
+class StreakEngine
+{
+public:
+    const StreakRules &rules() const { return streakRules; }
+    // Takes effect with the next recompute()
+    void setRules(const StreakRules &rules) { streakRules = rules; }
+
+    void recompute(const DayIndex &days, const QDate &through);
+    // Days before changed keep their state; extends the history up to through
+    void update(const DayIndex &days, const QDate &changed, const QDate &through);
+
+    // Streak as of the end of date
+    int streakOn(const QDate &date) const;
+    // Today only counts once it qualifies; until then yesterday's streak holds
+    int currentStreak(const DayIndex &days, const QDate &today) const;
+    // Streak that date would have with the given study time
+    int streakWith(const QDate &date, int minutes) const;
+    int longestStreak() const { return states.empty() ? 0 : states.back().longest; }
+
+private:
+    struct DayState {
+        int run = 0;     // counted days in the streak
+        int missed = 0;  // missed days since the last counted one
+        int longest = 0; // longest run up to and including this day
+    };
+    DayState stateBefore(const QDate &date) const;
+    DayState step(DayState state, int dayOfWeek, int minutes) const;
+
+    StreakRules streakRules;
+    QDate origin;                 // first study day; states[i] is origin + i
+    std::vector<DayState> states;
+};
+
+#endif // STREAKENGINE_H
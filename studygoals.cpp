@@ -4,10 +4,56 @@
 #include <QSqlRecord>
 #include <QMessageBox>
 #include <QCoreApplication>
+#include <algorithm>
+
+namespace {
+bool isGoalOnDate(const GoalInfo &goal, const QString &isoDate)
+{
+    return goal.status == "Active" && goal.startDate <= isoDate
+           && (goal.dueDate.isNull() || goal.dueDate >= isoDate);
+}
+
+bool isRecurring(const GoalInfo &goal)
+{
+    return !goal.recurrenceType.isEmpty() && goal.recurrenceType != "None";
+}
+
+// Days up to last_generated_date were materialized by the old eager generator;
+// occurrences are only expanded after it
+QDate firstLazyDate(const GoalInfo &goal)
+{
+    return goal.lastGeneratedDate.isValid() ? goal.lastGeneratedDate.addDays(1)
+                                            : QDate::fromString(goal.startDate, Qt::ISODate);
+}
+
+// What a goal itself adds to its own and its ancestors' rollups
+GoalRollup ownShare(const GoalInfo &goal)
+{
+    GoalRollup share;
+    share.targetMinutes = goal.targetMinutes;
+    share.completedMinutes = std::min(goal.completedMinutes, goal.targetMinutes);
+    share.goalCount = 1;
+    return share;
+}
+
+void appendUnique(QList<int> &ids, int goalId)
+{
+    if (!ids.contains(goalId)) ids.append(goalId);
+}
+
+// Saved goals first, by id, then unsaved occurrences in the order they were handed out
+bool goalOrder(const GoalInfo &a, const GoalInfo &b)
+{
+    if ((a.id < 0) != (b.id < 0)) return a.id >= 0;
+    return a.id >= 0 ? a.id < b.id : a.id > b.id;
+}
+}
 
 StudyGoal::StudyGoal(QSqlDatabase& db, QObject *parent)
-    : QObject(parent), db(db), m_currentTrackingGoalId(-1), m_pomodoroTimer(nullptr)
+    : QObject(parent), db(db), m_currentTrackingGoalId(-1),
+      m_trackedCompletedMinutes(0), m_trackedTargetMinutes(0), m_pomodoroTimer(nullptr)
 {
+    loadGoals();
 }
 
 StudyGoal::~StudyGoal()
@@ -19,6 +65,160 @@ StudyGoal::~StudyGoal()
     }
 }
 
+bool StudyGoal::loadGoals()
+{
+    m_goals.clear();
+    m_goalsByDueDate.clear();
+    m_openEndedGoals.clear();
+    m_rules.clear();
+    m_savedOccurrences.clear();
+    m_prerequisites.clear();
+    m_hierarchyLoaded = false;
+    if (!db.isOpen()) {
+        qDebug() << "Error: Database not open for loading goals.";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT id, subject, target_minutes, completed_minutes, start_date, due_date, status, notes, recurrence_type, recurrence_value, last_generated_date, category, rrule, exdates, parent_goal_id, occurrence_date, part_of_goal_id FROM goals")) {
+        qDebug() << "Error loading goals:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        GoalInfo goal;
+        goal.id = query.value(0).toInt();
+        goal.subject = query.value(1).toString();
+        goal.targetMinutes = query.value(2).toInt();
+        goal.completedMinutes = query.value(3).toInt();
+        goal.startDate = query.value(4).toString();
+        goal.dueDate = query.value(5).toString();
+        goal.status = query.value(6).toString();
+        goal.notes = query.value(7).toString();
+        goal.recurrenceType = query.value(8).toString();
+        goal.recurrenceValue = query.value(9).toString();
+        goal.lastGeneratedDate = QDate::fromString(query.value(10).toString(), Qt::ISODate);
+        goal.category = query.value(11).toString();
+        goal.rrule = query.value(12).toString();
+        goal.exceptionDates = query.value(13).toString();
+        goal.parentGoalId = query.value(14).isNull() ? -1 : query.value(14).toInt();
+        goal.occurrenceDate = query.value(15).toString();
+        goal.partOfGoalId = query.value(16).isNull() ? -1 : query.value(16).toInt();
+        indexGoal(goal);
+    }
+
+    // All resources in one pass instead of one query per goal
+    QSqlQuery resQuery(db);
+    if (!resQuery.exec("SELECT goal_id, value FROM goal_resources ORDER BY id")) {
+        qDebug() << "Error loading goal resources:" << resQuery.lastError().text();
+        return false;
+    }
+    while (resQuery.next()) {
+        auto it = m_goals.find(resQuery.value(0).toInt());
+        if (it != m_goals.end()) {
+            it->resources.append(resQuery.value(1).toString());
+        }
+    }
+
+    QSqlQuery prerequisiteQuery(db);
+    if (!prerequisiteQuery.exec("SELECT goal_id, prerequisite_id FROM goal_prerequisites ORDER BY id")) {
+        qDebug() << "Error loading goal prerequisites:" << prerequisiteQuery.lastError().text();
+        return false;
+    }
+    while (prerequisiteQuery.next()) {
+        const int goalId = prerequisiteQuery.value(0).toInt();
+        const int prerequisiteId = prerequisiteQuery.value(1).toInt();
+        if (m_goals.contains(goalId) && m_goals.contains(prerequisiteId)) {
+            m_prerequisites[goalId].append(prerequisiteId);
+        }
+    }
+    rebuildHierarchy();
+    return true;
+}
+
+bool StudyGoal::reloadGoals()
+{
+    const QList<int> before = m_goals.keys();
+    const bool ok = loadGoals();
+    refreshTrackingState();
+
+    GoalDelta delta;
+    for (int goalId : before) {
+        if (m_goals.contains(goalId)) {
+            delta.updated.append(goalId);
+        } else {
+            delta.removed.append(goalId);
+        }
+    }
+    const QSet<int> known(before.begin(), before.end());
+    for (auto it = m_goals.constBegin(); it != m_goals.constEnd(); ++it) {
+        if (!known.contains(it.key())) delta.added.append(it.key());
+    }
+    std::sort(delta.added.begin(), delta.added.end());
+    std::sort(delta.updated.begin(), delta.updated.end());
+    std::sort(delta.removed.begin(), delta.removed.end());
+    emit goalsChanged(delta);
+    return ok;
+}
+
+void StudyGoal::indexGoal(const GoalInfo &goal)
+{
+    GoalRollup before;
+    auto previous = m_goals.constFind(goal.id);
+    const bool known = previous != m_goals.constEnd();
+    if (known) {
+        before = ownShare(*previous);
+        clearIndexes(*previous);
+    }
+    m_goals.insert(goal.id, goal);
+    if (goal.dueDate.isNull()) {
+        m_openEndedGoals.insert(goal.id);
+    } else {
+        m_goalsByDueDate.insert(goal.dueDate, goal.id);
+    }
+    if (isRecurring(goal)) {
+        const QDate start = QDate::fromString(goal.startDate, Qt::ISODate);
+        RecurrenceRule rule = goal.rrule.isEmpty()
+            ? RecurrenceRule::fromLegacy(goal.recurrenceType, goal.recurrenceValue, start)
+            : RecurrenceRule::fromString(goal.rrule, start);
+        rule.setExceptions(RecurrenceRule::parseDateList(goal.exceptionDates));
+        if (rule.isValid()) m_rules.insert(goal.id, rule);
+    }
+    if (goal.parentGoalId > 0) {
+        m_savedOccurrences.insert(qMakePair(goal.parentGoalId, goal.occurrenceDate));
+    }
+
+    // Only the goal's own share changes here; moving a goal goes through setGoalPartOf
+    if (m_hierarchyLoaded) {
+        if (!known && goal.partOfGoalId > 0) m_subGoals[goal.partOfGoalId].append(goal.id);
+        const GoalRollup after = ownShare(goal);
+        shiftRollup(goal.id, after.targetMinutes - before.targetMinutes,
+                    after.completedMinutes - before.completedMinutes, after.goalCount - before.goalCount);
+    }
+}
+
+void StudyGoal::unindexGoal(int goalId)
+{
+    auto it = m_goals.constFind(goalId);
+    if (it == m_goals.constEnd()) return;
+    const GoalInfo goal = *it;
+    if (m_hierarchyLoaded) detachFromHierarchy(goal);
+    clearIndexes(goal);
+    m_goals.remove(goalId);
+}
+
+void StudyGoal::clearIndexes(const GoalInfo &goal)
+{
+    if (goal.dueDate.isNull()) {
+        m_openEndedGoals.remove(goal.id);
+    } else {
+        m_goalsByDueDate.remove(goal.dueDate, goal.id);
+    }
+    m_rules.remove(goal.id);
+    if (goal.parentGoalId > 0) {
+        m_savedOccurrences.remove(qMakePair(goal.parentGoalId, goal.occurrenceDate));
+    }
+}
+
 bool StudyGoal::executeQuery(const QString &queryStr, QSqlQuery &result)
 {
     if (!db.isOpen()) {
@@ -41,9 +241,14 @@ bool StudyGoal::createGoal(const QString &subject, int targetMinutes, const QStr
         return false;
     }
 
+    QString rrule;
+    if (recurrenceType != "None") {
+        rrule = RecurrenceRule::fromLegacy(recurrenceType, recurrenceValue, QDate::currentDate()).toString();
+    }
+
     QSqlQuery query(db);
-    query.prepare("INSERT INTO goals (subject, target_minutes, notes, start_date, recurrence_type, recurrence_value, last_generated_date, category) "
-                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    query.prepare("INSERT INTO goals (subject, target_minutes, notes, start_date, recurrence_type, recurrence_value, last_generated_date, category, rrule) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
     query.addBindValue(subject);
     query.addBindValue(targetMinutes);
     query.addBindValue(notes);
@@ -52,12 +257,14 @@ bool StudyGoal::createGoal(const QString &subject, int targetMinutes, const QStr
     query.addBindValue(recurrenceValue);
     query.addBindValue(QDate::currentDate().toString(Qt::ISODate));
     query.addBindValue(category);
+    query.addBindValue(rrule.isEmpty() ? QVariant() : QVariant(rrule));
 
     if (!query.exec()) {
         qDebug() << "Error creating goal:" << query.lastError().text();
         return false;
     }
     int newGoalId = query.lastInsertId().toInt();
+    m_lastCreatedGoalId = newGoalId;
     // Store resources
     for (const QString &res : resources) {
         QSqlQuery resQuery(db);
@@ -67,10 +274,27 @@ bool StudyGoal::createGoal(const QString &subject, int targetMinutes, const QStr
         resQuery.addBindValue(res);
         resQuery.exec();
     }
-    if (recurrenceType != "None") {
-        generateRecurringGoals(newGoalId);
-    }
+
+    GoalInfo goal;
+    goal.id = newGoalId;
+    goal.subject = subject;
+    goal.targetMinutes = targetMinutes;
+    goal.completedMinutes = 0;
+    goal.startDate = QDate::currentDate().toString(Qt::ISODate);
+    goal.status = "Active";
+    goal.notes = notes;
+    goal.recurrenceType = recurrenceType;
+    goal.recurrenceValue = recurrenceValue;
+    goal.lastGeneratedDate = QDate::currentDate();
+    goal.category = category;
+    goal.resources = resources;
+    goal.rrule = rrule;
+    indexGoal(goal);
+
     emit goalCreated(newGoalId);
+    GoalDelta delta;
+    delta.added.append(newGoalId);
+    emit goalsChanged(delta);
     return true;
 }
 
@@ -80,24 +304,29 @@ bool StudyGoal::updateGoal(int goalId, const QString &subject, int targetMinutes
         qDebug() << "Error: Database not open for updating goal.";
         return false;
     }
+    // Editing an occurrence saves it first, so the change sticks to that day only
+    GoalDelta delta;
+    goalId = saveOccurrence(goalId, delta);
     // Check if the goal exists before updating
-    QSqlQuery checkQuery(db);
-    checkQuery.prepare("SELECT COUNT(*) FROM goals WHERE id = ?");
-    checkQuery.addBindValue(goalId);
-    checkQuery.exec();
-    checkQuery.next();
-    if (checkQuery.value(0).toInt() == 0) {
+    if (!m_goals.contains(goalId)) {
         qDebug() << "No goal found with ID" << goalId << "in database.";
         return false;
     }
+    QString rrule;
+    if (recurrenceType != "None") {
+        rrule = RecurrenceRule::fromLegacy(recurrenceType, recurrenceValue,
+                                           QDate::fromString(m_goals[goalId].startDate, Qt::ISODate)).toString();
+    }
+
     QSqlQuery query(db);
-    query.prepare("UPDATE goals SET subject = ?, target_minutes = ?, notes = ?, recurrence_type = ?, recurrence_value = ?, category = ? WHERE id = ?");
+    query.prepare("UPDATE goals SET subject = ?, target_minutes = ?, notes = ?, recurrence_type = ?, recurrence_value = ?, category = ?, rrule = ? WHERE id = ?");
     query.addBindValue(subject);
     query.addBindValue(targetMinutes);
     query.addBindValue(notes);
     query.addBindValue(recurrenceType);
     query.addBindValue(recurrenceValue);
     query.addBindValue(category);
+    query.addBindValue(rrule.isEmpty() ? QVariant() : QVariant(rrule));
     query.addBindValue(goalId);
     if (!query.exec()) {
         qDebug() << "Error updating goal:" << query.lastError().text();
@@ -117,7 +346,24 @@ bool StudyGoal::updateGoal(int goalId, const QString &subject, int targetMinutes
         resQuery.addBindValue(res);
         resQuery.exec();
     }
+
+    GoalInfo goal = m_goals.value(goalId);
+    goal.subject = subject;
+    goal.targetMinutes = targetMinutes;
+    goal.notes = notes;
+    goal.recurrenceType = recurrenceType;
+    goal.recurrenceValue = recurrenceValue;
+    goal.category = category;
+    goal.resources = resources;
+    goal.rrule = rrule;
+    indexGoal(goal);
+    refreshTrackingState();
+
     emit goalUpdated(goalId);
+    if (!delta.added.contains(goalId)) delta.updated.append(goalId);
+    // A new target moves the rollups of every larger goal this one is part of
+    for (int ancestorId : getAncestors(goalId)) appendUnique(delta.updated, ancestorId);
+    emit goalsChanged(delta);
     return true;
 }
 
@@ -128,153 +374,177 @@ bool StudyGoal::deleteGoal(int goalId)
         return false;
     }
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM goals WHERE id = ?");
-    query.addBindValue(goalId);
-
-    if (!query.exec()) {
-        qDebug() << "Error deleting goal:" << query.lastError().text();
-        return false;
+    // Deleting one occurrence of a recurring goal records an exception date on the rule
+    GoalInfo goal;
+    if (lookupGoal(goalId, goal) && goal.parentGoalId > 0) {
+        addException(goal.parentGoalId, QDate::fromString(goal.occurrenceDate, Qt::ISODate));
     }
-
-    if (query.numRowsAffected() > 0) {
-        qDebug() << "Goal" << goalId << "deleted successfully.";
+    if (goalId < 0 && !m_savedOccurrenceIds.contains(goalId)) {
+        if (goal.parentGoalId <= 0) {
+            qDebug() << "No goal found with ID" << goalId << "to delete.";
+            return false;
+        }
         emit goalDeleted(goalId);
+        GoalDelta delta;
+        delta.removed.append(goalId);
+        emit goalsChanged(delta);
         return true;
-    } else {
+    }
+    goalId = m_savedOccurrenceIds.value(goalId, goalId);
+    if (!m_goals.contains(goalId)) {
         qDebug() << "No goal found with ID" << goalId << "to delete.";
         return false;
     }
+
+    // Sub-goals move up to the deleted goal's parent and prerequisite links to it go away
+    const int partOfGoalId = m_goals.value(goalId).partOfGoalId;
+    GoalDelta delta;
+    delta.removed.append(goalId);
+    delta.updated = getAncestors(goalId) + getSubGoals(goalId);
+    for (auto it = m_prerequisites.constBegin(); it != m_prerequisites.constEnd(); ++it) {
+        if (it.value().contains(goalId)) appendUnique(delta.updated, it.key());
+    }
+
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare("UPDATE goals SET part_of_goal_id = ? WHERE part_of_goal_id = ?");
+    query.addBindValue(partOfGoalId > 0 ? QVariant(partOfGoalId) : QVariant());
+    query.addBindValue(goalId);
+    bool ok = query.exec();
+    if (ok) {
+        query.prepare("DELETE FROM goal_prerequisites WHERE goal_id = ? OR prerequisite_id = ?");
+        query.addBindValue(goalId);
+        query.addBindValue(goalId);
+        ok = query.exec();
+    }
+    if (ok) {
+        query.prepare("DELETE FROM goals WHERE id = ?");
+        query.addBindValue(goalId);
+        ok = query.exec();
+    }
+    if (!ok || !db.commit()) {
+        qDebug() << "Error deleting goal:" << query.lastError().text() << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    qDebug() << "Goal" << goalId << "deleted successfully.";
+    unindexGoal(goalId);
+    refreshTrackingState();
+    emit goalDeleted(goalId);
+    std::sort(delta.updated.begin(), delta.updated.end());
+    emit goalsChanged(delta);
+    return true;
 }
 
 // Goal Retrieval
 QList<GoalInfo> StudyGoal::getGoalsForDate(const QDate &date) const
 {
     QList<GoalInfo> goals;
-    if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for retrieving goals.";
-        return goals;
+    const QString day = date.toString(Qt::ISODate);
+
+    // Open-ended goals plus goals due on or after the date; the start date filters the rest
+    for (int goalId : m_openEndedGoals) {
+        const GoalInfo &goal = *m_goals.constFind(goalId);
+        if (isGoalOnDate(goal, day)) goals.append(goal);
     }
-    QSqlQuery query(db);
-    query.prepare("SELECT id, subject, target_minutes, completed_minutes, start_date, due_date, status, notes, recurrence_type, recurrence_value, last_generated_date, category FROM goals WHERE start_date <= ? AND (due_date IS NULL OR due_date >= ?) AND status = 'Active'");
-    query.addBindValue(date.toString(Qt::ISODate));
-    query.addBindValue(date.toString(Qt::ISODate));
-    if (!query.exec()) {
-        qDebug() << "Error retrieving goals for date:" << query.lastError().text();
-        return goals;
+    for (auto it = m_goalsByDueDate.lowerBound(day); it != m_goalsByDueDate.end(); ++it) {
+        const GoalInfo &goal = *m_goals.constFind(it.value());
+        if (isGoalOnDate(goal, day)) goals.append(goal);
     }
-    while (query.next()) {
-        GoalInfo goal;
-        goal.id = query.value("id").toInt();
-        goal.subject = query.value("subject").toString();
-        goal.targetMinutes = query.value("target_minutes").toInt();
-        goal.completedMinutes = query.value("completed_minutes").toInt();
-        goal.startDate = query.value("start_date").toString();
-        goal.dueDate = query.value("due_date").toString();
-        goal.status = query.value("status").toString();
-        goal.notes = query.value("notes").toString();
-        goal.recurrenceType = query.value("recurrence_type").toString();
-        goal.recurrenceValue = query.value("recurrence_value").toString();
-        goal.lastGeneratedDate = QDate::fromString(query.value("last_generated_date").toString(), Qt::ISODate);
-        goal.category = query.value("category").toString();
-        // Fetch resources
-        goal.resources = getResourcesForGoal(goal.id);
-        goals.append(goal);
+
+    // One rule check per recurring goal; only occurrences without a saved row are expanded
+    for (auto it = m_rules.constBegin(); it != m_rules.constEnd(); ++it) {
+        const GoalInfo &parent = *m_goals.constFind(it.key());
+        if (parent.status != "Active" || date < firstLazyDate(parent)) continue;
+        if (m_savedOccurrences.contains(qMakePair(parent.id, day)) || !it->occursOn(date)) continue;
+        goals.append(occurrenceOf(parent, date));
     }
+
+    std::sort(goals.begin(), goals.end(), goalOrder);
     return goals;
 }
 
 QList<QMap<QString, QVariant>> StudyGoal::getGoalsForSubject(const QString &subject) const
 {
     QList<QMap<QString, QVariant>> goals;
-    if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for retrieving goals by subject.";
-        return goals;
-    }
-
-    QSqlQuery query(db);
-    query.prepare("SELECT id, subject, target_minutes, completed_minutes, notes, recurrence_type, recurrence_value, category FROM goals WHERE subject LIKE ? AND status = 'Active'");
-    query.addBindValue("%" + subject + "%"); // Fuzzy search
-
-    if (!query.exec()) {
-        qDebug() << "Error retrieving goals by subject:" << query.lastError().text();
-        return goals;
+    QList<int> ids;
+    for (const GoalInfo &goal : m_goals) {
+        // Fuzzy search, case-insensitive like SQLite's LIKE
+        if (goal.status == "Active" && goal.subject.contains(subject, Qt::CaseInsensitive)) {
+            ids.append(goal.id);
+        }
     }
+    std::sort(ids.begin(), ids.end());
 
-    while (query.next()) {
+    for (int goalId : ids) {
+        const GoalInfo &info = *m_goals.constFind(goalId);
         QMap<QString, QVariant> goal;
-        goal["id"] = query.value("id").toInt();
-        goal["subject"] = query.value("subject").toString();
-        goal["target_minutes"] = query.value("target_minutes").toInt();
-        goal["completed_minutes"] = query.value("completed_minutes").toInt();
-        goal["notes"] = query.value("notes").toString();
-        goal["recurrence_type"] = query.value("recurrence_type").toString();
-        goal["recurrence_value"] = query.value("recurrence_value").toString();
-        goal["category"] = query.value("category").toString();
+        goal["id"] = info.id;
+        goal["subject"] = info.subject;
+        goal["target_minutes"] = info.targetMinutes;
+        goal["completed_minutes"] = info.completedMinutes;
+        goal["notes"] = info.notes;
+        goal["recurrence_type"] = info.recurrenceType;
+        goal["recurrence_value"] = info.recurrenceValue;
+        goal["category"] = info.category;
         goals.append(goal);
     }
     return goals;
 }
 
-QMap<QString, QVariant> StudyGoal::getGoalDetails(int goalId) const
+bool StudyGoal::lookupGoal(int goalId, GoalInfo &goal) const
 {
-    QMap<QString, QVariant> details;
-    if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for retrieving goal details.";
-        return details;
+    if (goalId < 0) {
+        auto saved = m_savedOccurrenceIds.constFind(goalId);
+        if (saved != m_savedOccurrenceIds.constEnd()) {
+            goalId = *saved;
+        } else {
+            auto key = m_occurrenceKeys.constFind(goalId);
+            if (key == m_occurrenceKeys.constEnd()) return false;
+            auto parent = m_goals.constFind(key->first);
+            if (parent == m_goals.constEnd()) return false;
+            goal = occurrenceOf(*parent, QDate::fromString(key->second, Qt::ISODate));
+            return true;
+        }
     }
+    auto it = m_goals.constFind(goalId);
+    if (it == m_goals.constEnd()) return false;
+    goal = *it;
+    return true;
+}
 
-    QSqlQuery query(db);
-    query.prepare("SELECT id, subject, target_minutes, completed_minutes, notes, recurrence_type, recurrence_value, category FROM goals WHERE id = ?");
-    query.addBindValue(goalId);
-
-    if (!query.exec()) {
-        qDebug() << "Error retrieving goal details:" << query.lastError().text();
+QMap<QString, QVariant> StudyGoal::getGoalDetails(int goalId) const
+{
+    QMap<QString, QVariant> details;
+    GoalInfo goal;
+    if (!lookupGoal(goalId, goal)) {
         return details;
     }
 
-    if (query.next()) {
-        details["id"] = query.value("id").toInt();
-        details["subject"] = query.value("subject").toString();
-        details["target_minutes"] = query.value("target_minutes").toInt();
-        details["completed_minutes"] = query.value("completed_minutes").toInt();
-        details["notes"] = query.value("notes").toString();
-        details["recurrence_type"] = query.value("recurrence_type").toString();
-        details["recurrence_value"] = query.value("recurrence_value").toString();
-        details["category"] = query.value("category").toString();
-    }
+    details["id"] = goal.id;
+    details["subject"] = goal.subject;
+    details["target_minutes"] = goal.targetMinutes;
+    details["completed_minutes"] = goal.completedMinutes;
+    details["notes"] = goal.notes;
+    details["recurrence_type"] = goal.recurrenceType;
+    details["recurrence_value"] = goal.recurrenceValue;
+    details["category"] = goal.category;
+    details["part_of_goal_id"] = goal.partOfGoalId;
     return details;
 }
 
 // Progress Tracking
 int StudyGoal::getProgress(int goalId) const
 {
-    if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for getting progress.";
-        return 0;
-    }
-    QSqlQuery query(db);
-    query.prepare("SELECT completed_minutes FROM goals WHERE id = ?");
-    query.addBindValue(goalId);
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
-    }
-    return 0;
+    GoalInfo goal;
+    return lookupGoal(goalId, goal) ? goal.completedMinutes : 0;
 }
 
 int StudyGoal::getTarget(int goalId) const
 {
-    if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for getting target.";
-        return 0;
-    }
-    QSqlQuery query(db);
-    query.prepare("SELECT target_minutes FROM goals WHERE id = ?");
-    query.addBindValue(goalId);
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
-    }
-    return 0;
+    GoalInfo goal;
+    return lookupGoal(goalId, goal) ? goal.targetMinutes : 0;
 }
 
 float StudyGoal::getCompletionPercentage(int goalId) const
@@ -294,20 +564,92 @@ bool StudyGoal::addProgress(int goalId, int minutesToAdd)
         return false;
     }
 
-    int currentCompletedMinutes = getProgress(goalId);
-    int newCompletedMinutes = currentCompletedMinutes + minutesToAdd;
+    QHash<int, int> minutesByGoal;
+    minutesByGoal.insert(goalId, minutesToAdd);
+    GoalDelta delta;
+    if (!applyProgress(minutesByGoal, delta)) {
+        // Occurrences saved before the failure are real rows now
+        if (!delta.isEmpty()) emit goalsChanged(delta);
+        return false;
+    }
+    emit goalUpdated(m_savedOccurrenceIds.value(goalId, goalId));
+    // goalsChanged repaints the goals; sessionProgressUpdated only settles the tracked session
+    emit goalsChanged(delta);
+    emit sessionProgressUpdated(goalId, minutesToAdd);
+    return true;
+}
+
+bool StudyGoal::addProgressBatch(const QHash<int, int> &minutesByGoal)
+{
+    if (!db.isOpen()) {
+        qDebug() << "Error: Database not open for adding progress.";
+        return false;
+    }
+    if (minutesByGoal.isEmpty()) return true;
+
+    GoalDelta delta;
+    if (!applyProgress(minutesByGoal, delta)) {
+        // Occurrences saved before the failure are real rows now
+        if (!delta.isEmpty()) emit goalsChanged(delta);
+        return false;
+    }
+    emit goalsChanged(delta);
+    return true;
+}
 
-    QSqlQuery query(db);
-    query.prepare("UPDATE goals SET completed_minutes = ? WHERE id = ?");
-    query.addBindValue(newCompletedMinutes);
-    query.addBindValue(goalId);
+bool StudyGoal::applyProgress(const QHash<int, int> &minutesByGoal, GoalDelta &delta)
+{
+    // Occurrences of recurring goals get a row once they have progress to keep
+    QHash<int, int> savedMinutes;
+    for (auto it = minutesByGoal.constBegin(); it != minutesByGoal.constEnd(); ++it) {
+        const int goalId = saveOccurrence(it.key(), delta);
+        if (goalId < 0) return false;
+        savedMinutes[goalId] += it.value();
+    }
 
-    if (!query.exec()) {
-        qDebug() << "Error adding progress to goal:" << query.lastError().text();
+    // Increment in SQL so concurrent writers cannot lose minutes between a read and a write,
+    // and cache the stored total rather than our own sum so the two cannot drift apart
+    if (!db.transaction()) {
+        qDebug() << "Error starting goal progress transaction:" << db.lastError().text();
         return false;
     }
-    emit goalUpdated(goalId);
-    emit sessionProgressUpdated(goalId, minutesToAdd); 
+    QSqlQuery query(db);
+    query.prepare("UPDATE goals SET completed_minutes = completed_minutes + ? WHERE id = ?");
+    QSqlQuery stored(db);
+    stored.prepare("SELECT completed_minutes FROM goals WHERE id = ?");
+    QHash<int, int> storedMinutes;
+    for (auto it = savedMinutes.constBegin(); it != savedMinutes.constEnd(); ++it) {
+        query.addBindValue(it.value());
+        query.addBindValue(it.key());
+        stored.addBindValue(it.key());
+        if (!query.exec() || !stored.exec() || !stored.next()) {
+            qDebug() << "Error adding progress to goal" << it.key() << ":"
+                     << query.lastError().text() << stored.lastError().text();
+            db.rollback();
+            return false;
+        }
+        storedMinutes.insert(it.key(), stored.value(0).toInt());
+    }
+    if (!db.commit()) {
+        qDebug() << "Error committing goal progress:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    for (auto it = savedMinutes.constBegin(); it != savedMinutes.constEnd(); ++it) {
+        auto goal = m_goals.find(it.key());
+        if (goal != m_goals.end()) {
+            const int creditedBefore = ownShare(*goal).completedMinutes;
+            goal->completedMinutes = storedMinutes.value(it.key());
+            shiftRollup(it.key(), 0, ownShare(*goal).completedMinutes - creditedBefore, 0);
+        }
+        if (!delta.added.contains(it.key())) appendUnique(delta.updated, it.key());
+        for (int ancestorId : getAncestors(it.key())) {
+            if (!delta.added.contains(ancestorId)) appendUnique(delta.updated, ancestorId);
+        }
+    }
+    std::sort(delta.updated.begin(), delta.updated.end());
+    refreshTrackingState();
     return true;
 }
 
@@ -323,10 +665,18 @@ void StudyGoal::connectToPomodoroTimer(PomodoroTimer *timer)
 void StudyGoal::startTrackingGoal(int goalId, int initialElapsedSeconds)
 {
     m_currentTrackingGoalId = goalId;
+    refreshTrackingState();
     m_pomodoroSessionStartTime = QTime::currentTime().addSecs(-initialElapsedSeconds);
     emit goalTrackingStarted(goalId);
 }
 
+void StudyGoal::refreshTrackingState()
+{
+    if (m_currentTrackingGoalId == -1) return;
+    m_trackedCompletedMinutes = getProgress(m_currentTrackingGoalId);
+    m_trackedTargetMinutes = getTarget(m_currentTrackingGoalId);
+}
+
 void StudyGoal::stopTrackingGoal()
 {
     if (m_currentTrackingGoalId != -1 && m_pomodoroTimer) {
@@ -335,7 +685,6 @@ void StudyGoal::stopTrackingGoal()
         int minutesToAdd = elapsedSeconds / 60;
         if (minutesToAdd > 0) {
             addProgress(m_currentTrackingGoalId, minutesToAdd);
-            emit sessionProgressUpdated(m_currentTrackingGoalId, minutesToAdd);
         }
     }
     m_currentTrackingGoalId = -1;
@@ -351,12 +700,10 @@ void StudyGoal::handlePomodoroTimeUpdated(const QString &time)
     Q_UNUSED(time);
     if (m_currentTrackingGoalId != -1) {
         int elapsedSeconds = m_pomodoroSessionStartTime.secsTo(QTime::currentTime());
-        int completedMinutesFromDB = getProgress(m_currentTrackingGoalId);
-        int targetMinutes = getTarget(m_currentTrackingGoalId);
         int sessionMinutes = elapsedSeconds / 60;
-        int totalCompleted = completedMinutesFromDB + sessionMinutes;
-        if (totalCompleted >= targetMinutes && targetMinutes > 0) {
-            emit sessionTimeUpdated(m_currentTrackingGoalId, (targetMinutes - completedMinutesFromDB) * 60);
+        int totalCompleted = m_trackedCompletedMinutes + sessionMinutes;
+        if (totalCompleted >= m_trackedTargetMinutes && m_trackedTargetMinutes > 0) {
+            emit sessionTimeUpdated(m_currentTrackingGoalId, (m_trackedTargetMinutes - m_trackedCompletedMinutes) * 60);
             stopTrackingGoal();
             return;
         }
@@ -365,193 +712,535 @@ void StudyGoal::handlePomodoroTimeUpdated(const QString &time)
 }
 
 // Recurring Goals
-void StudyGoal::generateRecurringGoals(int parentGoalId)
+int StudyGoal::materializeGoal(int goalId)
 {
-    if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for generating recurring goals.";
-        return;
+    GoalDelta delta;
+    const int savedId = saveOccurrence(goalId, delta);
+    if (!delta.isEmpty()) {
+        emit goalsChanged(delta);
     }
+    return savedId;
+}
 
-    QSqlQuery query(db);
-    query.prepare("SELECT id, subject, target_minutes, notes, recurrence_type, recurrence_value, last_generated_date, category FROM goals WHERE id = ?");
-    query.addBindValue(parentGoalId);
+bool StudyGoal::catchUpRecurringGoals()
+{
+    if (!db.isOpen()) return false;
 
-    if (!query.exec() || !query.next()) {
-        qDebug() << "Error retrieving parent goal for recurrence:" << query.lastError().text();
-        return;
-    }
-
-    GoalInfo parentGoal;
-    parentGoal.id = query.value("id").toInt();
-    parentGoal.subject = query.value("subject").toString();
-    parentGoal.targetMinutes = query.value("target_minutes").toInt();
-    parentGoal.notes = query.value("notes").toString();
-    parentGoal.recurrenceType = query.value("recurrence_type").toString();
-    parentGoal.recurrenceValue = query.value("recurrence_value").toString();
-    parentGoal.lastGeneratedDate = QDate::fromString(query.value("last_generated_date").toString(), Qt::ISODate);
-    parentGoal.category = query.value("category").toString();
-
-    QDate today = QDate::currentDate();
-    QDate nextGenerationDate = parentGoal.lastGeneratedDate;
-
-    if (parentGoal.recurrenceType == "Daily") {
-        nextGenerationDate = parentGoal.lastGeneratedDate.addDays(1);
-    } else if (parentGoal.recurrenceType == "Weekly") {
-        QStringList days = parentGoal.recurrenceValue.split(',', Qt::SkipEmptyParts);
-        QMap<QString, int> dayMap;
-        dayMap["Mon"] = 1; dayMap["Tue"] = 2; dayMap["Wed"] = 3; dayMap["Thu"] = 4;
-        dayMap["Fri"] = 5; dayMap["Sat"] = 6; dayMap["Sun"] = 7;
-
-        bool foundNext = false;
-        for (int i = 0; i < 8; ++i) {
-            QDate checkDate = parentGoal.lastGeneratedDate.addDays(i + 1);
-            if (days.contains(checkDate.toString("ddd"))) {
-                nextGenerationDate = checkDate;
-                foundNext = true;
-                break;
-            }
-        }
-        if (!foundNext) {
-            nextGenerationDate = parentGoal.lastGeneratedDate.addDays(7);
+    // Recurring goals whose last_generated_date is past their start still have eager rows
+    QList<int> parents;
+    for (auto it = m_rules.constBegin(); it != m_rules.constEnd(); ++it) {
+        const GoalInfo &parent = m_goals[it.key()];
+        if (parent.lastGeneratedDate.isValid() && parent.lastGeneratedDate.toString(Qt::ISODate) > parent.startDate) {
+            parents.append(parent.id);
         }
-    } else if (parentGoal.recurrenceType == "Monthly") {
-        QStringList days = parentGoal.recurrenceValue.split(',', Qt::SkipEmptyParts);
-        bool foundNext = false;
-        for (int i = 0; i < 32; ++i) {
-            QDate checkDate = parentGoal.lastGeneratedDate.addDays(i + 1);
-            if (days.contains(QString::number(checkDate.day()))) {
-                nextGenerationDate = checkDate;
-                foundNext = true;
-                break;
+    }
+    if (parents.isEmpty()) return true;
+    std::sort(parents.begin(), parents.end());
+
+    // Goals referenced by sessions or surveys, or holding resources, are kept even without progress
+    QSet<int> referenced;
+    QSqlQuery refQuery(db);
+    if (!refQuery.exec("SELECT goal_id FROM session_goals UNION SELECT goal_id FROM surveys UNION SELECT goal_id FROM goal_resources")) {
+        qDebug() << "Error reading goal references:" << refQuery.lastError().text();
+        return false;
+    }
+    while (refQuery.next()) referenced.insert(refQuery.value(0).toInt());
+
+    // Match generated instances to the first recurring goal with the same subject,
+    // category and target whose generated range covers the instance date
+    QList<int> dropped;
+    QHash<int, int> linked; // instance id -> recurring goal id
+    QSet<QPair<int, QString>> taken = m_savedOccurrences;
+    QList<int> ids = m_goals.keys();
+    std::sort(ids.begin(), ids.end());
+    for (int goalId : ids) {
+        const GoalInfo &goal = m_goals[goalId];
+        if (isRecurring(goal) || goal.parentGoalId > 0 || goal.dueDate.isNull() || goal.startDate != goal.dueDate) continue;
+        for (int parentId : parents) {
+            const GoalInfo &parent = m_goals[parentId];
+            if (goal.subject != parent.subject || goal.category != parent.category || goal.targetMinutes != parent.targetMinutes
+                || goal.startDate <= parent.startDate || goal.startDate > parent.lastGeneratedDate.toString(Qt::ISODate)) {
+                continue;
             }
+            const QPair<int, QString> key(parentId, goal.startDate);
+            if (taken.contains(key)) break;
+            taken.insert(key);
+            // Only instances exactly as the generator left them are dropped; the lazy
+            // occurrence for the date replaces them
+            if (goal.completedMinutes == 0 && !referenced.contains(goalId) && goal.status == "Active"
+                && (goal.notes.isEmpty() || goal.notes == parent.notes)) {
+                dropped.append(goalId);
+            } else {
+                linked.insert(goalId, parentId);
+            }
+            break;
         }
-        if (!foundNext) {
-            nextGenerationDate = QDate(nextGenerationDate.year(), nextGenerationDate.month() + 1, 1);
-        }
-    } else {
-        return;
-    }
-
-    while (nextGenerationDate <= today) {
-        QSqlQuery insertQuery(db);
-        insertQuery.prepare("INSERT INTO goals (subject, target_minutes, notes, start_date, recurrence_type, recurrence_value, last_generated_date, category, due_date) "
-                            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
-        insertQuery.addBindValue(parentGoal.subject);
-        insertQuery.addBindValue(parentGoal.targetMinutes);
-        insertQuery.addBindValue(parentGoal.notes);
-        insertQuery.addBindValue(nextGenerationDate.toString(Qt::ISODate));
-        insertQuery.addBindValue("None");
-        insertQuery.addBindValue("");
-        insertQuery.addBindValue(nextGenerationDate.toString(Qt::ISODate));
-        insertQuery.addBindValue(parentGoal.category);
-        insertQuery.addBindValue(nextGenerationDate.toString(Qt::ISODate));
-
-        if (!insertQuery.exec()) {
-            qDebug() << "Error creating recurring goal instance:" << insertQuery.lastError().text();
-        } else {
-            qDebug() << "Generated recurring goal for" << nextGenerationDate.toString(Qt::ISODate);
-            emit goalCreated(insertQuery.lastInsertId().toInt());
+    }
+
+    // Dates the old generator covered that no instance matches were deleted or edited
+    // by the user; exception dates keep the rule from bringing them back
+    QHash<int, QString> exceptions; // recurring goal id -> new exdates
+    for (int parentId : parents) {
+        const GoalInfo &parent = m_goals[parentId];
+        const QDate start = QDate::fromString(parent.startDate, Qt::ISODate);
+        const RecurrenceRule &rule = m_rules[parentId];
+        QSet<QDate> dates = rule.exceptionDates();
+        bool added = false;
+        for (const QDate &date : rule.occurrences(start.addDays(1), parent.lastGeneratedDate)) {
+            if (taken.contains(QPair<int, QString>(parentId, date.toString(Qt::ISODate)))) continue;
+            dates.insert(date);
+            added = true;
         }
+        if (added) exceptions.insert(parentId, RecurrenceRule::formatDateList(dates));
+    }
+
+    auto idList = [](const QList<int> &values) {
+        QStringList items;
+        for (int value : values) items << QString::number(value);
+        return items.join(',');
+    };
 
-        // Update the last_generated_date of the parent goal
-        QSqlQuery updateParentQuery(db);
-        updateParentQuery.prepare("UPDATE goals SET last_generated_date = ? WHERE id = ?");
-        updateParentQuery.addBindValue(nextGenerationDate.toString(Qt::ISODate));
-        updateParentQuery.addBindValue(parentGoal.id);
-        if (!updateParentQuery.exec()) {
-            qDebug() << "Error updating parent goal's last_generated_date:" << updateParentQuery.lastError().text();
+    db.transaction();
+    QSqlQuery query(db);
+    bool ok = true;
+    if (ok && !dropped.isEmpty()) {
+        // Instances with resources count as touched and are kept, so no goal_resources to clear
+        ok = query.exec(QString("DELETE FROM goals WHERE id IN (%1)").arg(idList(dropped)));
+    }
+    if (ok && !linked.isEmpty()) {
+        QString cases;
+        for (auto it = linked.constBegin(); it != linked.constEnd(); ++it) {
+            cases += QString(" WHEN %1 THEN %2").arg(it.key()).arg(it.value());
         }
+        ok = query.exec(QString("UPDATE goals SET parent_goal_id = CASE id%1 END, occurrence_date = due_date WHERE id IN (%2)")
+                            .arg(cases, idList(linked.keys())));
+    }
+    if (ok && !exceptions.isEmpty()) {
+        query.prepare("UPDATE goals SET exdates = ? WHERE id = ?");
+        for (auto it = exceptions.constBegin(); ok && it != exceptions.constEnd(); ++it) {
+            query.addBindValue(it.value());
+            query.addBindValue(it.key());
+            ok = query.exec();
+        }
+    }
+    if (ok) {
+        // From here on the rule covers every date after the start, like a new goal
+        ok = query.exec(QString("UPDATE goals SET last_generated_date = start_date WHERE id IN (%1)").arg(idList(parents)));
+    }
+    if (!ok || !db.commit()) {
+        qDebug() << "Error catching up recurring goals:" << query.lastError().text() << db.lastError().text();
+        db.rollback();
+        return false;
+    }
 
-        // Move to the next potential generation date for the loop
-        if (parentGoal.recurrenceType == "Daily") {
-            nextGenerationDate = nextGenerationDate.addDays(1);
-        } else if (parentGoal.recurrenceType == "Weekly") {
-            nextGenerationDate = nextGenerationDate.addDays(1);
-        } else if (parentGoal.recurrenceType == "Monthly") {
-            nextGenerationDate = nextGenerationDate.addMonths(1);
-        } else {
-            break;
+    GoalDelta delta;
+    for (int goalId : dropped) {
+        unindexGoal(goalId);
+        delta.removed.append(goalId);
+    }
+    for (auto it = linked.constBegin(); it != linked.constEnd(); ++it) {
+        GoalInfo goal = m_goals.value(it.key());
+        goal.parentGoalId = it.value();
+        goal.occurrenceDate = goal.dueDate;
+        indexGoal(goal);
+        delta.updated.append(it.key());
+    }
+    for (int parentId : parents) {
+        GoalInfo &parent = m_goals[parentId];
+        parent.lastGeneratedDate = QDate::fromString(parent.startDate, Qt::ISODate);
+        if (exceptions.contains(parentId)) {
+            parent.exceptionDates = exceptions.value(parentId);
+            m_rules[parentId].setExceptions(RecurrenceRule::parseDateList(parent.exceptionDates));
         }
+        delta.updated.append(parentId);
     }
+    std::sort(delta.updated.begin(), delta.updated.end());
+    qDebug() << "Recurring goal catch-up: dropped" << dropped.size() << "empty instances, linked" << linked.size()
+             << "and excluded missing dates of" << exceptions.size() << "goals";
+    emit goalsChanged(delta);
+    return true;
 }
 
-void StudyGoal::checkAndGenerateAllRecurringGoals() {
-    if (!db.isOpen()) return;
+QList<QDate> StudyGoal::getOccurrences(int goalId, const QDate &from, const QDate &to) const
+{
+    auto rule = m_rules.constFind(goalId);
+    if (rule == m_rules.constEnd()) return QList<QDate>();
+    return rule->occurrences(std::max(from, firstLazyDate(m_goals.value(goalId))), to);
+}
+
+GoalInfo StudyGoal::occurrenceOf(const GoalInfo &parent, const QDate &date) const
+{
+    const QPair<int, QString> key(parent.id, date.toString(Qt::ISODate));
+    int occurrenceId = m_occurrenceIds.value(key, 0);
+    if (occurrenceId == 0) {
+        occurrenceId = m_nextOccurrenceId--;
+        m_occurrenceIds.insert(key, occurrenceId);
+        m_occurrenceKeys.insert(occurrenceId, key);
+    }
+
+    // Same shape as the instances the old generator inserted
+    GoalInfo occurrence;
+    occurrence.id = occurrenceId;
+    occurrence.subject = parent.subject;
+    occurrence.targetMinutes = parent.targetMinutes;
+    occurrence.completedMinutes = 0;
+    occurrence.startDate = key.second;
+    occurrence.dueDate = key.second;
+    occurrence.status = "Active";
+    occurrence.notes = parent.notes;
+    occurrence.recurrenceType = "None";
+    occurrence.recurrenceValue = "";
+    occurrence.category = parent.category;
+    occurrence.lastGeneratedDate = date;
+    occurrence.parentGoalId = parent.id;
+    occurrence.occurrenceDate = key.second;
+    return occurrence;
+}
+
+int StudyGoal::saveOccurrence(int goalId, GoalDelta &delta)
+{
+    if (goalId >= 0) return goalId;
+    auto saved = m_savedOccurrenceIds.constFind(goalId);
+    if (saved != m_savedOccurrenceIds.constEnd()) return *saved;
+
+    GoalInfo occurrence;
+    if (!lookupGoal(goalId, occurrence)) {
+        qDebug() << "No occurrence found with ID" << goalId;
+        return -1;
+    }
+
     QSqlQuery query(db);
-    query.prepare("SELECT id, recurrence_type, last_generated_date FROM goals WHERE recurrence_type != 'None'");
-    if (!query.exec()) return;
-    QDate today = QDate::currentDate();
-    while (query.next()) {
-        int goalId = query.value(0).toInt();
-        QString recurrenceType = query.value(1).toString();
-        QDate lastGen = QDate::fromString(query.value(2).toString(), Qt::ISODate);
-        if (lastGen.isValid() && lastGen < today) {
-            generateRecurringGoals(goalId);
+    query.prepare("INSERT INTO goals (subject, target_minutes, notes, start_date, due_date, recurrence_type, recurrence_value, last_generated_date, category, parent_goal_id, occurrence_date) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    query.addBindValue(occurrence.subject);
+    query.addBindValue(occurrence.targetMinutes);
+    query.addBindValue(occurrence.notes);
+    query.addBindValue(occurrence.startDate);
+    query.addBindValue(occurrence.dueDate);
+    query.addBindValue(occurrence.recurrenceType);
+    query.addBindValue(occurrence.recurrenceValue);
+    query.addBindValue(occurrence.occurrenceDate);
+    query.addBindValue(occurrence.category);
+    query.addBindValue(occurrence.parentGoalId);
+    query.addBindValue(occurrence.occurrenceDate);
+    if (!query.exec()) {
+        qDebug() << "Error saving recurring goal occurrence:" << query.lastError().text();
+        return -1;
+    }
+
+    occurrence.id = query.lastInsertId().toInt();
+    indexGoal(occurrence);
+    m_savedOccurrenceIds.insert(goalId, occurrence.id);
+    if (m_currentTrackingGoalId == goalId) {
+        m_currentTrackingGoalId = occurrence.id;
+    }
+    delta.removed.append(goalId);
+    delta.added.append(occurrence.id);
+    return occurrence.id;
+}
+
+bool StudyGoal::addException(int parentGoalId, const QDate &date)
+{
+    auto parent = m_goals.find(parentGoalId);
+    if (parent == m_goals.end()) return false;
+
+    QSet<QDate> dates = RecurrenceRule::parseDateList(parent->exceptionDates);
+    dates.insert(date);
+    const QString exceptionDates = RecurrenceRule::formatDateList(dates);
+
+    QSqlQuery query(db);
+    query.prepare("UPDATE goals SET exdates = ? WHERE id = ?");
+    query.addBindValue(exceptionDates);
+    query.addBindValue(parentGoalId);
+    if (!query.exec()) {
+        qDebug() << "Error adding exception date to recurring goal:" << query.lastError().text();
+        return false;
+    }
+    parent->exceptionDates = exceptionDates;
+    auto rule = m_rules.find(parentGoalId);
+    if (rule != m_rules.end()) {
+        rule->addException(date);
+    }
+    return true;
+}
+
+// Goal hierarchy
+void StudyGoal::rebuildHierarchy()
+{
+    m_rollups.clear();
+    m_subGoals.clear();
+    for (const GoalInfo &goal : m_goals) {
+        if (goal.partOfGoalId > 0 && m_goals.contains(goal.partOfGoalId)) {
+            m_subGoals[goal.partOfGoalId].append(goal.id);
         }
     }
+    for (QList<int> &subGoals : m_subGoals) {
+        std::sort(subGoals.begin(), subGoals.end());
+    }
+    m_hierarchyLoaded = true;
+
+    // Each goal adds its own share to itself and its ancestors
+    for (const GoalInfo &goal : m_goals) {
+        const GoalRollup share = ownShare(goal);
+        shiftRollup(goal.id, share.targetMinutes, share.completedMinutes, share.goalCount);
+    }
 }
 
-// Statistics
-QMap<QString, int> StudyGoal::getSubjectStats(const QDate &startDate, const QDate &endDate)
+void StudyGoal::shiftRollup(int goalId, int targetMinutes, int completedMinutes, int goalCount)
+{
+    // The step limit only matters if the stored hierarchy was edited into a cycle
+    auto goal = m_goals.constFind(goalId);
+    for (int steps = 0; goal != m_goals.constEnd() && steps <= m_goals.size(); ++steps) {
+        GoalRollup &rollup = m_rollups[goal->id];
+        rollup.targetMinutes += targetMinutes;
+        rollup.completedMinutes += completedMinutes;
+        rollup.goalCount += goalCount;
+        if (goal->partOfGoalId <= 0) break;
+        goal = m_goals.constFind(goal->partOfGoalId);
+    }
+}
+
+void StudyGoal::detachFromHierarchy(const GoalInfo &goal)
+{
+    // Sub-goals move up a level, so the ancestors only lose the goal's own share
+    const GoalRollup share = ownShare(goal);
+    shiftRollup(goal.id, -share.targetMinutes, -share.completedMinutes, -share.goalCount);
+    const QList<int> subGoals = m_subGoals.take(goal.id);
+    for (int subGoalId : subGoals) {
+        m_goals[subGoalId].partOfGoalId = goal.partOfGoalId;
+    }
+    if (goal.partOfGoalId > 0) {
+        QList<int> &siblings = m_subGoals[goal.partOfGoalId];
+        siblings.removeOne(goal.id);
+        siblings += subGoals;
+        if (siblings.isEmpty()) m_subGoals.remove(goal.partOfGoalId);
+    }
+    m_rollups.remove(goal.id);
+
+    m_prerequisites.remove(goal.id);
+    for (auto it = m_prerequisites.begin(); it != m_prerequisites.end();) {
+        it->removeAll(goal.id);
+        if (it->isEmpty()) {
+            it = m_prerequisites.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool StudyGoal::setGoalPartOf(int goalId, int partOfGoalId)
 {
-    QMap<QString, int> stats;
     if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for getting subject stats.";
-        return stats;
+        qDebug() << "Error: Database not open for moving goal.";
+        return false;
+    }
+    goalId = m_savedOccurrenceIds.value(goalId, goalId);
+    partOfGoalId = m_savedOccurrenceIds.value(partOfGoalId, partOfGoalId);
+    if (partOfGoalId <= 0) partOfGoalId = -1;
+    auto goal = m_goals.find(goalId);
+    if (goal == m_goals.end()) {
+        qDebug() << "No goal found with ID" << goalId;
+        return false;
+    }
+    if (goal->partOfGoalId == partOfGoalId) return true;
+    if (partOfGoalId > 0) {
+        if (!m_goals.contains(partOfGoalId)) {
+            qDebug() << "No goal found with ID" << partOfGoalId;
+            return false;
+        }
+        // A goal cannot become part of itself or of one of its own sub-goals
+        if (partOfGoalId == goalId || getAncestors(partOfGoalId).contains(goalId)) {
+            qDebug() << "Goal" << goalId << "cannot be part of goal" << partOfGoalId;
+            return false;
+        }
     }
 
     QSqlQuery query(db);
-    query.prepare("SELECT subject, SUM(completed_minutes) FROM goals WHERE start_date BETWEEN ? AND ? GROUP BY subject");
-    query.addBindValue(startDate.toString(Qt::ISODate));
-    query.addBindValue(endDate.toString(Qt::ISODate));
-
+    query.prepare("UPDATE goals SET part_of_goal_id = ? WHERE id = ?");
+    query.addBindValue(partOfGoalId > 0 ? QVariant(partOfGoalId) : QVariant());
+    query.addBindValue(goalId);
     if (!query.exec()) {
-        qDebug() << "Error getting subject stats:" << query.lastError().text();
-        return stats;
+        qDebug() << "Error moving goal:" << query.lastError().text();
+        return false;
     }
 
-    while (query.next()) {
-        stats[query.value(0).toString()] = query.value(1).toInt();
+    // The whole subtree moves: its rollup leaves the old ancestors and joins the new ones
+    GoalDelta delta;
+    delta.updated = getAncestors(goalId);
+    const GoalRollup moved = m_rollups.value(goalId);
+    const int oldPartOfGoalId = goal->partOfGoalId;
+    if (oldPartOfGoalId > 0) {
+        shiftRollup(oldPartOfGoalId, -moved.targetMinutes, -moved.completedMinutes, -moved.goalCount);
+        m_subGoals[oldPartOfGoalId].removeOne(goalId);
+        if (m_subGoals[oldPartOfGoalId].isEmpty()) m_subGoals.remove(oldPartOfGoalId);
     }
-    return stats;
+    goal->partOfGoalId = partOfGoalId;
+    if (partOfGoalId > 0) {
+        m_subGoals[partOfGoalId].append(goalId);
+        shiftRollup(partOfGoalId, moved.targetMinutes, moved.completedMinutes, moved.goalCount);
+    }
+
+    appendUnique(delta.updated, goalId);
+    for (int ancestorId : getAncestors(goalId)) appendUnique(delta.updated, ancestorId);
+    std::sort(delta.updated.begin(), delta.updated.end());
+    emit goalUpdated(goalId);
+    emit goalsChanged(delta);
+    return true;
 }
 
-QMap<QString, int> StudyGoal::getDailyStats(const QDate &date)
+QList<int> StudyGoal::getSubGoals(int goalId) const
+{
+    return m_subGoals.value(m_savedOccurrenceIds.value(goalId, goalId));
+}
+
+QList<int> StudyGoal::getAncestors(int goalId) const
+{
+    QList<int> ancestors;
+    auto goal = m_goals.constFind(m_savedOccurrenceIds.value(goalId, goalId));
+    while (goal != m_goals.constEnd() && goal->partOfGoalId > 0 && ancestors.size() < m_goals.size()) {
+        goal = m_goals.constFind(goal->partOfGoalId);
+        if (goal == m_goals.constEnd()) break;
+        ancestors.append(goal->id);
+    }
+    return ancestors;
+}
+
+GoalRollup StudyGoal::getRollup(int goalId) const
+{
+    auto rollup = m_rollups.constFind(m_savedOccurrenceIds.value(goalId, goalId));
+    if (rollup != m_rollups.constEnd()) return *rollup;
+    // Unsaved occurrences are never part of a larger goal
+    GoalInfo goal;
+    return lookupGoal(goalId, goal) ? ownShare(goal) : GoalRollup();
+}
+
+bool StudyGoal::dependsOn(int goalId, int otherGoalId) const
+{
+    QList<int> pending = m_prerequisites.value(goalId);
+    QSet<int> seen;
+    while (!pending.isEmpty()) {
+        const int prerequisiteId = pending.takeLast();
+        if (prerequisiteId == otherGoalId) return true;
+        if (seen.contains(prerequisiteId)) continue;
+        seen.insert(prerequisiteId);
+        pending += m_prerequisites.value(prerequisiteId);
+    }
+    return false;
+}
+
+bool StudyGoal::setPrerequisites(int goalId, const QList<int> &prerequisiteIds)
 {
-    QMap<QString, int> stats;
     if (!db.isOpen()) {
-        qDebug() << "Error: Database not open for getting daily stats.";
-        return stats;
+        qDebug() << "Error: Database not open for setting prerequisites.";
+        return false;
+    }
+    goalId = m_savedOccurrenceIds.value(goalId, goalId);
+    if (!m_goals.contains(goalId)) {
+        qDebug() << "No goal found with ID" << goalId;
+        return false;
     }
 
-    QSqlQuery query(db);
-    query.prepare("SELECT SUM(completed_minutes) FROM goals WHERE start_date = ?");
-    query.addBindValue(date.toString(Qt::ISODate));
+    // No cycles, and no goal waiting on a larger goal it is itself part of
+    const QList<int> ancestors = getAncestors(goalId);
+    QList<int> prerequisites;
+    for (int prerequisiteId : prerequisiteIds) {
+        prerequisiteId = m_savedOccurrenceIds.value(prerequisiteId, prerequisiteId);
+        if (prerequisites.contains(prerequisiteId)) continue;
+        if (prerequisiteId == goalId || !m_goals.contains(prerequisiteId) || ancestors.contains(prerequisiteId)
+            || dependsOn(prerequisiteId, goalId)) {
+            qDebug() << "Goal" << prerequisiteId << "cannot be a prerequisite of goal" << goalId;
+            return false;
+        }
+        prerequisites.append(prerequisiteId);
+    }
+    if (prerequisites == m_prerequisites.value(goalId)) return true;
 
-    if (!query.exec()) {
-        qDebug() << "Error getting daily stats:" << query.lastError().text();
-        return stats;
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM goal_prerequisites WHERE goal_id = ?");
+    query.addBindValue(goalId);
+    bool ok = query.exec();
+    query.prepare("INSERT INTO goal_prerequisites (goal_id, prerequisite_id) VALUES (?, ?)");
+    for (int i = 0; ok && i < prerequisites.size(); ++i) {
+        query.addBindValue(goalId);
+        query.addBindValue(prerequisites[i]);
+        ok = query.exec();
+    }
+    if (!ok || !db.commit()) {
+        qDebug() << "Error setting goal prerequisites:" << query.lastError().text() << db.lastError().text();
+        db.rollback();
+        return false;
     }
 
-    if (query.next()) {
-        stats["totalMinutes"] = query.value(0).toInt();
+    if (prerequisites.isEmpty()) {
+        m_prerequisites.remove(goalId);
     } else {
-        stats["totalMinutes"] = 0;
+        m_prerequisites.insert(goalId, prerequisites);
+    }
+    emit goalUpdated(goalId);
+    GoalDelta delta;
+    delta.updated.append(goalId);
+    emit goalsChanged(delta);
+    return true;
+}
+
+QList<int> StudyGoal::getPrerequisites(int goalId) const
+{
+    return m_prerequisites.value(m_savedOccurrenceIds.value(goalId, goalId));
+}
+
+bool StudyGoal::isBlocked(int goalId) const
+{
+    auto prerequisites = m_prerequisites.constFind(m_savedOccurrenceIds.value(goalId, goalId));
+    if (prerequisites == m_prerequisites.constEnd()) return false;
+    for (int prerequisiteId : *prerequisites) {
+        const GoalRollup rollup = m_rollups.value(prerequisiteId);
+        if (rollup.completedMinutes < rollup.targetMinutes) return true;
+    }
+    return false;
+}
+
+QList<GoalInfo> StudyGoal::getSavedGoals() const
+{
+    // Saved occurrences of recurring goals are left out; they belong to their rule
+    QList<GoalInfo> goals;
+    for (const GoalInfo &goal : m_goals) {
+        if (goal.parentGoalId <= 0) goals.append(goal);
+    }
+    std::sort(goals.begin(), goals.end(), goalOrder);
+    return goals;
+}
+
+// Statistics
+QMap<QString, int> StudyGoal::getSubjectStats(const QDate &startDate, const QDate &endDate)
+{
+    QMap<QString, int> stats;
+    const QString first = startDate.toString(Qt::ISODate);
+    const QString last = endDate.toString(Qt::ISODate);
+    for (const GoalInfo &goal : m_goals) {
+        if (goal.startDate >= first && goal.startDate <= last) {
+            stats[goal.subject] += goal.completedMinutes;
+        }
     }
     return stats;
 }
 
-QList<QString> StudyGoal::getResourcesForGoal(int goalId) const
+QMap<QString, int> StudyGoal::getDailyStats(const QDate &date)
 {
-    QList<QString> resources;
-    if (!db.isOpen()) return resources;
-    QSqlQuery query(db);
-    query.prepare("SELECT value FROM goal_resources WHERE goal_id = ?");
-    query.addBindValue(goalId);
-    if (query.exec()) {
-        while (query.next()) {
-            resources.append(query.value(0).toString());
+    QMap<QString, int> stats;
+    const QString day = date.toString(Qt::ISODate);
+    int totalMinutes = 0;
+    for (const GoalInfo &goal : m_goals) {
+        if (goal.startDate == day) {
+            totalMinutes += goal.completedMinutes;
         }
     }
-    return resources;
+    stats["totalMinutes"] = totalMinutes;
+    return stats;
+}
+
+QList<QString> StudyGoal::getResourcesForGoal(int goalId) const
+{
+    GoalInfo goal;
+    return lookupGoal(goalId, goal) ? goal.resources : QList<QString>();
 }
@@ -11,7 +11,10 @@
 #include <QSqlRecord>
 #include <QDate>
 #include <QTimer>
+#include <QHash>
+#include <QSet>
 #include "pomodoro.h"
+#include "recurrencerule.h"
 
 
 struct GoalInfo {
@@ -28,10 +31,39 @@ struct GoalInfo {
     QString category;
     QDate lastGeneratedDate;
     QStringList resources; // New field for resources
+    QString rrule;          // RRULE of a recurring goal
+    QString exceptionDates; // comma-separated ISO dates the rule skips
+    int parentGoalId = -1;  // recurring goal an occurrence belongs to
+    QString occurrenceDate;
+    int partOfGoalId = -1;  // larger goal this one is a part of, e.g. a chapter of a course
 };
 
 Q_DECLARE_METATYPE(GoalInfo)
 
+// Ids touched by one change to the goal store
+struct GoalDelta {
+    QList<int> added;
+    QList<int> updated;
+    QList<int> removed;
+
+    bool isEmpty() const { return added.isEmpty() && updated.isEmpty() && removed.isEmpty(); }
+};
+
+Q_DECLARE_METATYPE(GoalDelta)
+
+// Totals of a goal and every goal that is part of it
+struct GoalRollup {
+    int targetMinutes = 0;
+    int completedMinutes = 0; // each goal counts at most its own target
+    int goalCount = 0;
+
+    bool operator==(const GoalRollup &other) const
+    {
+        return targetMinutes == other.targetMinutes && completedMinutes == other.completedMinutes
+               && goalCount == other.goalCount;
+    }
+};
+
 class StudyGoal : public QObject
 {
     Q_OBJECT
@@ -40,6 +72,9 @@ public:
     explicit StudyGoal(QSqlDatabase& db, QObject *parent = nullptr);
     ~StudyGoal();
 
+    // Re-reads the goals table after bulk changes made outside this class, e.g. an import
+    bool reloadGoals();
+
     // CRUD Operations
     bool createGoal(const QString &subject, int targetMinutes, const QString &notes = "", const QString &recurrenceType = "None", const QString &recurrenceValue = "", const QString &category = "Uncategorized", const QStringList &resources = QStringList());
     bool updateGoal(int goalId, const QString &subject, int targetMinutes, const QString &notes, const QString &recurrenceType, const QString &recurrenceValue, const QString &category, const QStringList &resources = QStringList());
@@ -56,6 +91,8 @@ public:
     int getTarget(int goalId) const;
     float getCompletionPercentage(int goalId) const;
     bool addProgress(int goalId, int minutesToAdd);
+    // Adds minutes to several goals in one transaction and emits a single goalsChanged
+    bool addProgressBatch(const QHash<int, int> &minutesByGoal);
 
     // tracking methods for Pomodoro integration
     void connectToPomodoroTimer(PomodoroTimer *timer);
@@ -64,8 +101,29 @@ public:
     void stopTrackingGoal();
 
     // Recurring Goals
-    void generateRecurringGoals(int parentGoalId);
-    void checkAndGenerateAllRecurringGoals(); 
+    // Occurrences of recurring goals are expanded on demand and carry negative ids
+    // until they are saved; saving happens on first progress, edit or session link
+    int materializeGoal(int goalId);
+    QList<QDate> getOccurrences(int goalId, const QDate &from, const QDate &to) const;
+    // One-time catch-up for rows written by the old eager generator: untouched instances
+    // are dropped (the rule expands them again), the rest are linked to their recurring goal,
+    // and generated dates with no instance left become exception dates.
+    // Runs in one transaction and emits a single goalsChanged
+    bool catchUpRecurringGoals();
+
+    // Goal hierarchy and prerequisites
+    // Rollups are kept per goal and adjusted along the ancestor chain on every change,
+    // so progress on a leaf costs O(depth) rather than a walk over the whole tree
+    bool setGoalPartOf(int goalId, int partOfGoalId); // -1 makes the goal top-level
+    QList<int> getSubGoals(int goalId) const;
+    QList<int> getAncestors(int goalId) const;        // nearest first
+    GoalRollup getRollup(int goalId) const;
+    bool setPrerequisites(int goalId, const QList<int> &prerequisiteIds);
+    QList<int> getPrerequisites(int goalId) const;
+    // True while a prerequisite's rolled-up progress is short of its target
+    bool isBlocked(int goalId) const;
+    QList<GoalInfo> getSavedGoals() const;
+    int lastCreatedGoalId() const { return m_lastCreatedGoalId; }
 
     // Statistics
     QMap<QString, int> getSubjectStats(const QDate &startDate, const QDate &endDate);
@@ -75,6 +133,8 @@ signals:
     void goalCreated(int goalId);
     void goalUpdated(int goalId);
     void goalDeleted(int goalId);
+    // Emitted after the in-memory store changed, alongside the per-goal signals
+    void goalsChanged(const GoalDelta &delta);
     
     // signals for session tracking
     void sessionTimeUpdated(int goalId, int elapsedSeconds);
@@ -86,8 +146,44 @@ private:
     QSqlDatabase& db;
     bool initializeDatabase();
     bool executeQuery(const QString &query, QSqlQuery &result);
+    bool applyProgress(const QHash<int, int> &minutesByGoal, GoalDelta &delta);
+    bool lookupGoal(int goalId, GoalInfo &goal) const;
+    GoalInfo occurrenceOf(const GoalInfo &parent, const QDate &date) const;
+    int saveOccurrence(int goalId, GoalDelta &delta);
+    bool addException(int parentGoalId, const QDate &date);
+
+    // In-memory copy of the goals table, loaded once; read paths never query SQLite
+    bool loadGoals();
+    void indexGoal(const GoalInfo &goal);
+    void unindexGoal(int goalId);
+    void clearIndexes(const GoalInfo &goal);
+    QHash<int, GoalInfo> m_goals;
+    QMultiMap<QString, int> m_goalsByDueDate; // ISO due date -> goal id
+    QSet<int> m_openEndedGoals;               // goals whose due_date is NULL
+    QHash<int, RecurrenceRule> m_rules;       // recurring goal id -> rule
+    QSet<QPair<int, QString>> m_savedOccurrences; // (recurring goal id, ISO date) already in goals
+    // Ids handed out to unsaved occurrences stay stable for the session
+    mutable QHash<QPair<int, QString>, int> m_occurrenceIds;
+    mutable QHash<int, QPair<int, QString>> m_occurrenceKeys;
+    mutable int m_nextOccurrenceId = -1;
+    QHash<int, int> m_savedOccurrenceIds;     // unsaved id -> id of the saved row
+
+    // Hierarchy, built once after loading and then maintained incrementally
+    void rebuildHierarchy();
+    void shiftRollup(int goalId, int targetMinutes, int completedMinutes, int goalCount);
+    void detachFromHierarchy(const GoalInfo &goal);
+    bool dependsOn(int goalId, int otherGoalId) const;
+    QHash<int, GoalRollup> m_rollups;      // goal id -> totals of the goal and its sub-goals
+    QHash<int, QList<int>> m_subGoals;     // goal id -> goals that are part of it
+    QHash<int, QList<int>> m_prerequisites; // goal id -> goals to finish first
+    bool m_hierarchyLoaded = false;
+    int m_lastCreatedGoalId = -1;
 
     int m_currentTrackingGoalId;
+    // Saved progress and target of the tracked goal, so timer ticks need no lookups
+    int m_trackedCompletedMinutes;
+    int m_trackedTargetMinutes;
+    void refreshTrackingState();
     PomodoroTimer *m_pomodoroTimer;
     QTime m_pomodoroSessionStartTime;
 
@@ -1,4 +1,5 @@
 #include "survey.h"
+#include "database.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -20,13 +21,13 @@ Survey::~Survey() {
 QList<SurveyResult> Survey::getSurveyResultsForGoal(int goalId) const {
     QList<SurveyResult> results;
     QSqlQuery query(db);
-    query.prepare("SELECT goal_id, timestamp, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder FROM surveys WHERE goal_id = ? ORDER BY timestamp DESC");
+    query.prepare("SELECT goal_id, ts, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder FROM surveys WHERE goal_id = ? ORDER BY ts DESC");
     query.addBindValue(goalId);
     if (query.exec()) {
         while (query.next()) {
             SurveyResult r;
             r.goalId = query.value(0).toInt();
-            r.timestamp = QDateTime::fromString(query.value(1).toString(), Qt::ISODate);
+            r.timestamp = query.value(1).isNull() ? QDateTime() : QDateTime::fromSecsSinceEpoch(query.value(1).toLongLong());
             r.moodEmoji = query.value(2).toString();
             r.distractionLevel = query.value(3).toInt();
             r.distractions = query.value(4).toString().split(", ", Qt::SkipEmptyParts);
@@ -41,10 +42,12 @@ QList<SurveyResult> Survey::getSurveyResultsForGoal(int goalId) const {
 }
 
 bool Survey::saveSurveyResult(const SurveyResult &result) {
+    db.transaction();
     QSqlQuery query(db);
-    query.prepare("INSERT INTO surveys (goal_id, timestamp, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    query.prepare("INSERT INTO surveys (goal_id, timestamp, ts, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
     query.addBindValue(result.goalId);
     query.addBindValue(result.timestamp.toString(Qt::ISODate));
+    query.addBindValue(result.timestamp.toSecsSinceEpoch());
     query.addBindValue(result.moodEmoji);
     query.addBindValue(result.distractionLevel);
     query.addBindValue(result.distractions.join(", "));
@@ -54,6 +57,16 @@ bool Survey::saveSurveyResult(const SurveyResult &result) {
     query.addBindValue(result.setReminder ? 1 : 0);
     if (!query.exec()) {
         qDebug() << "Survey: Failed to save survey result:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    // The charts count distractions by code
+    if (!Database::addSurveyDistractions(db, query.lastInsertId().toLongLong(), result.distractions.join(", "))) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        qDebug() << "Survey: Failed to commit survey result:" << db.lastError().text();
         return false;
     }
     return true;
@@ -62,12 +75,12 @@ bool Survey::saveSurveyResult(const SurveyResult &result) {
 QList<SurveyResult> Survey::getAllSurveyResults() const {
     QList<SurveyResult> results;
     QSqlQuery query(db);
-    query.prepare("SELECT goal_id, timestamp, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder FROM surveys ORDER BY timestamp DESC");
+    query.prepare("SELECT goal_id, ts, mood_emoji, distraction_level, distractions, session_satisfaction, goal_achieved, open_feedback, set_reminder FROM surveys ORDER BY ts DESC");
     if (query.exec()) {
         while (query.next()) {
             SurveyResult r;
             r.goalId = query.value(0).toInt();
-            r.timestamp = QDateTime::fromString(query.value(1).toString(), Qt::ISODate);
+            r.timestamp = query.value(1).isNull() ? QDateTime() : QDateTime::fromSecsSinceEpoch(query.value(1).toLongLong());
             r.moodEmoji = query.value(2).toString();
             r.distractionLevel = query.value(3).toInt();
             r.distractions = query.value(4).toString().split(", ", Qt::SkipEmptyParts);
@@ -86,8 +99,8 @@ QList<QString> Survey::getCommonDistractions() const {
 } 
 bool Survey::deleteSurveyResult(int goalId, const QDateTime &timestamp) {
     QSqlQuery query(db);
-    query.prepare("DELETE FROM surveys WHERE goal_id = ? AND timestamp = ?");
+    query.prepare("DELETE FROM surveys WHERE goal_id = ? AND ts = ?");
     query.addBindValue(goalId);
-    query.addBindValue(timestamp.toString(Qt::ISODate));
+    query.addBindValue(timestamp.toSecsSinceEpoch());
     return query.exec();
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "tdigest.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double kPi = 3.14159265358979323846;
+
+// k1 scale function: centroids are small near q = 0 and q = 1, large in the middle
+double scale(double q, double delta)
+{
+    return delta / (2.0 * kPi) * std::asin(2.0 * q - 1.0);
+}
+
+double inverseScale(double k, double delta)
+{
+    k = std::clamp(k, -delta / 4.0, delta / 4.0);
+    return (std::sin(k * 2.0 * kPi / delta) + 1.0) / 2.0;
+}
+}
+
+TDigest::TDigest(double compression)
+    : delta(compression > 10.0 ? compression : 10.0)
+{
+}
+
+void TDigest::add(double value, double weight)
+{
+    if (weight <= 0.0 || std::isnan(value)) return;
+    if (totalWeight == 0.0) {
+        minValue = maxValue = value;
+    } else {
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+    totalWeight += weight;
+    buffer.push_back({value, weight});
+    if (buffer.size() >= static_cast<std::size_t>(delta * 5)) {
+        compress();
+    }
+}
+
+void TDigest::merge(const TDigest &other)
+{
+    if (other.isEmpty()) return;
+    const std::vector<Centroid> &incoming = other.centroids();
+    if (totalWeight == 0.0) {
+        minValue = other.minValue;
+        maxValue = other.maxValue;
+    } else {
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+    totalWeight += other.totalWeight;
+    buffer.insert(buffer.end(), incoming.begin(), incoming.end());
+    compress();
+}
+
+void TDigest::compress() const
+{
+    if (buffer.empty()) return;
+
+    buffer.insert(buffer.end(), merged.begin(), merged.end());
+    std::sort(buffer.begin(), buffer.end(), [](const Centroid &a, const Centroid &b) {
+        return a.mean < b.mean;
+    });
+
+    std::vector<Centroid> result;
+    result.reserve(static_cast<std::size_t>(delta));
+    Centroid current = buffer.front();
+    double weightSoFar = 0.0;
+    double limit = totalWeight * inverseScale(scale(0.0, delta) + 1.0, delta);
+    for (std::size_t i = 1; i < buffer.size(); ++i) {
+        const Centroid &next = buffer[i];
+        if (weightSoFar + current.weight + next.weight <= limit) {
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        } else {
+            weightSoFar += current.weight;
+            result.push_back(current);
+            limit = totalWeight * inverseScale(scale(weightSoFar / totalWeight, delta) + 1.0, delta);
+            current = next;
+        }
+    }
+    result.push_back(current);
+
+    merged.swap(result);
+    buffer.clear();
+}
+
+double TDigest::quantile(double q) const
+{
+    compress();
+    if (merged.empty()) return 0.0;
+    if (merged.size() == 1) return merged.front().mean;
+
+    q = std::clamp(q, 0.0, 1.0);
+    const double index = q * totalWeight;
+
+    // Tails interpolate towards the exact extremes
+    const Centroid &first = merged.front();
+    if (index < first.weight / 2.0) {
+        return minValue + (first.mean - minValue) * index / (first.weight / 2.0);
+    }
+    const Centroid &last = merged.back();
+    if (index > totalWeight - last.weight / 2.0) {
+        const double tail = totalWeight - index;
+        return maxValue - (maxValue - last.mean) * tail / (last.weight / 2.0);
+    }
+
+    // Otherwise interpolate between the centres of neighbouring centroids
+    double center = first.weight / 2.0;
+    for (std::size_t i = 0; i + 1 < merged.size(); ++i) {
+        const double gap = (merged[i].weight + merged[i + 1].weight) / 2.0;
+        if (index <= center + gap) {
+            const double t = (index - center) / gap;
+            return merged[i].mean + t * (merged[i + 1].mean - merged[i].mean);
+        }
+        center += gap;
+    }
+    return last.mean;
+}
+
+const std::vector<TDigest::Centroid> &TDigest::centroids() const
+{
+    compress();
+    return merged;
+}
+
+TDigest TDigest::fromCentroids(double compression, double min, double max,
+                               const std::vector<Centroid> &centroids)
+{
+    TDigest digest(compression);
+    for (const Centroid &c : centroids) {
+        if (c.weight > 0.0) {
+            digest.merged.push_back(c);
+            digest.totalWeight += c.weight;
+        }
+    }
+    std::sort(digest.merged.begin(), digest.merged.end(), [](const Centroid &a, const Centroid &b) {
+        return a.mean < b.mean;
+    });
+    digest.minValue = min;
+    digest.maxValue = max;
+    return digest;
+}
@@ -0,0 +1,48 @@
+#ifndef TDIGEST_H
+#define TDIGEST_H
+
+#include <cstddef>
+#include <vector>
+
+// Merging t-digest (Dunning): a compact, mergeable sketch of a distribution
+// that answers quantile queries with small error, tightest near the tails.
+class TDigest
+{
+public:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    explicit TDigest(double compression = 100.0);
+
+    void add(double value, double weight = 1.0);
+    void merge(const TDigest &other);
+
+    // q in [0, 1]; 0 when the digest is empty
+    double quantile(double q) const;
+
+    bool isEmpty() const { return totalWeight == 0.0; }
+    double count() const { return totalWeight; }
+    double compression() const { return delta; }
+    double min() const { return minValue; }
+    double max() const { return maxValue; }
+
+    // Compressed centroids in increasing mean order, for persistence
+    const std::vector<Centroid> &centroids() const;
+    static TDigest fromCentroids(double compression, double min, double max,
+                                 const std::vector<Centroid> &centroids);
+
+private:
+    void compress() const;
+
+    double delta;
+    double totalWeight = 0.0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+    // Compression is deferred until a read, so both are mutable
+    mutable std::vector<Centroid> merged;
+    mutable std::vector<Centroid> buffer;
+};
+
+#endif // TDIGEST_H